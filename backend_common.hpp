@@ -24,6 +24,16 @@ inline u32 bytesPerTexelForFormat(TextureFormat fmt)
     case BGRA8_SRGB:
         return 4;
     case Depth32_Float: return 4;
+    case R32_UInt:
+    case R32_Float:
+        return 4;
+    case RGBA16_Float: return 8;
+    case RGBA32_Float: return 16;
+    case Depth16_UNorm: return 2;
+    case Depth24Plus:
+    case Depth24Plus_Stencil8:
+        return 4;
+    case Depth32_Float_Stencil8: return 8;
     default: MADRONA_UNREACHABLE();
   }
 }
@@ -373,6 +383,31 @@ struct DrawParams {
   u32 numInstances = 1;
 };
 
+struct DrawIndirectParams {
+  Buffer buffer = {};
+  u32 offset = 0;
+};
+
+struct MultiDrawIndirectParams {
+  DrawIndirectParams args;
+  u32 maxDraws;
+  Buffer countBuffer;
+  u32 countOffset;
+  Buffer emulationArgsBuffer;
+  u32 emulationArgsOffset;
+};
+
+struct DispatchParams {
+  u32 numBlocksX = 0;
+  u32 numBlocksY = 1;
+  u32 numBlocksZ = 1;
+};
+
+struct DispatchIndirectParams {
+  Buffer buffer = {};
+  u32 offset = 0;
+};
+
 struct ScissorParams {
   u32 offsetX;
   u32 offsetY;
@@ -380,17 +415,44 @@ struct ScissorParams {
   u32 height;
 };
 
+struct ViewportParams {
+  float offsetX;
+  float offsetY;
+  float width;
+  float height;
+  float minDepth;
+  float maxDepth;
+};
+
+struct TransientRasterPassParams {
+  RasterPassInterface interface;
+  Texture depthAttachment;
+  QuerySet occlusionQuerySet;
+  u32 numColorAttachments;
+  std::array<Texture, MAX_COLOR_ATTACHMENTS> colorAttachments;
+  u32 numResolveAttachments;
+  std::array<Texture, MAX_COLOR_ATTACHMENTS> resolveAttachments;
+};
+
 inline void debugPrintDrawCommandCtrl(CommandCtrl ctrl)
 {
   using enum CommandCtrl;
 
-  assert((ctrl & (RasterDraw | RasterDrawIndexed)) != None);
+  assert((ctrl & (RasterDraw | RasterDrawIndexed |
+                  RasterDrawIndirect | RasterDrawIndexedIndirect |
+                  RasterMultiDrawIndexedIndirect)) != None);
 
   printf("Draw Control: ");
   if ((ctrl & RasterDraw) != None) {
     printf("RasterDraw");
   } else if ((ctrl & RasterDrawIndexed) != None) {
     printf("RasterDrawIndexed");
+  } else if ((ctrl & RasterDrawIndirect) != None) {
+    printf("RasterDrawIndirect");
+  } else if ((ctrl & RasterDrawIndexedIndirect) != None) {
+    printf("RasterDrawIndexedIndirect");
+  } else if ((ctrl & RasterMultiDrawIndexedIndirect) != None) {
+    printf("RasterMultiDrawIndexedIndirect");
   }
 
   if ((ctrl & DrawShader) != None) {
@@ -434,6 +496,12 @@ inline void debugPrintDrawCommandCtrl(CommandCtrl ctrl)
   if ((ctrl & DrawNumInstances) != None) {
     printf(" | NumInstances");
   }
+  if ((ctrl & DrawIndirectBuffer) != None) {
+    printf(" | IndirectBuffer");
+  }
+  if ((ctrl & DrawIndirectOffset) != None) {
+    printf(" | IndirectOffset");
+  }
   printf("\n");
 }
 
@@ -459,24 +527,59 @@ struct CopyTextureToBufferCmd {
   u32 dstOffset;
 };
 
+struct CopyTextureToBufferConvertedCmd {
+  CopyTextureToBufferCmd copy;
+  TextureConversion conversion;
+};
+
 struct CopyClearBufferCmd {
   Buffer buffer;
   u32 offset;
   u32 numBytes;
 };
 
+struct CopyGenerateMipsCmd {
+  Texture texture;
+};
+
+struct CopyResolveQuerySetCmd {
+  QuerySet querySet;
+  u32 firstQuery;
+  u32 numQueries;
+  Buffer dst;
+  u32 dstOffset;
+};
+
+struct CopyScatterUpdateCmd {
+  Buffer dst;
+  Buffer src;
+  u32 srcOffset;
+  u32 numBytes;
+  u32 numRegions;
+};
+
 class CommandDecoder {
 public:
   inline CommandDecoder(FrontendCommands *cmds)
     : cmds_(cmds),
       offset_(0),
       draw_params_(),
+      draw_indirect_params_(),
+      dispatch_params_(),
+      dispatch_indirect_params_(),
       copy_cmd_()
   {}
 
   inline void resetDrawParams()
   {
     draw_params_ = {};
+    draw_indirect_params_ = {};
+  }
+
+  inline void resetDispatchParams()
+  {
+    dispatch_params_ = {};
+    dispatch_indirect_params_ = {};
   }
 
   inline void resetCopyCommand()
@@ -608,6 +711,136 @@ public:
     return draw_params_;
   }
 
+  inline DrawIndirectParams drawIndirectParams(CommandCtrl ctrl)
+  {
+    if (t(ctrl, DrawIndirectBuffer)) {
+      draw_indirect_params_.buffer = id<Buffer>();
+    }
+
+    if (t(ctrl, DrawIndirectOffset)) {
+      draw_indirect_params_.offset = next();
+    }
+
+    return draw_indirect_params_;
+  }
+
+  inline MultiDrawIndirectParams multiDrawIndirectParams(CommandCtrl ctrl)
+  {
+    DrawIndirectParams args = drawIndirectParams(ctrl);
+    u32 max_draws = next();
+    Buffer count_buffer = id<Buffer>();
+    u32 count_offset = next();
+    Buffer emulation_args_buffer = id<Buffer>();
+    u32 emulation_args_offset = next();
+
+    return MultiDrawIndirectParams {
+      .args = args,
+      .maxDraws = max_draws,
+      .countBuffer = count_buffer,
+      .countOffset = count_offset,
+      .emulationArgsBuffer = emulation_args_buffer,
+      .emulationArgsOffset = emulation_args_offset,
+    };
+  }
+
+  inline TransientRasterPassParams transientRasterPass()
+  {
+    TransientRasterPassParams params;
+    params.interface = id<RasterPassInterface>();
+    params.depthAttachment = id<Texture>();
+    params.occlusionQuerySet = id<QuerySet>();
+    params.numColorAttachments = next();
+
+    for (u32 i = 0; i < params.numColorAttachments; i++) {
+      params.colorAttachments[i] = id<Texture>();
+    }
+
+    params.numResolveAttachments = next();
+
+    for (u32 i = 0; i < params.numResolveAttachments; i++) {
+      params.resolveAttachments[i] = id<Texture>();
+    }
+
+    return params;
+  }
+
+  // Followed by this many RenderBundle ids
+  inline u32 numBundles()
+  {
+    return next();
+  }
+
+  // Decodes the rest of the current raster pass on a copy of the decoder,
+  // for backends that need to prepare multi draws before the pass begins.
+  template <typename Fn>
+  inline void forEachMultiDrawIndirect(Fn &&fn) const
+  {
+    CommandDecoder scan = *this;
+
+    while (true) {
+      CommandCtrl ctrl = scan.ctrl();
+      if (ctrl == CommandCtrl::None) {
+        return;
+      }
+
+      if (ctrl == CommandCtrl::RasterScissors) {
+        scan.scissorParams();
+        continue;
+      }
+
+      if (ctrl == CommandCtrl::RasterViewport) {
+        scan.viewportParams();
+        continue;
+      }
+
+      if (ctrl == CommandCtrl::RasterBlendConstant) {
+        scan.blendConstant();
+        continue;
+      }
+
+      if (ctrl == CommandCtrl::RasterStencilReference) {
+        scan.stencilReference();
+        continue;
+      }
+
+      if (ctrl == CommandCtrl::RasterBeginOcclusionQuery) {
+        scan.occlusionQueryIndex();
+        continue;
+      }
+
+      if (ctrl == CommandCtrl::RasterEndOcclusionQuery) {
+        continue;
+      }
+
+      if (ctrl == CommandCtrl::RasterExecuteBundles) {
+        u32 num_bundles = scan.numBundles();
+        for (u32 i = 0; i < num_bundles; i++) {
+          scan.id<RenderBundle>();
+        }
+        continue;
+      }
+
+      scan.drawShader(ctrl);
+      scan.drawParamBlock0(ctrl);
+      scan.drawParamBlock1(ctrl);
+      scan.drawParamBlock2(ctrl);
+      scan.drawDataBuffer(ctrl);
+      scan.drawDataOffset(ctrl);
+      scan.drawVertexBuffer0(ctrl);
+      scan.drawVertexBuffer1(ctrl);
+      scan.drawIndexBuffer32(ctrl);
+      scan.drawIndexBuffer16(ctrl);
+      scan.drawParams(ctrl);
+
+      if (scan.t(ctrl, CommandCtrl::RasterMultiDrawIndexedIndirect)) {
+        fn(scan.multiDrawIndirectParams(ctrl));
+      } else if (scan.t(ctrl, CommandCtrl::RasterDrawIndirect |
+                               CommandCtrl::RasterDrawIndexedIndirect)) {
+        scan.drawIndirectParams(ctrl);
+      }
+    }
+  }
+
   inline ScissorParams scissorParams()
   {
     // Could pack these
@@ -624,6 +857,129 @@ public:
     };
   }
 
+  inline ViewportParams viewportParams()
+  {
+    float offset_x = nextF32();
+    float offset_y = nextF32();
+    float width = nextF32();
+    float height = nextF32();
+    float min_depth = nextF32();
+    float max_depth = nextF32();
+
+    return ViewportParams {
+      .offsetX = offset_x,
+      .offsetY = offset_y,
+      .width = width,
+      .height = height,
+      .minDepth = min_depth,
+      .maxDepth = max_depth,
+    };
+  }
+
+  inline Vector4 blendConstant()
+  {
+    float r = nextF32();
+    float g = nextF32();
+    float b = nextF32();
+    float a = nextF32();
+
+    return Vector4 { r, g, b, a };
+  }
+
+  inline u32 stencilReference()
+  {
+    return next();
+  }
+
+  inline u32 occlusionQueryIndex()
+  {
+    return next();
+  }
+
+  inline gas::ComputeShader computeShader(CommandCtrl ctrl)
+  {
+    if (t(ctrl, CommandCtrl::ComputeShader)) {
+      return id<gas::ComputeShader>();
+    } else {
+      return gas::ComputeShader {};
+    }
+  }
+
+  inline ParamBlock computeParamBlock0(CommandCtrl ctrl)
+  {
+    if (t(ctrl, ComputeParamBlock0)) {
+      return id<ParamBlock>();
+    } else {
+      return ParamBlock {};
+    }
+  }
+
+  inline ParamBlock computeParamBlock1(CommandCtrl ctrl)
+  {
+    if (t(ctrl, ComputeParamBlock1)) {
+      return id<ParamBlock>();
+    } else {
+      return ParamBlock {};
+    }
+  }
+
+  inline ParamBlock computeParamBlock2(CommandCtrl ctrl)
+  {
+    if (t(ctrl, ComputeParamBlock2)) {
+      return id<ParamBlock>();
+    } else {
+      return ParamBlock {};
+    }
+  }
+
+  inline Buffer computeDataBuffer(CommandCtrl ctrl)
+  {
+    if (t(ctrl, ComputeDataBuffer)) {
+      return id<Buffer>();
+    } else {
+      return {};
+    }
+  }
+
+  inline u32 computeDataOffset(CommandCtrl ctrl)
+  {
+    if (t(ctrl, ComputeDataOffset)) {
+      return next();
+    } else {
+      return 0xFFFF'FFFF;
+    }
+  }
+
+  inline DispatchParams dispatchParams(CommandCtrl ctrl)
+  {
+    if (t(ctrl, ComputeNumBlocksX)) {
+      dispatch_params_.numBlocksX = next();
+    }
+
+    if (t(ctrl, ComputeNumBlocksY)) {
+      dispatch_params_.numBlocksY = next();
+    }
+
+    if (t(ctrl, ComputeNumBlocksZ)) {
+      dispatch_params_.numBlocksZ = next();
+    }
+
+    return dispatch_params_;
+  }
+
+  inline DispatchIndirectParams dispatchIndirectParams(CommandCtrl ctrl)
+  {
+    if (t(ctrl, ComputeIndirectBuffer)) {
+      dispatch_indirect_params_.buffer = id<Buffer>();
+    }
+
+    if (t(ctrl, ComputeIndirectOffset)) {
+      dispatch_indirect_params_.offset = next();
+    }
+
+    return dispatch_indirect_params_;
+  }
+
   inline CopyBufferToBufferCmd copyBufferToBuffer(CommandCtrl ctrl)
   {
     if (t(ctrl, CopyB2BSrcBuffer)) {
@@ -707,6 +1063,21 @@ public:
     };
   }
 
+  inline CopyTextureToBufferConvertedCmd copyTextureToBufferConverted(
+      CommandCtrl ctrl)
+  {
+    CopyTextureToBufferCmd copy = copyTextureToBuffer(ctrl);
+
+    if (t(ctrl, CopyT2BConversion)) {
+      copy_cmd_.data[4] = next();
+    }
+
+    return {
+      .copy = copy,
+      .conversion = (TextureConversion)copy_cmd_.data[4],
+    };
+  }
+
   inline CopyClearBufferCmd copyClear(CommandCtrl ctrl)
   {
     if (t(ctrl, CopyClearBuffer)) {
@@ -728,6 +1099,79 @@ public:
     };
   }
 
+  inline CopyGenerateMipsCmd copyGenerateMips(CommandCtrl ctrl)
+  {
+    if (t(ctrl, CopyMipsTexture)) {
+      copy_cmd_.data[0] = next();
+    }
+
+    return {
+      .texture = Texture::fromUInt(copy_cmd_.data[0]),
+    };
+  }
+
+  inline CopyResolveQuerySetCmd copyResolveQuerySet(CommandCtrl ctrl)
+  {
+    if (t(ctrl, CopyResolveQuerySet)) {
+      copy_cmd_.data[0] = next();
+    }
+
+    if (t(ctrl, CopyResolveFirstQuery)) {
+      copy_cmd_.data[1] = next();
+    }
+
+    if (t(ctrl, CopyResolveNumQueries)) {
+      copy_cmd_.data[2] = next();
+    }
+
+    if (t(ctrl, CopyResolveDstBuffer)) {
+      copy_cmd_.data[3] = next();
+    }
+
+    if (t(ctrl, CopyResolveDstOffset)) {
+      copy_cmd_.data[4] = next();
+    }
+
+    return {
+      .querySet = QuerySet::fromUInt(copy_cmd_.data[0]),
+      .firstQuery = copy_cmd_.data[1],
+      .numQueries = copy_cmd_.data[2],
+      .dst = Buffer::fromUInt(copy_cmd_.data[3]),
+      .dstOffset = copy_cmd_.data[4],
+    };
+  }
+
+  inline CopyScatterUpdateCmd copyScatterUpdate(CommandCtrl ctrl)
+  {
+    if (t(ctrl, CopyScatterDstBuffer)) {
+      copy_cmd_.data[0] = next();
+    }
+
+    if (t(ctrl, CopyScatterSrcBuffer)) {
+      copy_cmd_.data[1] = next();
+    }
+
+    if (t(ctrl, CopyScatterSrcOffset)) {
+      copy_cmd_.data[2] = next();
+    }
+
+    if (t(ctrl, CopyScatterNumBytes)) {
+      copy_cmd_.data[3] = next();
+    }
+
+    if (t(ctrl, CopyScatterNumRegions)) {
+      copy_cmd_.data[4] = next();
+    }
+
+    return {
+      .dst = Buffer::fromUInt(copy_cmd_.data[0]),
+      .src = Buffer::fromUInt(copy_cmd_.data[1]),
+      .srcOffset = copy_cmd_.data[2],
+      .numBytes = copy_cmd_.data[3],
+      .numRegions = copy_cmd_.data[4],
+    };
+  }
+
 private:
   using enum CommandCtrl;
 
@@ -748,9 +1192,21 @@ private:
     return v;
   }
 
+  inline float nextF32()
+  {
+    u32 bits = next();
+    float v;
+    memcpy(&v, &bits, sizeof(float));
+
+    return v;
+  }
+
   FrontendCommands *cmds_;
   i32 offset_;
   DrawParams draw_params_;
+  DrawIndirectParams draw_indirect_params_;
+  DispatchParams dispatch_params_;
+  DispatchIndirectParams dispatch_indirect_params_;
   CopyCommand copy_cmd_;
 };
 
@@ -0,0 +1,219 @@
+#include <gas/init.hpp>
+#include <gas/shader_compiler.hpp>
+#include <gas/gas_gpu_algorithms.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace {
+
+using namespace gas;
+
+struct BenchContext {
+  GPURuntime *gpu;
+  GPUQueue queue;
+  CommandEncoder *enc;
+};
+
+template <typename Fn>
+void runBenchmark(BenchContext &ctx, const char *name,
+                  u32 num_elements, i32 num_iters, Fn &&fn)
+{
+  auto encodeAndSubmit = [&]() {
+    ctx.enc->beginEncoding();
+    ComputePassEncoder compute_enc = ctx.enc->beginComputePass();
+    fn(compute_enc);
+    ctx.enc->endComputePass(compute_enc);
+    ctx.enc->endEncoding();
+
+    ctx.gpu->submit(ctx.queue, *ctx.enc);
+    ctx.gpu->waitUntilWorkFinished(ctx.queue);
+  };
+
+  // Warm up pipelines & tmp buffers
+  encodeAndSubmit();
+
+  auto start = std::chrono::steady_clock::now();
+  for (i32 i = 0; i < num_iters; i++) {
+    encodeAndSubmit();
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  double secs = std::chrono::duration<double>(end - start).count();
+  double elems_per_sec = (double)num_elements * num_iters / secs;
+
+  printf("%-20s %10u elems  %8.3f ms / iter  %8.3f Gelems / sec\n",
+         name, num_elements, 1000.0 * secs / num_iters,
+         elems_per_sec / 1e9);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+  using namespace gas;
+
+  u32 num_elements = 1 << 22;
+  i32 num_iters = 100;
+  if (argc > 1) {
+    num_elements = (u32)strtoul(argv[1], nullptr, 10);
+  }
+  if (argc > 2) {
+    num_iters = atoi(argv[2]);
+  }
+
+  GPUAPISelect api_select = InitSystem::autoSelectAPI();
+  GPULib *gpu_lib = InitSystem::loadAPILib(api_select);
+  GPUAPI *gpu_api = InitSystem::initAPI(api_select, gpu_lib, {
+    .enableValidation = false,
+    .runtimeErrorsAreFatal = true,
+  });
+
+  GPURuntime *gpu = gpu_api->createRuntime(0);
+
+  ShaderCompilerLib shaderc_lib = InitSystem::loadShaderCompiler();
+  ShaderCompiler *shaderc = shaderc_lib.createCompiler();
+
+  GPUAlgorithms::init(gpu, shaderc);
+
+  GPUQueue main_queue = gpu->getMainQueue();
+
+  u32 num_bytes = num_elements * (u32)sizeof(u32);
+  auto createStorageBuffer = [&]() {
+    return gpu->createBuffer({
+      .numBytes = num_bytes,
+      .usage = BufferUsage::ShaderStorage | BufferUsage::CopyDst,
+    });
+  };
+
+  Buffer keys = createStorageBuffer();
+  Buffer values = createStorageBuffer();
+  Buffer flags = createStorageBuffer();
+  Buffer output = createStorageBuffer();
+  Buffer count = gpu->createBuffer({
+    .numBytes = 256,
+    .usage = BufferUsage::ShaderStorage,
+  });
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue);
+
+  { // Fill inputs with random keys and ~50% set flags
+    std::mt19937 rng(0);
+
+    Buffer staging = gpu->createStagingBuffer(3 * num_bytes);
+    void *staging_ptr;
+    gpu->prepareStagingBuffers(1, &staging, &staging_ptr);
+
+    u32 *keys_ptr = (u32 *)staging_ptr;
+    u32 *values_ptr = keys_ptr + num_elements;
+    u32 *flags_ptr = values_ptr + num_elements;
+    for (u32 i = 0; i < num_elements; i++) {
+      keys_ptr[i] = rng();
+      values_ptr[i] = i;
+      flags_ptr[i] = rng() & 1;
+    }
+
+    gpu->flushStagingBuffers(1, &staging);
+
+    enc.beginEncoding();
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+    copy_enc.copyBufferToBuffer(staging, keys, 0, 0, num_bytes);
+    copy_enc.copyBufferToBuffer(staging, values, num_bytes, 0, num_bytes);
+    copy_enc.copyBufferToBuffer(staging, flags, 2 * num_bytes, 0, num_bytes);
+    enc.endCopyPass(copy_enc);
+    enc.endEncoding();
+
+    gpu->submit(main_queue, enc);
+    gpu->waitUntilWorkFinished(main_queue);
+
+    gpu->destroyStagingBuffer(staging);
+  }
+
+  GPUAlgorithms::ExclusiveScan scan = GPUAlgorithms::createExclusiveScan(
+      gpu, {
+    .input = flags,
+    .output = output,
+    .maxNumElements = num_elements,
+  });
+
+  GPUAlgorithms::SegmentedReduce reduce =
+      GPUAlgorithms::createSegmentedReduce(gpu, {
+    .values = flags,
+    .segmentOffsets = output,
+    .output = count,
+  });
+
+  GPUAlgorithms::RadixSort sort = GPUAlgorithms::createRadixSort(gpu, {
+    .keys = keys,
+    .values = values,
+    .maxNumElements = num_elements,
+  });
+
+  GPUAlgorithms::StreamCompaction compaction =
+      GPUAlgorithms::createStreamCompaction(gpu, {
+    .input = values,
+    .flags = flags,
+    .output = output,
+    .outputCount = count,
+    .maxNumElements = num_elements,
+  });
+
+  BenchContext ctx {
+    .gpu = gpu,
+    .queue = main_queue,
+    .enc = &enc,
+  };
+
+  runBenchmark(ctx, "ExclusiveScan", num_elements, num_iters,
+    [&](ComputePassEncoder &compute_enc) {
+      GPUAlgorithms::exclusiveScan(compute_enc, scan, num_elements);
+    });
+
+  runBenchmark(ctx, "SegmentedReduce", num_elements, num_iters,
+    [&](ComputePassEncoder &compute_enc) {
+      // Sum the whole input as a single segment (output[0] == 0 after
+      // the scan benchmark)
+      GPUAlgorithms::segmentedReduce(compute_enc, reduce, num_elements, 1);
+    });
+
+  runBenchmark(ctx, "StreamCompaction", num_elements, num_iters,
+    [&](ComputePassEncoder &compute_enc) {
+      GPUAlgorithms::streamCompaction(compute_enc, compaction, num_elements);
+    });
+
+  runBenchmark(ctx, "RadixSort32", num_elements, num_iters,
+    [&](ComputePassEncoder &compute_enc) {
+      GPUAlgorithms::radixSort(compute_enc, sort, num_elements);
+    });
+
+  runBenchmark(ctx, "RadixSort16", num_elements, num_iters,
+    [&](ComputePassEncoder &compute_enc) {
+      GPUAlgorithms::radixSort(compute_enc, sort, num_elements, 16);
+    });
+
+  GPUAlgorithms::destroyStreamCompaction(gpu, compaction);
+  GPUAlgorithms::destroyRadixSort(gpu, sort);
+  GPUAlgorithms::destroySegmentedReduce(gpu, reduce);
+  GPUAlgorithms::destroyExclusiveScan(gpu, scan);
+
+  gpu->destroyCommandEncoder(enc);
+
+  gpu->destroyBuffer(count);
+  gpu->destroyBuffer(output);
+  gpu->destroyBuffer(flags);
+  gpu->destroyBuffer(values);
+  gpu->destroyBuffer(keys);
+
+  GPUAlgorithms::shutdown(gpu);
+
+  shaderc_lib.destroyCompiler(shaderc);
+  InitSystem::unloadShaderCompiler(shaderc_lib);
+
+  gpu_api->destroyRuntime(gpu);
+  gpu_api->shutdown();
+  InitSystem::unloadAPILib(gpu_lib);
+
+  return 0;
+}
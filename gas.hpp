@@ -7,6 +7,7 @@
 #include <madrona/stack_alloc.hpp>
 
 #include <cassert>
+#include <cstring>
 
 namespace gas {
 
@@ -83,6 +84,16 @@ struct ComputeShader : GenHandle<ComputeShader> {
   u16 id = 0;
 };
 
+struct RenderBundle : GenHandle<RenderBundle> {
+  u16 gen = 0;
+  u16 id = 0;
+};
+
+struct QuerySet : GenHandle<QuerySet> {
+  u16 gen = 0;
+  u16 id = 0;
+};
+
 struct BackendHandle {
   union {
     void *ptr;
@@ -102,10 +113,52 @@ struct MappedTmpBuffer {
   u8 *ptr;
 };
 
+struct PackedDrawData {
+  u8 *ptr;
+  u32 instanceOffset;
+};
+
+// dstOffset and numBytes must be multiples of 4
+struct ScatterRegion {
+  u32 dstOffset;
+  u32 numBytes;
+  const void *data;
+};
+
+// Structure of arrays input to RasterPassEncoder::encodeDraws, each
+// non-null array holds numDraws values. Null shader and param block arrays
+// keep the currently set values, null offsets default to 0 and null
+// numInstances to 1, like draw and drawIndexed. Vertex and index buffers
+// come from the encoder's current state.
+struct DrawBatch {
+  u32 numDraws = 0;
+  bool indexed = false;
+  const RasterShader *shaders = nullptr;
+  const ParamBlock *paramBlocks[3] = {};
+  const u32 *vertexOffsets = nullptr;
+  const u32 *indexOffsets = nullptr;
+  const u32 *numTriangles = nullptr;
+  const u32 *instanceOffsets = nullptr;
+  const u32 *numInstances = nullptr;
+  // numDrawDataBytes per draw, tightly packed. Each draw's data is copied
+  // as if passed to RasterPassEncoder::drawData.
+  const void *drawData = nullptr;
+  u32 numDrawDataBytes = 0;
+};
+
 struct GPUQueue {
   i32 id = -1;
 };
 
+// Returned by GPURuntime::submit. Submissions on other queues can pass it
+// as a wait token to be ordered after this submission.
+struct GPUSubmitToken {
+  i32 queue = -1;
+  u64 id = 0;
+
+  inline bool null() const { return queue == -1; }
+};
+
 enum class ErrorStatus : u32 {
   None        = 0,
   TableFull   = 1 << 0,
@@ -121,6 +174,8 @@ enum class BufferUsage : u16 {
   DrawVertex    = 1 << 3,
   ShaderUniform = 1 << 4,
   ShaderStorage = 1 << 5,
+  IndirectArgs  = 1 << 6,
+  QueryResolve  = 1 << 7,
 };
 inline BufferUsage & operator|=(BufferUsage &a, BufferUsage b);
 inline BufferUsage operator|(BufferUsage a, BufferUsage b);
@@ -141,7 +196,32 @@ enum class TextureFormat : u16 {
   BGRA8_UNorm,
   BGRA8_SRGB,
   Depth32_Float,
-};
+  R32_UInt,
+  R32_Float,
+  RGBA16_Float,
+  RGBA32_Float,
+  // Depth24Plus formats can't be copied. The stencil formats can only be
+  // rendered to, not sampled or copied as a whole.
+  Depth16_UNorm,
+  Depth24Plus,
+  Depth24Plus_Stencil8,
+  // Requires device support
+  Depth32_Float_Stencil8,
+};
+
+// Output formats for CopyPassEncoder::copyTextureToBufferConverted
+enum class TextureConversion : u32 {
+  // Linear luminance of RGBA / BGRA color textures, 1 byte per texel
+  Luminance_UNorm8,
+  // Depth32_Float to 16 bit normalized depth, 2 bytes per texel
+  Depth_UNorm16,
+  // First channel of float color textures as a half, 2 bytes per texel
+  R16_Float,
+  // All channels of float color textures as halves, 8 bytes per texel
+  RGBA16_Float,
+};
+
+inline u32 textureConversionBytesPerTexel(TextureConversion conversion);
 
 enum class TextureUsage : u16 {
   None             = 0,
@@ -163,7 +243,12 @@ struct TextureInit {
   u16 height;
   u16 depth = 0;
   u16 numMipLevels = 1;
+  // Multisampled textures must be 2D with a single mip level
+  u16 numSamples = 1;
   TextureUsage usage = TextureUsage::ShaderSampled;
+  // Only holds the base mip level. For formats CopyPassEncoder::generateMips
+  // supports, the rest of the mip chain is generated on the GPU after
+  // upload. Other formats only have the base level initialized.
   StagingHandle initData = {};
 };
 
@@ -208,6 +293,12 @@ struct SamplerInit {
   float mipClamp[2] = { 0.f, 32.f };
 };
 
+// Occlusion query setup. Each query resolves to a u64 that is zero if no
+// samples passed the depth / stencil tests while the query was active.
+struct QuerySetInit {
+  u32 numQueries;
+};
+
 // Creating bind groups
 struct ParamBlockTypeID {
   inline ParamBlockTypeID(UUID uuid);
@@ -242,6 +333,15 @@ enum class TextureBindingType : u16 {
   Texture2D,
   Texture3D,
   DepthTexture2D,
+  StorageTexture1D,
+  StorageTexture2D,
+  StorageTexture3D,
+};
+
+enum class StorageTextureAccess : u16 {
+  WriteOnly,
+  ReadOnly,
+  ReadWrite,
 };
 
 struct BufferBindingConfig {
@@ -258,6 +358,10 @@ struct TextureBindingConfig {
   ShaderStage shaderUsage =
     ShaderStage::Vertex | ShaderStage::Fragment | ShaderStage::Compute;
   u16 numTextures = 1;
+  // Storage texture bindings only. Bound textures must be created with
+  // TextureUsage::ShaderStorage, this format and a single mip level.
+  TextureFormat storageFormat = TextureFormat::None;
+  StorageTextureAccess storageAccess = StorageTextureAccess::WriteOnly;
 };
 
 struct SamplerBindingConfig {
@@ -315,6 +419,10 @@ struct DepthAttachmentConfig {
   AttachmentLoadMode loadMode = AttachmentLoadMode::Clear;
   AttachmentStoreMode storeMode = AttachmentStoreMode::Store;
   float clearValue = 0.f;
+  // Ignored for formats without stencil
+  AttachmentLoadMode stencilLoadMode = AttachmentLoadMode::Clear;
+  AttachmentStoreMode stencilStoreMode = AttachmentStoreMode::Store;
+  u32 stencilClearValue = 0;
 };
 
 struct ColorAttachmentConfig {
@@ -328,12 +436,21 @@ struct RasterPassInterfaceInit {
   UUID uuid;
   DepthAttachmentConfig depthAttachment = {};
   Span<const ColorAttachmentConfig> colorAttachments = {};
+  // Every attachment must have this many samples
+  u16 numSamples = 1;
 };
 
 struct RasterPassInit {
   RasterPassInterface interface;
   Texture depthAttachment = {};
   Span<const Texture> colorAttachments = {};
+  // Single sample textures the multisampled color attachments are
+  // resolved into at the end of the pass, either empty or one per color
+  // attachment. Null entries aren't resolved. Can hold the swapchain's
+  // proxy attachment.
+  Span<const Texture> resolveAttachments = {};
+  // Queries written by RasterPassEncoder::beginOcclusionQuery
+  QuerySet occlusionQuerySet = {};
 };
 
 // Creating shaders
@@ -355,8 +472,33 @@ enum class VertexFormat : u16 {
   Vec2_F32,
   Vec3_F32,
   Vec4_UNorm8,
-};
-
+  Vec4_F32,
+  Vec2_F16,
+  Vec4_F16,
+  Vec4_SNorm8,
+  Vec2_UNorm16,
+  Vec4_UNorm16,
+  Vec2_SNorm16,
+  Vec4_SNorm16,
+  Vec2_U8,
+  Vec4_U8,
+  Vec2_U16,
+  Vec4_U16,
+  Scalar_U32,
+  Vec2_U32,
+  Vec3_U32,
+  Vec4_U32,
+  // xyz 10 bits each, w 2 bits
+  Vec4_UNorm10_10_10_2,
+};
+
+enum class VertexStepMode : u16 {
+  Vertex,
+  Instance,
+};
+
+// Attributes are assigned consecutive shader locations in order, across
+// all of a shader's vertex buffers
 struct VertexAttributeConfig {
   u16 offset;
   VertexFormat format;
@@ -365,6 +507,9 @@ struct VertexAttributeConfig {
 struct VertexBufferConfig {
   u32 stride;
   Span<const VertexAttributeConfig> attributes;
+  // Instance buffers advance once per instance, starting at the draw's
+  // instance offset
+  VertexStepMode stepMode = VertexStepMode::Vertex;
 };
 
 enum class DepthCompare : u16 {
@@ -373,12 +518,48 @@ enum class DepthCompare : u16 {
   Disabled,
 };
 
+enum class StencilCompare : u16 {
+  Always,
+  Never,
+  Equal,
+  NotEqual,
+  Less,
+  LessOrEqual,
+  Greater,
+  GreaterOrEqual,
+};
+
+enum class StencilOp : u16 {
+  Keep,
+  Zero,
+  Replace,
+  Invert,
+  IncrementClamp,
+  DecrementClamp,
+  IncrementWrap,
+  DecrementWrap,
+};
+
+// Compares against RasterPassEncoder::setStencilReference
+struct StencilFaceConfig {
+  StencilCompare compare = StencilCompare::Always;
+  StencilOp failOp = StencilOp::Keep;
+  StencilOp depthFailOp = StencilOp::Keep;
+  StencilOp passOp = StencilOp::Keep;
+};
+
 enum class CullMode : u16 {
   None,
   FrontFace,
   BackFace,
 };
 
+enum class PrimitiveTopology : u16 {
+  TriangleList,
+  LineList,
+  PointList,
+};
+
 enum class BlendOperation : u16 {
   None,
   Add,
@@ -396,6 +577,9 @@ enum class BlendFactor : u16 {
   OneMinusDst,
   DstAlpha,
   OneMinusDstAlpha,
+  // RasterPassEncoder::setBlendConstant
+  Constant,
+  OneMinusConstant,
 };
 
 struct BlendingConfig {
@@ -415,6 +599,10 @@ struct RasterHWConfig {
   int depthBias = 0;
   float depthBiasSlope = 0.f;
   float depthBiasClamp = 0.f;
+  StencilFaceConfig stencilFront = {};
+  StencilFaceConfig stencilBack = {};
+  u32 stencilReadMask = 0xFF;
+  u32 stencilWriteMask = 0xFF;
   CullMode cullMode = CullMode::BackFace;
   Span<const BlendingConfig> blending = {};
 };
@@ -426,14 +614,28 @@ struct RasterShaderInit {
   RasterPassInterfaceID rasterPass;
   Span<const ParamBlockTypeID> paramBlockTypes = {};
   uint32_t numPerDrawBytes = 0;
+  // Read per draw data from a storage buffer of tightly packed
+  // numPerDrawBytes elements indexed by the instance index, rather than a
+  // uniform bound at a new 256 byte aligned offset for every draw. See
+  // RasterPassEncoder::packedDrawData.
+  bool packDrawData = false;
   Span<const VertexBufferConfig> vertexBuffers = {};
+  // Draws with line and point list shaders interpret num_triangles as the
+  // number of lines / points
+  PrimitiveTopology topology = PrimitiveTopology::TriangleList;
   RasterHWConfig rasterConfig = {};
 };
 
 struct ComputeShaderInit {
-  Span<const uint8_t> byteCode;
+  ShaderByteCode byteCode;
   const char *entry;
   Span<const ParamBlockTypeID> paramBlockTypes = {};
+  uint32_t numPerDispatchBytes = 0;
+};
+
+// Render bundles can only be executed in passes with this interface
+struct RenderBundleInit {
+  RasterPassInterfaceID rasterPass;
 };
 
 // Presenting Handles
@@ -472,6 +674,7 @@ enum class CommandCtrl : u32 {
   RasterPass             = 1 << 0,
   ComputePass            = 1 << 1,
   CopyPass               = 1 << 2,
+  TransientRasterPass    = 1 << 3,
 
   RasterDraw             = 1 << 0,
   RasterDrawIndexed      = 1 << 1,
@@ -492,6 +695,17 @@ enum class CommandCtrl : u32 {
   DrawVertexOffset       = 1 << 15,
   DrawInstanceOffset     = 1 << 16,
   DrawNumInstances       = 1 << 17,
+  RasterDrawIndirect     = 1 << 18,
+  RasterDrawIndexedIndirect = 1 << 19,
+  DrawIndirectBuffer     = 1 << 20,
+  DrawIndirectOffset     = 1 << 21,
+  RasterMultiDrawIndexedIndirect = 1 << 22,
+  RasterExecuteBundles   = 1 << 23,
+  RasterViewport         = 1 << 24,
+  RasterBlendConstant    = 1 << 25,
+  RasterStencilReference = 1 << 26,
+  RasterBeginOcclusionQuery = 1 << 27,
+  RasterEndOcclusionQuery = 1 << 28,
 
   Dispatch               = 1 << 0,
   ComputeShader          = 1 << 1,
@@ -501,31 +715,55 @@ enum class CommandCtrl : u32 {
   ComputeNumBlocksX      = 1 << 5,
   ComputeNumBlocksY      = 1 << 6,
   ComputeNumBlocksZ      = 1 << 7,
+  DispatchIndirect       = 1 << 8,
+  ComputeIndirectBuffer  = 1 << 9,
+  ComputeIndirectOffset  = 1 << 10,
+  ComputeDataBuffer      = 1 << 11,
+  ComputeDataOffset      = 1 << 12,
 
   CopyCmdBufferToBuffer  = 1 << 0,
   CopyCmdBufferToTexture = 1 << 1,
   CopyCmdTextureToBuffer = 1 << 2,
   CopyCmdBufferClear     = 1 << 3,
-
-  CopyB2BSrcBuffer       = 1 << 4,
-  CopyB2BDstBuffer       = 1 << 5,
-  CopyB2BSrcOffset       = 1 << 6,
-  CopyB2BDstOffset       = 1 << 7,
-  CopyB2BNumBytes        = 1 << 8,
-
-  CopyB2TSrcBuffer       = 1 << 4,
-  CopyB2TDstTexture      = 1 << 5,
-  CopyB2TSrcOffset       = 1 << 6,
-  CopyB2TDstMipLevel     = 1 << 7,
-
-  CopyT2BSrcTexture      = 1 << 4,
-  CopyT2BDstBuffer       = 1 << 5,
-  CopyT2BSrcMipLevel     = 1 << 6,
-  CopyT2BDstOffset       = 1 << 7,
-
-  CopyClearBuffer        = 1 << 4,
-  CopyClearOffset        = 1 << 5,
-  CopyClearNumBytes      = 1 << 6,
+  CopyCmdGenerateMips    = 1 << 4,
+  CopyCmdScatterUpdate   = 1 << 5,
+  CopyCmdTextureToBufferConverted = 1 << 6,
+  CopyCmdResolveQuerySet = 1 << 7,
+
+  CopyB2BSrcBuffer       = 1 << 8,
+  CopyB2BDstBuffer       = 1 << 9,
+  CopyB2BSrcOffset       = 1 << 10,
+  CopyB2BDstOffset       = 1 << 11,
+  CopyB2BNumBytes        = 1 << 12,
+
+  CopyB2TSrcBuffer       = 1 << 8,
+  CopyB2TDstTexture      = 1 << 9,
+  CopyB2TSrcOffset       = 1 << 10,
+  CopyB2TDstMipLevel     = 1 << 11,
+
+  CopyT2BSrcTexture      = 1 << 8,
+  CopyT2BDstBuffer       = 1 << 9,
+  CopyT2BSrcMipLevel     = 1 << 10,
+  CopyT2BDstOffset       = 1 << 11,
+  CopyT2BConversion      = 1 << 12,
+
+  CopyClearBuffer        = 1 << 8,
+  CopyClearOffset        = 1 << 9,
+  CopyClearNumBytes      = 1 << 10,
+
+  CopyMipsTexture        = 1 << 8,
+
+  CopyScatterDstBuffer   = 1 << 8,
+  CopyScatterSrcBuffer   = 1 << 9,
+  CopyScatterSrcOffset   = 1 << 10,
+  CopyScatterNumBytes    = 1 << 11,
+  CopyScatterNumRegions  = 1 << 12,
+
+  CopyResolveQuerySet    = 1 << 8,
+  CopyResolveFirstQuery  = 1 << 9,
+  CopyResolveNumQueries  = 1 << 10,
+  CopyResolveDstBuffer   = 1 << 11,
+  CopyResolveDstOffset   = 1 << 12,
 };
 inline CommandCtrl & operator|=(CommandCtrl &a, CommandCtrl b);
 inline CommandCtrl operator|(CommandCtrl a, CommandCtrl b);
@@ -545,6 +783,8 @@ struct DrawCommand {
   u32 vertexOffset = 0;
   u32 instanceOffset = 0;
   u32 numInstances = 1;
+  Buffer indirectBuffer = {};
+  u32 indirectOffset = 0;
 };
 
 struct ComputeCommand {
@@ -553,6 +793,10 @@ struct ComputeCommand {
   u32 numBlocksX = 0;
   u32 numBlocksY = 1;
   u32 numBlocksZ = 1;
+  Buffer indirectBuffer = {};
+  u32 indirectOffset = 0;
+  Buffer dataBuffer = {};
+  u32 dataOffset = 0;
 };
 
 struct CopyCommand {
@@ -574,6 +818,8 @@ class CommandWriter {
 public:
   inline u32 * reserve(GPURuntime *gpu);
   inline void writeU32(GPURuntime *gpu, u32 v);
+  inline void writeF32(GPURuntime *gpu, float v);
+  inline void write(GPURuntime *gpu, const u32 *words, u32 num_words);
 
   template <typename T>
   inline void id(GPURuntime *gpu, T id);
@@ -584,6 +830,7 @@ private:
   u32 offset_;
 
 friend class CommandEncoder;
+friend class RenderBundleEncoder;
 friend class GPURuntime;
 };
 
@@ -609,6 +856,16 @@ public:
   inline void setDrawScissors(u32 offset_x, u32 offset_y,
                               u32 width, u32 height);
 
+  // Like scissors, these persist across draws and bundles for the rest of
+  // the pass, and redundant updates are dropped. Passes start with a
+  // viewport covering the attachments, a zero blend constant and a zero
+  // stencil reference.
+  inline void setViewport(float offset_x, float offset_y,
+                          float width, float height,
+                          float min_depth = 0.f, float max_depth = 1.f);
+  inline void setBlendConstant(Vector4 color);
+  inline void setStencilReference(u32 reference);
+
   inline void setShader(RasterShader shader);
   inline void setParamBlock(i32 idx, ParamBlock param_block);
   inline void setVertexBuffer(i32 idx, Buffer buffer);
@@ -621,6 +878,17 @@ public:
   template <typename T> T * drawData();
   template <typename T> void drawData(T v);
 
+  // Per draw data for shaders created with RasterShaderInit::packDrawData.
+  // Allocates num_instances consecutive elements of num_element_bytes,
+  // which must match the shader's numPerDrawBytes and array stride. Draw
+  // with the returned instanceOffset and instance i reads element i.
+  // num_element_bytes * num_instances can be at most
+  // GPUTmpMemBlock::BLOCK_SIZE, larger requests return a null ptr.
+  inline PackedDrawData packedDrawData(u32 num_element_bytes,
+                                       u32 num_instances = 1);
+  // Returns the instance offset to draw with
+  template <typename T> u32 packedDrawData(T v);
+
   inline void draw(u32 vertex_offset, u32 num_triangles);
   inline void drawIndexed(u32 vertex_offset,
                           u32 index_offset, u32 num_triangles);
@@ -631,34 +899,161 @@ public:
                                    u32 index_offset, u32 num_triangles,
                                    u32 instance_offset, u32 num_instances);
 
+  // Encodes batch.numDraws draws, equivalent to setting the batch's state
+  // and calling drawInstanced / drawIndexedInstanced for each, but with
+  // dirty bits computed over whole arrays rather than per call
+  inline void encodeDraws(const DrawBatch &batch);
+
+  // args must hold 4 u32s (num vertices, num instances, vertex offset,
+  // instance offset) at offset and be created with BufferUsage::IndirectArgs.
+  // Devices without indirect first instance support skip indirect draws
+  // with a non-zero instance offset.
+  inline void drawIndirect(Buffer args, u32 offset = 0);
+
+  // args must hold 5 u32s (num indices, num instances, index offset,
+  // vertex offset, instance offset) at offset and be created with
+  // BufferUsage::IndirectArgs. Matches GPUCulling::DrawIndexedIndirectArgs.
+  inline void drawIndexedIndirect(Buffer args, u32 offset = 0);
+
+  // Issues max_draws indexed indirect draws with args tightly packed from
+  // offset, of which only the first N execute, where N is the u32 at
+  // count_offset in count. Devices without native multi draw support
+  // emulate this with a compute pass before the raster pass, so both
+  // args and count must be created with BufferUsage::IndirectArgs |
+  // BufferUsage::ShaderStorage.
+  inline void multiDrawIndexedIndirect(Buffer args, u32 offset,
+                                       u32 max_draws,
+                                       Buffer count, u32 count_offset = 0);
+
+  // Replays pre-recorded draws. Like at the start of the pass, no draw
+  // state is bound afterwards: the shader, param blocks, buffers and draw
+  // data must be set again before the next draw.
+  inline void executeBundles(Span<const RenderBundle> bundles);
+
+  // Counts the samples passing the depth / stencil tests for the draws
+  // between begin and end into query_idx of the pass's occlusionQuerySet.
+  // Queries can't be nested and each query can only be written once per
+  // pass.
+  inline void beginOcclusionQuery(u32 query_idx);
+  inline void endOcclusionQuery();
+
 private:
+  inline u32 * encodeDrawState(CommandCtrl draw_type);
+
   inline void encodeDraw(CommandCtrl draw_type, u32 vertex_offset,
                          u32 index_offset, u32 num_triangles,
                          u32 instance_offset, u32 num_instances);
 
+  inline void encodeDrawIndirect(CommandCtrl draw_type,
+                                 Buffer args, u32 offset);
+  inline void encodeIndirectArgs(Buffer args, u32 offset);
+
   inline u32 allocGPUTmpInput(u32 num_bytes, u32 alignment);
 
   inline RasterPassEncoder(GPURuntime *gpu,
                            CommandWriter writer,
+                           u32 *pass_draw_types,
                            GPUQueue queue,
                            GPUTmpMemBlock gpu_input);
 
   GPURuntime *gpu_;
   CommandWriter writer_;
+  // Written after the RasterPass header so the backend knows which draw
+  // types need setup before the pass begins
+  u32 *pass_draw_types_;
   GPUQueue queue_;
   GPUTmpMemBlock gpu_input_;
   CommandCtrl ctrl_;
   DrawCommand state_;
   std::array<u32, 4> draw_scissors_;
+  std::array<float, 6> viewport_;
+  Vector4 blend_constant_;
+  u32 stencil_reference_;
 
 friend class CommandEncoder;
+friend class RenderBundleEncoder;
+};
+
+// Records draws once, to be replayed every frame with
+// RasterPassEncoder::executeBundles without re-encoding them. Bundles can't
+// use draw data, so per draw data has to come from param blocks or vertex
+// buffers.
+class RenderBundleEncoder {
+public:
+  inline void setShader(RasterShader shader);
+  inline void setParamBlock(i32 idx, ParamBlock param_block);
+  inline void setVertexBuffer(i32 idx, Buffer buffer);
+  inline void setIndexBufferU32(Buffer buffer);
+  inline void setIndexBufferU16(Buffer buffer);
+
+  inline void draw(u32 vertex_offset, u32 num_triangles);
+  inline void drawIndexed(u32 vertex_offset,
+                          u32 index_offset, u32 num_triangles);
+
+  inline void drawInstanced(u32 vertex_offset, u32 num_triangles,
+                            u32 instance_offset, u32 num_instances);
+  inline void drawIndexedInstanced(u32 vertex_offset,
+                                   u32 index_offset, u32 num_triangles,
+                                   u32 instance_offset, u32 num_instances);
+
+  inline void drawIndirect(Buffer args, u32 offset = 0);
+  inline void drawIndexedIndirect(Buffer args, u32 offset = 0);
+
+private:
+  inline RenderBundleEncoder(GPURuntime *gpu, RenderBundleInit init);
+
+  inline void endEncoding();
+
+  RenderBundleInit init_;
+  FrontendCommands *cmds_head_;
+  RasterPassEncoder raster_enc_;
+
+friend class GPURuntime;
 };
 
 class ComputePassEncoder {
 public:
   inline ComputePassEncoder();
 
+  inline ParamBlock createTemporaryParamBlock(
+      ParamBlockInit init);
+
+  inline void setShader(ComputeShader shader);
+  inline void setParamBlock(i32 idx, ParamBlock param_block);
+
+  inline MappedTmpBuffer tmpBuffer(u32 num_bytes, u32 alignment = 256);
+
+  // Data for the next dispatches, bound after the shader's param blocks.
+  // The current shader must be created with numPerDispatchBytes > 0.
+  inline void * dispatchData(u32 num_bytes);
+  template <typename T> T * dispatchData();
+  template <typename T> void dispatchData(T v);
+
+  inline void dispatch(u32 num_blocks_x,
+                       u32 num_blocks_y = 1,
+                       u32 num_blocks_z = 1);
+
+  // args must hold 3 u32s (num blocks X, Y, Z) at offset and be created
+  // with BufferUsage::IndirectArgs
+  inline void dispatchIndirect(Buffer args, u32 offset = 0);
+
 private:
+  inline u32 * encodeDispatchState(CommandCtrl dispatch_type);
+
+  inline u32 allocGPUTmpInput(u32 num_bytes, u32 alignment);
+
+  inline ComputePassEncoder(GPURuntime *gpu,
+                            CommandWriter writer,
+                            GPUQueue queue,
+                            GPUTmpMemBlock gpu_input);
+
+  GPURuntime *gpu_;
+  CommandWriter writer_;
+  GPUQueue queue_;
+  GPUTmpMemBlock gpu_input_;
+  CommandCtrl ctrl_;
+  ComputeCommand state_;
+
 friend class CommandEncoder;
 };
 
@@ -678,11 +1073,46 @@ public:
                                   u32 src_mip_level = 0,
                                   u32 dst_offset = 0);
 
+  // Converts src on the GPU while copying it, so only the converted bytes
+  // need to be read back. Texels are tightly packed with
+  // textureConversionBytesPerTexel(conversion) bytes each, and the total
+  // size is rounded up to a multiple of 4 bytes. Only 2D textures are
+  // supported, and src must be created with TextureUsage::ShaderSampled.
+  inline void copyTextureToBufferConverted(Texture src, Buffer dst,
+                                           TextureConversion conversion,
+                                           u32 src_mip_level = 0,
+                                           u32 dst_offset = 0);
+
   inline void clearBuffer(Buffer buffer, u32 offset, u32 num_bytes);
 
+  // Fills mip levels 1 and up of texture by repeatedly downsampling the
+  // previous level. Only 2D RGBA8 / BGRA8 (UNorm or SRGB) and RGBA16_Float
+  // textures are supported; the other float formats aren't filterable.
+  inline void generateMips(Texture texture);
+
+  // Writes many small regions of dst at once: the region data is packed
+  // into tmp staging memory and applied by a single compute dispatch
+  // rather than one copy per region. Regions that don't fit in a single
+  // tmp staging block are split across several dispatches. dst must be
+  // created with BufferUsage::ShaderStorage.
+  inline void scatterUpdate(Buffer dst, Span<const ScatterRegion> regions);
+
+  // Writes num_queries u64 query results to dst, which must be created
+  // with BufferUsage::QueryResolve. dst_offset must be a multiple of 256.
+  inline void resolveQuerySet(QuerySet queries, u32 first_query,
+                              u32 num_queries, Buffer dst,
+                              u32 dst_offset = 0);
+
   inline MappedTmpBuffer tmpBuffer(u32 num_bytes, u32 alignment = 16);
 
 private:
+  inline u32 * encodeTextureToBuffer(CommandCtrl cmd, Texture src,
+                                     Buffer dst, u32 src_mip_level,
+                                     u32 dst_offset);
+
+  inline void encodeScatterUpdate(Buffer dst, MappedTmpBuffer packed,
+                                  u32 num_bytes, u32 num_regions);
+
   inline CopyPassEncoder(GPURuntime *gpu, CommandWriter writer,
                          GPUQueue queue, GPUTmpMemBlock tmp_staging);
 
@@ -704,6 +1134,17 @@ public:
   inline void endEncoding();
 
   inline RasterPassEncoder beginRasterPass(RasterPass render_pass);
+  // Begins a pass without a pre-created RasterPass. Attachment views are
+  // looked up when the commands are submitted, so render targets can
+  // change every frame without creating and destroying RasterPass objects.
+  // resolve_attachments and occlusion_query_set work like the matching
+  // RasterPassInit fields.
+  inline RasterPassEncoder beginRasterPass(
+      RasterPassInterface interface,
+      Span<const Texture> color_attachments,
+      Texture depth_attachment = {},
+      Span<const Texture> resolve_attachments = {},
+      QuerySet occlusion_query_set = {});
   inline void endRasterPass(RasterPassEncoder &render_enc);
 
   inline ComputePassEncoder beginComputePass();
@@ -801,6 +1242,16 @@ public:
                               Sampler *handles_out) = 0;
   virtual void destroySamplers(i32 num_samplers, Sampler *samplers) = 0;
 
+  // ==== Create & destroy query sets =========================================
+  inline QuerySet createQuerySet(QuerySetInit init);
+  inline void destroyQuerySet(QuerySet query_set);
+
+  virtual void createQuerySets(i32 num_query_sets,
+                               const QuerySetInit *query_set_inits,
+                               QuerySet *handles_out) = 0;
+  virtual void destroyQuerySets(i32 num_query_sets,
+                                QuerySet *query_sets) = 0;
+
   // ==== Create & destroy parameter blocks ===================================
   inline ParamBlockType createParamBlockType(
       ParamBlockTypeInit init);
@@ -861,6 +1312,23 @@ public:
   virtual void destroyRasterShaders(i32 num_shaders, RasterShader *shaders)
       = 0;
 
+  inline ComputeShader createComputeShader(ComputeShaderInit init);
+  inline void destroyComputeShader(ComputeShader shader);
+
+  virtual void createComputeShaders(i32 num_shaders,
+                                    const ComputeShaderInit *shader_inits,
+                                    ComputeShader *handles_out) = 0;
+  virtual void destroyComputeShaders(i32 num_shaders, ComputeShader *shaders)
+      = 0;
+
+  // ==== Record & destroy render bundles =====================================
+  inline RenderBundleEncoder beginRenderBundle(RenderBundleInit init);
+  inline RenderBundle endRenderBundle(RenderBundleEncoder &enc);
+  inline void destroyRenderBundle(RenderBundle bundle);
+
+  virtual void destroyRenderBundles(i32 num_bundles, RenderBundle *bundles)
+      = 0;
+
   // ==== Command recording & submission ======================================
   inline GPUQueue getMainQueue();
   inline GPUQueue getUploadQueue();
@@ -868,7 +1336,12 @@ public:
   inline CommandEncoder createCommandEncoder(GPUQueue queue);
   inline void destroyCommandEncoder(CommandEncoder &encoder);
 
-  inline void submit(GPUQueue queue, CommandEncoder &enc);
+  inline GPUSubmitToken submit(GPUQueue queue, CommandEncoder &enc,
+      Span<const GPUSubmitToken> wait_tokens = {});
+
+  // Null tokens count as finished, waiting on one returns immediately
+  virtual bool isSubmitFinished(GPUSubmitToken token) = 0;
+  virtual void waitForSubmit(GPUSubmitToken token) = 0;
 
   virtual void waitUntilReady(GPUQueue queue) = 0;
   virtual void waitUntilWorkFinished(GPUQueue queue) = 0;
@@ -887,7 +1360,11 @@ public:
   ErrorStatus currentErrorStatus();
 
 protected:
-  virtual void submit(GPUQueue queue, FrontendCommands *cmds) = 0;
+  virtual GPUSubmitToken submit(GPUQueue queue, FrontendCommands *cmds,
+                                Span<const GPUSubmitToken> wait_tokens) = 0;
+
+  virtual RenderBundle createRenderBundle(RenderBundleInit init,
+                                          FrontendCommands *cmds) = 0;
 
   FrontendCommands * allocCommandBlock();
   void deallocCommandBlocks(FrontendCommands *cmds);
@@ -897,6 +1374,7 @@ protected:
 
 friend class CommandEncoder;
 friend class RasterPassEncoder;
+friend class RenderBundleEncoder;
 friend class ComputePassEncoder;
 friend class CopyPassEncoder;
 friend class CommandWriter;
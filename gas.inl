@@ -110,6 +110,26 @@ void CommandWriter::writeU32(GPURuntime *gpu, uint32_t v)
   *reserve(gpu) = v;
 }
 
+void CommandWriter::writeF32(GPURuntime *gpu, float v)
+{
+  u32 bits;
+  memcpy(&bits, &v, sizeof(float));
+  writeU32(gpu, bits);
+}
+
+void CommandWriter::write(GPURuntime *gpu, const u32 *words, u32 num_words)
+{
+  if ((size_t)offset_ + num_words <= cmds_->data.size()) [[likely]] {
+    memcpy(&cmds_->data[offset_], words, sizeof(u32) * num_words);
+    offset_ += num_words;
+    return;
+  }
+
+  for (u32 i = 0; i < num_words; i++) {
+    writeU32(gpu, words[i]);
+  }
+}
+
 template <typename T>
 void CommandWriter::id(GPURuntime *gpu, T t)
 {
@@ -158,6 +178,60 @@ void RasterPassEncoder::setDrawScissors(u32 offset_x, u32 offset_y,
   writer_.writeU32(gpu_, height);
 }
 
+void RasterPassEncoder::setViewport(float offset_x, float offset_y,
+                                    float width, float height,
+                                    float min_depth, float max_depth)
+{
+  if (offset_x == viewport_[0] &&
+      offset_y == viewport_[1] &&
+      width == viewport_[2] &&
+      height == viewport_[3] &&
+      min_depth == viewport_[4] &&
+      max_depth == viewport_[5]) {
+    return;
+  }
+
+  viewport_ = { offset_x, offset_y, width, height, min_depth, max_depth };
+
+  writer_.ctrl(gpu_, CommandCtrl::RasterViewport);
+  writer_.writeF32(gpu_, offset_x);
+  writer_.writeF32(gpu_, offset_y);
+  writer_.writeF32(gpu_, width);
+  writer_.writeF32(gpu_, height);
+  writer_.writeF32(gpu_, min_depth);
+  writer_.writeF32(gpu_, max_depth);
+}
+
+void RasterPassEncoder::setBlendConstant(Vector4 color)
+{
+  if (color.x == blend_constant_.x &&
+      color.y == blend_constant_.y &&
+      color.z == blend_constant_.z &&
+      color.w == blend_constant_.w) {
+    return;
+  }
+
+  blend_constant_ = color;
+
+  writer_.ctrl(gpu_, CommandCtrl::RasterBlendConstant);
+  writer_.writeF32(gpu_, color.x);
+  writer_.writeF32(gpu_, color.y);
+  writer_.writeF32(gpu_, color.z);
+  writer_.writeF32(gpu_, color.w);
+}
+
+void RasterPassEncoder::setStencilReference(u32 reference)
+{
+  if (reference == stencil_reference_) {
+    return;
+  }
+
+  stencil_reference_ = reference;
+
+  writer_.ctrl(gpu_, CommandCtrl::RasterStencilReference);
+  writer_.writeU32(gpu_, reference);
+}
+
 void RasterPassEncoder::setShader(RasterShader shader)
 {
   if (state_.shader == shader) {
@@ -278,6 +352,43 @@ void RasterPassEncoder::drawData(T v)
   *drawData<T>() = v;
 }
 
+PackedDrawData RasterPassEncoder::packedDrawData(u32 num_element_bytes,
+                                                 u32 num_instances)
+{
+  assert(num_element_bytes > 0 && num_element_bytes % 4 == 0);
+
+  // Like tmpBuffer, requests that can't fit in a single tmp input block
+  // fail rather than overrunning it
+  if ((u64)num_element_bytes * (u64)num_instances >
+      (u64)GPUTmpMemBlock::BLOCK_SIZE) [[unlikely]] {
+    assert(false);
+    return PackedDrawData {
+      .ptr = nullptr,
+      .instanceOffset = 0,
+    };
+  }
+
+  // Aligning to the element size (rather than 256 bytes) lets the element
+  // index be computed from the offset. The whole tmp buffer is bound, so
+  // no dirty bits are set unless this switches buffers.
+  u32 offset = allocGPUTmpInput(num_element_bytes * num_instances,
+                                num_element_bytes);
+
+  return PackedDrawData {
+    .ptr = gpu_input_.ptr + offset,
+    .instanceOffset = offset / num_element_bytes,
+  };
+}
+
+template <typename T>
+u32 RasterPassEncoder::packedDrawData(T v)
+{
+  PackedDrawData data = packedDrawData((u32)sizeof(T));
+  *(T *)data.ptr = v;
+
+  return data.instanceOffset;
+}
+
 void RasterPassEncoder::draw(u32 vertex_offset, u32 num_triangles)
 {
   drawInstanced(vertex_offset, num_triangles, 0, 1);
@@ -309,10 +420,262 @@ void RasterPassEncoder::drawIndexedInstanced(
              instance_offset, num_instances);
 }
 
-void RasterPassEncoder::encodeDraw(
-  CommandCtrl draw_type, u32 vertex_offset,
-  u32 index_offset, u32 num_triangles,
-  u32 instance_offset, u32 num_instances)
+void RasterPassEncoder::encodeDraws(const DrawBatch &batch)
+{
+  using enum CommandCtrl;
+
+  constexpr u32 MAX_CHUNK_DRAWS = 64;
+  // ctrl, 10 draw state words and 5 draw params
+  constexpr u32 MAX_DRAW_WORDS = 16;
+
+  assert(batch.numTriangles != nullptr);
+
+  u32 data_stride = utils::roundUp(batch.numDrawDataBytes, 256_u32);
+  assert(batch.drawData == nullptr ||
+         (data_stride > 0 && data_stride <= GPUTmpMemBlock::BLOCK_SIZE));
+
+  u32 max_chunk_draws = MAX_CHUNK_DRAWS;
+  if (batch.drawData != nullptr &&
+      max_chunk_draws * data_stride > GPUTmpMemBlock::BLOCK_SIZE) {
+    max_chunk_draws = GPUTmpMemBlock::BLOCK_SIZE / data_stride;
+  }
+
+  u32 draw_type = (u32)(batch.indexed ? RasterDrawIndexed : RasterDraw);
+
+  for (u32 chunk_start = 0; chunk_start < batch.numDraws;) {
+    u32 num_draws = batch.numDraws - chunk_start;
+    if (num_draws > max_chunk_draws) {
+      num_draws = max_chunk_draws;
+    }
+
+    // Each draw's data gets its own 256 byte aligned slice, like drawData.
+    // Allocated first because it can switch the tmp input buffer.
+    u32 data_offsets[MAX_CHUNK_DRAWS];
+    if (batch.drawData != nullptr) {
+      u32 base = allocGPUTmpInput(num_draws * data_stride, 256);
+      const u8 *src = (const u8 *)batch.drawData +
+          (size_t)chunk_start * batch.numDrawDataBytes;
+
+      for (u32 i = 0; i < num_draws; i++) {
+        data_offsets[i] = base + i * data_stride;
+        memcpy(gpu_input_.ptr + data_offsets[i],
+               src + (size_t)i * batch.numDrawDataBytes,
+               batch.numDrawDataBytes);
+      }
+    } else {
+      for (u32 i = 0; i < num_draws; i++) {
+        data_offsets[i] = state_.dataOffset;
+      }
+    }
+
+    auto loadHandles = [&](u32 *dst, const auto *src, u32 cur) {
+      if (src == nullptr) {
+        for (u32 i = 0; i < num_draws; i++) {
+          dst[i] = cur;
+        }
+      } else {
+        for (u32 i = 0; i < num_draws; i++) {
+          dst[i] = src[chunk_start + i].uint();
+        }
+      }
+    };
+
+    auto loadU32s = [&](u32 *dst, const u32 *src, u32 default_v) {
+      if (src == nullptr) {
+        for (u32 i = 0; i < num_draws; i++) {
+          dst[i] = default_v;
+        }
+      } else {
+        memcpy(dst, src + chunk_start, sizeof(u32) * num_draws);
+      }
+    };
+
+    u32 shaders[MAX_CHUNK_DRAWS];
+    u32 param_blocks[3][MAX_CHUNK_DRAWS];
+    u32 index_offsets[MAX_CHUNK_DRAWS];
+    u32 num_triangles[MAX_CHUNK_DRAWS];
+    u32 vertex_offsets[MAX_CHUNK_DRAWS];
+    u32 instance_offsets[MAX_CHUNK_DRAWS];
+    u32 num_instances[MAX_CHUNK_DRAWS];
+
+    loadHandles(shaders, batch.shaders, state_.shader.uint());
+    for (i32 j = 0; j < 3; j++) {
+      loadHandles(param_blocks[j], batch.paramBlocks[j],
+                  state_.paramBlocks[j].uint());
+    }
+
+    // Non indexed draws leave the index offset untouched rather than
+    // resetting it to 0, since the backend ignores it
+    loadU32s(index_offsets, batch.indexed ? batch.indexOffsets : nullptr,
+             batch.indexed ? 0 : state_.indexOffset);
+    loadU32s(num_triangles, batch.numTriangles, 0);
+    loadU32s(vertex_offsets, batch.vertexOffsets, 0);
+    loadU32s(instance_offsets, batch.instanceOffsets, 0);
+    loadU32s(num_instances, batch.numInstances, 1);
+
+    // Dirty bits for the whole chunk. Bits already pending from setters
+    // apply to the first draw.
+    u32 masks[MAX_CHUNK_DRAWS];
+    masks[0] = draw_type | (u32)ctrl_;
+    for (u32 i = 1; i < num_draws; i++) {
+      masks[i] = draw_type;
+    }
+
+    auto diff = [&](const u32 *values, u32 prev, CommandCtrl bit) {
+      masks[0] |= values[0] != prev ? (u32)bit : 0;
+      for (u32 i = 1; i < num_draws; i++) {
+        masks[i] |= (u32)(values[i] != values[i - 1]) * (u32)bit;
+      }
+    };
+
+    diff(shaders, state_.shader.uint(), DrawShader);
+    diff(param_blocks[0], state_.paramBlocks[0].uint(), DrawParamBlock0);
+    diff(param_blocks[1], state_.paramBlocks[1].uint(), DrawParamBlock1);
+    diff(param_blocks[2], state_.paramBlocks[2].uint(), DrawParamBlock2);
+    diff(index_offsets, state_.indexOffset, DrawIndexOffset);
+    diff(num_triangles, state_.numTriangles, DrawNumTriangles);
+    diff(vertex_offsets, state_.vertexOffset, DrawVertexOffset);
+    diff(instance_offsets, state_.instanceOffset, DrawInstanceOffset);
+    diff(num_instances, state_.numInstances, DrawNumInstances);
+
+    if (batch.drawData != nullptr) {
+      for (u32 i = 0; i < num_draws; i++) {
+        masks[i] |= (u32)DrawDataOffset;
+      }
+    }
+
+    u32 data_buffer = state_.dataBuffer.uint();
+    u32 vertex_buffer0 = state_.vertexBuffer[0].uint();
+    u32 vertex_buffer1 = state_.vertexBuffer[1].uint();
+    u32 index_buffer32 = state_.indexBuffer32.uint();
+    u32 index_buffer16 = state_.indexBuffer16.uint();
+
+    // Every word is stored and the write position only advances when its
+    // dirty bit is set, in the same order as encodeDrawState / encodeDraw
+    for (u32 i = 0; i < num_draws; i++) {
+      u32 mask = masks[i];
+
+      u32 words[MAX_DRAW_WORDS];
+      u32 num_words = 1;
+      words[0] = mask;
+
+      auto push = [&](u32 v, CommandCtrl bit) {
+        words[num_words] = v;
+        num_words += (mask & (u32)bit) != 0 ? 1 : 0;
+      };
+
+      push(shaders[i], DrawShader);
+      push(param_blocks[0][i], DrawParamBlock0);
+      push(param_blocks[1][i], DrawParamBlock1);
+      push(param_blocks[2][i], DrawParamBlock2);
+      push(data_buffer, DrawDataBuffer);
+      push(data_offsets[i], DrawDataOffset);
+      push(vertex_buffer0, DrawVertexBuffer0);
+      push(vertex_buffer1, DrawVertexBuffer1);
+      push(index_buffer32, DrawIndexBuffer32);
+      push(index_buffer16, DrawIndexBuffer16);
+      push(index_offsets[i], DrawIndexOffset);
+      push(num_triangles[i], DrawNumTriangles);
+      push(vertex_offsets[i], DrawVertexOffset);
+      push(instance_offsets[i], DrawInstanceOffset);
+      push(num_instances[i], DrawNumInstances);
+
+      writer_.write(gpu_, words, num_words);
+    }
+
+    u32 last = num_draws - 1;
+    state_.shader = RasterShader::fromUInt(shaders[last]);
+    for (i32 j = 0; j < 3; j++) {
+      state_.paramBlocks[j] = ParamBlock::fromUInt(param_blocks[j][last]);
+    }
+    state_.dataOffset = data_offsets[last];
+    state_.indexOffset = index_offsets[last];
+    state_.numTriangles = num_triangles[last];
+    state_.vertexOffset = vertex_offsets[last];
+    state_.instanceOffset = instance_offsets[last];
+    state_.numInstances = num_instances[last];
+
+    ctrl_ = None;
+
+    chunk_start += num_draws;
+  }
+}
+
+void RasterPassEncoder::drawIndirect(Buffer args, u32 offset)
+{
+  encodeDrawIndirect(CommandCtrl::RasterDrawIndirect, args, offset);
+}
+
+void RasterPassEncoder::drawIndexedIndirect(Buffer args, u32 offset)
+{
+  encodeDrawIndirect(CommandCtrl::RasterDrawIndexedIndirect, args, offset);
+}
+
+void RasterPassEncoder::multiDrawIndexedIndirect(
+  Buffer args, u32 offset, u32 max_draws,
+  Buffer count, u32 count_offset)
+{
+  using enum CommandCtrl;
+
+  assert(offset % sizeof(u32) == 0 && count_offset % sizeof(u32) == 0);
+
+  // Uniform input for the backend's emulation path. Allocated before
+  // encoding the draw state since it can switch the tmp input buffer.
+  u32 emulation_offset = allocGPUTmpInput(4 * sizeof(u32), 256);
+  u32 *emulation_args = (u32 *)(gpu_input_.ptr + emulation_offset);
+  emulation_args[0] = offset / sizeof(u32);
+  emulation_args[1] = count_offset / sizeof(u32);
+  emulation_args[2] = max_draws;
+  emulation_args[3] = 0;
+
+  *pass_draw_types_ |= (u32)RasterMultiDrawIndexedIndirect;
+
+  u32 *ctrl_out = encodeDrawState(RasterMultiDrawIndexedIndirect);
+  encodeIndirectArgs(args, offset);
+
+  writer_.writeU32(gpu_, max_draws);
+  writer_.id(gpu_, count);
+  writer_.writeU32(gpu_, count_offset);
+  writer_.id(gpu_, gpu_input_.buffer);
+  writer_.writeU32(gpu_, emulation_offset);
+
+  *ctrl_out = (u32)ctrl_;
+
+  ctrl_ = None;
+}
+
+void RasterPassEncoder::executeBundles(Span<const RenderBundle> bundles)
+{
+  writer_.ctrl(gpu_, CommandCtrl::RasterExecuteBundles);
+  writer_.writeU32(gpu_, (u32)bundles.size());
+
+  for (RenderBundle bundle : bundles) {
+    writer_.id(gpu_, bundle);
+  }
+
+  // Any state set since the last draw is dropped along with the rest
+  Buffer data_buffer = state_.dataBuffer;
+  state_ = DrawCommand {};
+  ctrl_ = CommandCtrl::None;
+
+  if (!data_buffer.null()) {
+    state_.dataBuffer = data_buffer;
+    ctrl_ |= CommandCtrl::DrawDataBuffer;
+  }
+}
+
+void RasterPassEncoder::beginOcclusionQuery(u32 query_idx)
+{
+  writer_.ctrl(gpu_, CommandCtrl::RasterBeginOcclusionQuery);
+  writer_.writeU32(gpu_, query_idx);
+}
+
+void RasterPassEncoder::endOcclusionQuery()
+{
+  writer_.ctrl(gpu_, CommandCtrl::RasterEndOcclusionQuery);
+}
+
+u32 * RasterPassEncoder::encodeDrawState(CommandCtrl draw_type)
 {
   using enum CommandCtrl;
 
@@ -360,6 +723,18 @@ void RasterPassEncoder::encodeDraw(
     writer_.id(gpu_, state_.indexBuffer16);
   }
 
+  return ctrl_out;
+}
+
+void RasterPassEncoder::encodeDraw(
+  CommandCtrl draw_type, u32 vertex_offset,
+  u32 index_offset, u32 num_triangles,
+  u32 instance_offset, u32 num_instances)
+{
+  using enum CommandCtrl;
+
+  u32 *ctrl_out = encodeDrawState(draw_type);
+
   if (state_.indexOffset != index_offset) {
     ctrl_ |= DrawIndexOffset;
     state_.indexOffset = index_offset;
@@ -395,17 +770,52 @@ void RasterPassEncoder::encodeDraw(
   ctrl_ = None;
 }
 
+void RasterPassEncoder::encodeDrawIndirect(CommandCtrl draw_type,
+                                           Buffer args, u32 offset)
+{
+  using enum CommandCtrl;
+
+  u32 *ctrl_out = encodeDrawState(draw_type);
+  encodeIndirectArgs(args, offset);
+
+  *ctrl_out = (u32)ctrl_;
+
+  ctrl_ = None;
+}
+
+void RasterPassEncoder::encodeIndirectArgs(Buffer args, u32 offset)
+{
+  using enum CommandCtrl;
+
+  if (state_.indirectBuffer != args) {
+    ctrl_ |= DrawIndirectBuffer;
+    state_.indirectBuffer = args;
+    writer_.id(gpu_, args);
+  }
+
+  if (state_.indirectOffset != offset) {
+    ctrl_ |= DrawIndirectOffset;
+    state_.indirectOffset = offset;
+    writer_.writeU32(gpu_, offset);
+  }
+}
+
 RasterPassEncoder::RasterPassEncoder(GPURuntime *gpu,
                                      CommandWriter writer,
+                                     u32 *pass_draw_types,
                                      GPUQueue queue,
                                      GPUTmpMemBlock gpu_input)
   : gpu_(gpu),
     writer_(writer),
+    pass_draw_types_(pass_draw_types),
     queue_(queue),
     gpu_input_(gpu_input),
     ctrl_(CommandCtrl::None),
     state_(),
-    draw_scissors_ { 0, 0, 0, 0 }
+    draw_scissors_ { 0, 0, 0, 0 },
+    viewport_ { 0, 0, 0, 0, 0, 0 },
+    blend_constant_ { 0, 0, 0, 0 },
+    stencil_reference_(0)
 {
   if (!gpu_input_.buffer.null()) {
     state_.dataBuffer = gpu_input_.buffer;
@@ -413,6 +823,280 @@ RasterPassEncoder::RasterPassEncoder(GPURuntime *gpu,
   }
 }
 
+RenderBundleEncoder::RenderBundleEncoder(GPURuntime *gpu,
+                                         RenderBundleInit init)
+  : init_(init),
+    cmds_head_(gpu->allocCommandBlock()),
+    raster_enc_()
+{
+  CommandWriter writer;
+  writer.cmds_ = cmds_head_;
+  writer.offset_ = 0;
+
+  raster_enc_ = RasterPassEncoder(gpu, writer, nullptr,
+                                  GPUQueue {}, GPUTmpMemBlock {});
+}
+
+void RenderBundleEncoder::endEncoding()
+{
+  raster_enc_.writer_.ctrl(raster_enc_.gpu_, CommandCtrl::None);
+}
+
+void RenderBundleEncoder::setShader(RasterShader shader)
+{
+  raster_enc_.setShader(shader);
+}
+
+void RenderBundleEncoder::setParamBlock(i32 idx, ParamBlock param_block)
+{
+  raster_enc_.setParamBlock(idx, param_block);
+}
+
+void RenderBundleEncoder::setVertexBuffer(i32 idx, Buffer buffer)
+{
+  raster_enc_.setVertexBuffer(idx, buffer);
+}
+
+void RenderBundleEncoder::setIndexBufferU32(Buffer buffer)
+{
+  raster_enc_.setIndexBufferU32(buffer);
+}
+
+void RenderBundleEncoder::setIndexBufferU16(Buffer buffer)
+{
+  raster_enc_.setIndexBufferU16(buffer);
+}
+
+void RenderBundleEncoder::draw(u32 vertex_offset, u32 num_triangles)
+{
+  raster_enc_.draw(vertex_offset, num_triangles);
+}
+
+void RenderBundleEncoder::drawIndexed(u32 vertex_offset,
+                                      u32 index_offset, u32 num_triangles)
+{
+  raster_enc_.drawIndexed(vertex_offset, index_offset, num_triangles);
+}
+
+void RenderBundleEncoder::drawInstanced(u32 vertex_offset, u32 num_triangles,
+                                        u32 instance_offset, u32 num_instances)
+{
+  raster_enc_.drawInstanced(vertex_offset, num_triangles,
+                            instance_offset, num_instances);
+}
+
+void RenderBundleEncoder::drawIndexedInstanced(
+  u32 vertex_offset,
+  u32 index_offset, u32 num_triangles,
+  u32 instance_offset, u32 num_instances)
+{
+  raster_enc_.drawIndexedInstanced(vertex_offset, index_offset, num_triangles,
+                                   instance_offset, num_instances);
+}
+
+void RenderBundleEncoder::drawIndirect(Buffer args, u32 offset)
+{
+  raster_enc_.drawIndirect(args, offset);
+}
+
+void RenderBundleEncoder::drawIndexedIndirect(Buffer args, u32 offset)
+{
+  raster_enc_.drawIndexedIndirect(args, offset);
+}
+
+ParamBlock ComputePassEncoder::createTemporaryParamBlock(
+  ParamBlockInit init)
+{
+  return gpu_->createTemporaryParamBlock(queue_, init);
+}
+
+void ComputePassEncoder::setShader(ComputeShader shader)
+{
+  if (state_.shader == shader) {
+    return;
+  }
+
+  ctrl_ |= CommandCtrl::ComputeShader;
+  state_.shader = shader;
+}
+
+void ComputePassEncoder::setParamBlock(i32 idx, ParamBlock param_block)
+{
+  assert(idx >= 0 && idx <= 2);
+  if (state_.paramBlocks[idx] == param_block) {
+    return;
+  }
+
+  ctrl_ |= CommandCtrl((u32)CommandCtrl::ComputeParamBlock0 << idx);
+  state_.paramBlocks[idx] = param_block;
+}
+
+MappedTmpBuffer ComputePassEncoder::tmpBuffer(u32 num_bytes, u32 alignment)
+{
+  if (num_bytes > GPUTmpMemBlock::BLOCK_SIZE) [[unlikely]] {
+    return MappedTmpBuffer {
+      .buffer = {},
+      .offset = 0,
+      .ptr = nullptr,
+    };
+  }
+
+  u32 offset = allocGPUTmpInput(num_bytes, alignment);
+
+  return MappedTmpBuffer {
+    .buffer = gpu_input_.buffer,
+    .offset = offset,
+    .ptr = gpu_input_.ptr + offset,
+  };
+}
+
+void * ComputePassEncoder::dispatchData(u32 num_bytes)
+{
+  u32 offset = allocGPUTmpInput(num_bytes, 256);
+
+  ctrl_ |= CommandCtrl::ComputeDataOffset;
+  state_.dataOffset = offset;
+
+  return gpu_input_.ptr + offset;
+}
+
+u32 ComputePassEncoder::allocGPUTmpInput(u32 num_bytes, u32 alignment)
+{
+  u32 offset = gpu_input_.alloc(num_bytes, alignment);
+  if (gpu_input_.blockFull()) [[unlikely]] {
+    gpu_input_ = gpu_->allocGPUTmpInputBlock(queue_);
+
+    // See RasterPassEncoder::allocGPUTmpInput
+    if (state_.dataBuffer != gpu_input_.buffer) [[unlikely]] {
+      ctrl_ |= CommandCtrl::ComputeDataBuffer;
+      state_.dataBuffer = gpu_input_.buffer;
+    }
+
+    offset = utils::roundUp(gpu_input_.offset, alignment);
+    gpu_input_.offset = offset + num_bytes;
+  }
+
+  return offset;
+}
+
+template <typename T>
+T * ComputePassEncoder::dispatchData()
+{
+  return (T *)dispatchData((u32)sizeof(T));
+}
+
+template <typename T>
+void ComputePassEncoder::dispatchData(T v)
+{
+  *dispatchData<T>() = v;
+}
+
+void ComputePassEncoder::dispatch(u32 num_blocks_x,
+                                  u32 num_blocks_y,
+                                  u32 num_blocks_z)
+{
+  using enum CommandCtrl;
+
+  u32 *ctrl_out = encodeDispatchState(Dispatch);
+
+  if (state_.numBlocksX != num_blocks_x) {
+    ctrl_ |= ComputeNumBlocksX;
+    state_.numBlocksX = num_blocks_x;
+    writer_.writeU32(gpu_, num_blocks_x);
+  }
+
+  if (state_.numBlocksY != num_blocks_y) {
+    ctrl_ |= ComputeNumBlocksY;
+    state_.numBlocksY = num_blocks_y;
+    writer_.writeU32(gpu_, num_blocks_y);
+  }
+
+  if (state_.numBlocksZ != num_blocks_z) {
+    ctrl_ |= ComputeNumBlocksZ;
+    state_.numBlocksZ = num_blocks_z;
+    writer_.writeU32(gpu_, num_blocks_z);
+  }
+
+  *ctrl_out = (u32)ctrl_;
+
+  ctrl_ = None;
+}
+
+void ComputePassEncoder::dispatchIndirect(Buffer args, u32 offset)
+{
+  using enum CommandCtrl;
+
+  u32 *ctrl_out = encodeDispatchState(DispatchIndirect);
+
+  if (state_.indirectBuffer != args) {
+    ctrl_ |= ComputeIndirectBuffer;
+    state_.indirectBuffer = args;
+    writer_.id(gpu_, args);
+  }
+
+  if (state_.indirectOffset != offset) {
+    ctrl_ |= ComputeIndirectOffset;
+    state_.indirectOffset = offset;
+    writer_.writeU32(gpu_, offset);
+  }
+
+  *ctrl_out = (u32)ctrl_;
+
+  ctrl_ = None;
+}
+
+u32 * ComputePassEncoder::encodeDispatchState(CommandCtrl dispatch_type)
+{
+  using enum CommandCtrl;
+
+  ctrl_ |= dispatch_type;
+
+  u32 *ctrl_out = writer_.reserve(gpu_);
+
+  if ((ctrl_ & ComputeShader) != None) {
+    writer_.id(gpu_, state_.shader);
+  }
+
+  if ((ctrl_ & ComputeParamBlock0) != None) {
+    writer_.id(gpu_, state_.paramBlocks[0]);
+  }
+
+  if ((ctrl_ & ComputeParamBlock1) != None) {
+    writer_.id(gpu_, state_.paramBlocks[1]);
+  }
+
+  if ((ctrl_ & ComputeParamBlock2) != None) {
+    writer_.id(gpu_, state_.paramBlocks[2]);
+  }
+
+  if ((ctrl_ & ComputeDataBuffer) != None) {
+    writer_.id(gpu_, state_.dataBuffer);
+  }
+
+  if ((ctrl_ & ComputeDataOffset) != None) {
+    writer_.writeU32(gpu_, state_.dataOffset);
+  }
+
+  return ctrl_out;
+}
+
+ComputePassEncoder::ComputePassEncoder(GPURuntime *gpu,
+                                       CommandWriter writer,
+                                       GPUQueue queue,
+                                       GPUTmpMemBlock gpu_input)
+  : gpu_(gpu),
+    writer_(writer),
+    queue_(queue),
+    gpu_input_(gpu_input),
+    ctrl_(CommandCtrl::None),
+    state_()
+{
+  if (!gpu_input_.buffer.null()) {
+    state_.dataBuffer = gpu_input_.buffer;
+    ctrl_ |= CommandCtrl::ComputeDataBuffer;
+  }
+}
+
 CopyCommand::CopyCommand()
   : data { 0, 0, 0, 0, 0 }
 {}
@@ -504,10 +1188,44 @@ void CopyPassEncoder::copyTextureToBuffer(Texture src,
                                           Buffer dst,
                                           u32 src_mip_level,
                                           u32 dst_offset)
+{
+  u32 *ctrl_out = encodeTextureToBuffer(CommandCtrl::CopyCmdTextureToBuffer,
+                                        src, dst, src_mip_level, dst_offset);
+
+  *ctrl_out = (u32)ctrl_;
+  ctrl_ = CommandCtrl::None;
+}
+
+void CopyPassEncoder::copyTextureToBufferConverted(
+    Texture src, Buffer dst,
+    TextureConversion conversion,
+    u32 src_mip_level,
+    u32 dst_offset)
+{
+  using enum CommandCtrl;
+
+  u32 *ctrl_out = encodeTextureToBuffer(CopyCmdTextureToBufferConverted,
+                                        src, dst, src_mip_level, dst_offset);
+
+  if (u32 v = (u32)conversion; v != state_.data[4]) {
+    ctrl_ |= CopyT2BConversion;
+    state_.data[4] = v;
+    writer_.writeU32(gpu_, v);
+  }
+
+  *ctrl_out = (u32)ctrl_;
+  ctrl_ = None;
+}
+
+u32 * CopyPassEncoder::encodeTextureToBuffer(CommandCtrl cmd,
+                                             Texture src,
+                                             Buffer dst,
+                                             u32 src_mip_level,
+                                             u32 dst_offset)
 {
   using enum CommandCtrl;
 
-  ctrl_ |= CopyCmdTextureToBuffer;
+  ctrl_ |= cmd;
 
   u32 *ctrl_out = writer_.reserve(gpu_);
 
@@ -535,8 +1253,7 @@ void CopyPassEncoder::copyTextureToBuffer(Texture src,
     writer_.writeU32(gpu_, dst_offset);
   }
 
-  *ctrl_out = (u32)ctrl_;
-  ctrl_ = None;
+  return ctrl_out;
 }
 
 void CopyPassEncoder::clearBuffer(Buffer buffer, u32 offset, u32 num_bytes)
@@ -569,6 +1286,213 @@ void CopyPassEncoder::clearBuffer(Buffer buffer, u32 offset, u32 num_bytes)
   ctrl_ = None;
 }
 
+void CopyPassEncoder::resolveQuerySet(QuerySet queries, u32 first_query,
+                                      u32 num_queries, Buffer dst,
+                                      u32 dst_offset)
+{
+  using enum CommandCtrl;
+
+  assert(dst_offset % 256 == 0);
+
+  ctrl_ |= CopyCmdResolveQuerySet;
+
+  u32 *ctrl_out = writer_.reserve(gpu_);
+
+  if (u32 hdl = queries.uint(); hdl != state_.data[0]) {
+    ctrl_ |= CopyResolveQuerySet;
+    state_.data[0] = hdl;
+    writer_.writeU32(gpu_, hdl);
+  }
+
+  if (first_query != state_.data[1]) {
+    ctrl_ |= CopyResolveFirstQuery;
+    state_.data[1] = first_query;
+    writer_.writeU32(gpu_, first_query);
+  }
+
+  if (num_queries != state_.data[2]) {
+    ctrl_ |= CopyResolveNumQueries;
+    state_.data[2] = num_queries;
+    writer_.writeU32(gpu_, num_queries);
+  }
+
+  if (u32 hdl = dst.uint(); hdl != state_.data[3]) {
+    ctrl_ |= CopyResolveDstBuffer;
+    state_.data[3] = hdl;
+    writer_.writeU32(gpu_, hdl);
+  }
+
+  if (dst_offset != state_.data[4]) {
+    ctrl_ |= CopyResolveDstOffset;
+    state_.data[4] = dst_offset;
+    writer_.writeU32(gpu_, dst_offset);
+  }
+
+  *ctrl_out = (u32)ctrl_;
+  ctrl_ = None;
+}
+
+void CopyPassEncoder::generateMips(Texture texture)
+{
+  using enum CommandCtrl;
+
+  ctrl_ |= CopyCmdGenerateMips;
+
+  u32 *ctrl_out = writer_.reserve(gpu_);
+
+  if (u32 hdl = texture.uint(); hdl != state_.data[0]) {
+    ctrl_ |= CopyMipsTexture;
+    state_.data[0] = hdl;
+    writer_.writeU32(gpu_, hdl);
+  }
+
+  *ctrl_out = (u32)ctrl_;
+  ctrl_ = None;
+}
+
+void CopyPassEncoder::scatterUpdate(Buffer dst,
+                                    Span<const ScatterRegion> regions)
+{
+  // Packed layout, in u32 words: a 4 word header holding the number of
+  // regions, one (dst offset, src offset, num words, pad) entry per region,
+  // then the region data. Must match SCATTER_UPDATE_SHADER_SRC in the
+  // backends.
+  constexpr u32 header_num_bytes = 4 * sizeof(u32);
+  constexpr u32 region_entry_num_bytes = 4 * sizeof(u32);
+
+  // Regions too large for the space left in a pack are split: the part
+  // that fits is packed as its own entry and the rest continues in the
+  // next pack, so any region size is supported.
+  auto pieceNumBytes = [](const ScatterRegion &region, u32 byte_offset,
+                          u32 pack_num_bytes) {
+    u32 remaining = region.numBytes - byte_offset;
+    u32 available = GPUTmpMemBlock::BLOCK_SIZE - pack_num_bytes;
+    if (available <= region_entry_num_bytes) {
+      return 0_u32;
+    }
+
+    u32 max_piece_num_bytes = (available - region_entry_num_bytes) & ~3_u32;
+    return remaining < max_piece_num_bytes ? remaining : max_piece_num_bytes;
+  };
+
+  i32 num_regions_total = (i32)regions.size();
+  i32 region_start = 0;
+  u32 region_start_offset = 0;
+  while (region_start < num_regions_total) {
+    // Count the pieces that fit in a single tmp staging block
+    u32 num_bytes = header_num_bytes;
+    u32 num_pieces = 0;
+    {
+      i32 region_idx = region_start;
+      u32 byte_offset = region_start_offset;
+      while (region_idx < num_regions_total) {
+        const ScatterRegion &region = regions[region_idx];
+        assert(region.dstOffset % sizeof(u32) == 0);
+        assert(region.numBytes % sizeof(u32) == 0);
+
+        u32 piece_num_bytes = pieceNumBytes(region, byte_offset, num_bytes);
+        if (num_bytes + region_entry_num_bytes > GPUTmpMemBlock::BLOCK_SIZE ||
+            (piece_num_bytes == 0 && region.numBytes > byte_offset)) {
+          break;
+        }
+
+        num_bytes += region_entry_num_bytes + piece_num_bytes;
+        num_pieces += 1;
+        byte_offset += piece_num_bytes;
+
+        if (byte_offset < region.numBytes) {
+          break;
+        }
+
+        region_idx += 1;
+        byte_offset = 0;
+      }
+    }
+
+    MappedTmpBuffer packed = tmpBuffer(num_bytes);
+    assert(packed.ptr != nullptr);
+
+    u32 *packed_words = (u32 *)packed.ptr;
+    packed_words[0] = num_pieces;
+    packed_words[1] = 0;
+    packed_words[2] = 0;
+    packed_words[3] = 0;
+
+    u32 *region_entries = packed_words + 4;
+    u32 data_word_offset = 4 + 4 * num_pieces;
+    u32 pack_num_bytes = header_num_bytes;
+
+    for (u32 i = 0; i < num_pieces; i++) {
+      const ScatterRegion &region = regions[region_start];
+      u32 piece_num_bytes =
+          pieceNumBytes(region, region_start_offset, pack_num_bytes);
+      u32 num_words = piece_num_bytes / sizeof(u32);
+
+      region_entries[4 * i] =
+          (region.dstOffset + region_start_offset) / sizeof(u32);
+      region_entries[4 * i + 1] = data_word_offset;
+      region_entries[4 * i + 2] = num_words;
+      region_entries[4 * i + 3] = 0;
+
+      memcpy(packed_words + data_word_offset,
+             (const u8 *)region.data + region_start_offset, piece_num_bytes);
+      data_word_offset += num_words;
+      pack_num_bytes += region_entry_num_bytes + piece_num_bytes;
+
+      region_start_offset += piece_num_bytes;
+      if (region_start_offset == region.numBytes) {
+        region_start += 1;
+        region_start_offset = 0;
+      }
+    }
+
+    encodeScatterUpdate(dst, packed, num_bytes, num_pieces);
+  }
+}
+
+void CopyPassEncoder::encodeScatterUpdate(Buffer dst, MappedTmpBuffer packed,
+                                          u32 num_bytes, u32 num_regions)
+{
+  using enum CommandCtrl;
+
+  ctrl_ |= CopyCmdScatterUpdate;
+
+  u32 *ctrl_out = writer_.reserve(gpu_);
+
+  if (u32 hdl = dst.uint(); hdl != state_.data[0]) {
+    ctrl_ |= CopyScatterDstBuffer;
+    state_.data[0] = hdl;
+    writer_.writeU32(gpu_, hdl);
+  }
+
+  if (u32 hdl = packed.buffer.uint(); hdl != state_.data[1]) {
+    ctrl_ |= CopyScatterSrcBuffer;
+    state_.data[1] = hdl;
+    writer_.writeU32(gpu_, hdl);
+  }
+
+  if (packed.offset != state_.data[2]) {
+    ctrl_ |= CopyScatterSrcOffset;
+    state_.data[2] = packed.offset;
+    writer_.writeU32(gpu_, packed.offset);
+  }
+
+  if (num_bytes != state_.data[3]) {
+    ctrl_ |= CopyScatterNumBytes;
+    state_.data[3] = num_bytes;
+    writer_.writeU32(gpu_, num_bytes);
+  }
+
+  if (num_regions != state_.data[4]) {
+    ctrl_ |= CopyScatterNumRegions;
+    state_.data[4] = num_regions;
+    writer_.writeU32(gpu_, num_regions);
+  }
+
+  *ctrl_out = (u32)ctrl_;
+  ctrl_ = None;
+}
+
 MappedTmpBuffer CopyPassEncoder::tmpBuffer(u32 num_bytes, u32 alignment)
 {
   if (num_bytes > GPUTmpMemBlock::BLOCK_SIZE) [[unlikely]] {
@@ -624,7 +1548,42 @@ RasterPassEncoder CommandEncoder::beginRasterPass(
   cmd_writer_.ctrl(gpu_, CommandCtrl::RasterPass);
   cmd_writer_.id(gpu_, render_pass);
 
-  return RasterPassEncoder(gpu_, cmd_writer_, queue_, gpu_input_);
+  u32 *pass_draw_types = cmd_writer_.reserve(gpu_);
+  *pass_draw_types = (u32)CommandCtrl::None;
+
+  return RasterPassEncoder(gpu_, cmd_writer_, pass_draw_types,
+                           queue_, gpu_input_);
+}
+
+RasterPassEncoder CommandEncoder::beginRasterPass(
+  RasterPassInterface interface,
+  Span<const Texture> color_attachments,
+  Texture depth_attachment,
+  Span<const Texture> resolve_attachments,
+  QuerySet occlusion_query_set)
+{
+  assert(color_attachments.size() <= MAX_COLOR_ATTACHMENTS);
+  assert(resolve_attachments.size() == 0 ||
+         resolve_attachments.size() == color_attachments.size());
+
+  cmd_writer_.ctrl(gpu_, CommandCtrl::TransientRasterPass);
+  cmd_writer_.id(gpu_, interface);
+  cmd_writer_.id(gpu_, depth_attachment);
+  cmd_writer_.id(gpu_, occlusion_query_set);
+  cmd_writer_.writeU32(gpu_, (u32)color_attachments.size());
+  for (Texture attachment : color_attachments) {
+    cmd_writer_.id(gpu_, attachment);
+  }
+  cmd_writer_.writeU32(gpu_, (u32)resolve_attachments.size());
+  for (Texture attachment : resolve_attachments) {
+    cmd_writer_.id(gpu_, attachment);
+  }
+
+  u32 *pass_draw_types = cmd_writer_.reserve(gpu_);
+  *pass_draw_types = (u32)CommandCtrl::None;
+
+  return RasterPassEncoder(gpu_, cmd_writer_, pass_draw_types,
+                           queue_, gpu_input_);
 }
 
 void CommandEncoder::endRasterPass(RasterPassEncoder &render_enc)
@@ -636,12 +1595,15 @@ void CommandEncoder::endRasterPass(RasterPassEncoder &render_enc)
 
 ComputePassEncoder CommandEncoder::beginComputePass()
 {
-  return {};
+  cmd_writer_.ctrl(gpu_, CommandCtrl::ComputePass);
+  return ComputePassEncoder(gpu_, cmd_writer_, queue_, gpu_input_);
 }
 
 void CommandEncoder::endComputePass(ComputePassEncoder &compute_enc)
 {
-  (void)compute_enc;
+  cmd_writer_ = compute_enc.writer_;
+  cmd_writer_.ctrl(gpu_, CommandCtrl::None);
+  gpu_input_ = compute_enc.gpu_input_;
 }
 
 CopyPassEncoder CommandEncoder::beginCopyPass()
@@ -746,6 +1708,18 @@ void GPURuntime::destroySampler(Sampler sampler)
   destroySamplers(1, &sampler);
 }
 
+QuerySet GPURuntime::createQuerySet(QuerySetInit init)
+{
+  QuerySet out {};
+  createQuerySets(1, &init, &out);
+  return out;
+}
+
+void GPURuntime::destroyQuerySet(QuerySet query_set)
+{
+  destroyQuerySets(1, &query_set);
+}
+
 ParamBlockType GPURuntime::createParamBlockType(
     ParamBlockTypeInit init)
 {
@@ -808,6 +1782,39 @@ void GPURuntime::destroyRasterShader(RasterShader shader)
   destroyRasterShaders(1, &shader);
 }
 
+ComputeShader GPURuntime::createComputeShader(ComputeShaderInit init)
+{
+  ComputeShader out {};
+  createComputeShaders(1, &init, &out);
+  return out;
+}
+
+void GPURuntime::destroyComputeShader(ComputeShader shader)
+{
+  destroyComputeShaders(1, &shader);
+}
+
+RenderBundleEncoder GPURuntime::beginRenderBundle(RenderBundleInit init)
+{
+  return RenderBundleEncoder(this, init);
+}
+
+RenderBundle GPURuntime::endRenderBundle(RenderBundleEncoder &enc)
+{
+  enc.endEncoding();
+
+  RenderBundle bundle = createRenderBundle(enc.init_, enc.cmds_head_);
+  deallocCommandBlocks(enc.cmds_head_);
+  enc.cmds_head_ = nullptr;
+
+  return bundle;
+}
+
+void GPURuntime::destroyRenderBundle(RenderBundle bundle)
+{
+  destroyRenderBundles(1, &bundle);
+}
+
 CommandEncoder::CommandEncoder(GPURuntime *gpu,
                                GPUQueue queue)
   : gpu_(gpu),
@@ -843,9 +1850,23 @@ void GPURuntime::destroyCommandEncoder(CommandEncoder &encoder)
   deallocCommandBlocks(encoder.cmds_head_);
 }
 
-void GPURuntime::submit(GPUQueue queue, CommandEncoder &enc)
+GPUSubmitToken GPURuntime::submit(GPUQueue queue, CommandEncoder &enc,
+                                  Span<const GPUSubmitToken> wait_tokens)
 {
-  submit(queue, enc.cmds_head_);
+  return submit(queue, enc.cmds_head_, wait_tokens);
+}
+
+u32 textureConversionBytesPerTexel(TextureConversion conversion)
+{
+  switch (conversion) {
+    case TextureConversion::Luminance_UNorm8: return 1;
+    case TextureConversion::Depth_UNorm16: return 2;
+    case TextureConversion::R16_Float: return 2;
+    case TextureConversion::RGBA16_Float: return 8;
+  }
+
+  assert(false);
+  return 0;
 }
 
 inline BufferUsage & operator|=(BufferUsage &a, BufferUsage b)
@@ -0,0 +1,218 @@
+#include "gas_debug_draw.hpp"
+
+#include <madrona/crash.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace gas {
+namespace DebugDraw {
+namespace {
+
+constexpr inline u32 CHUNK_NUM_VERTICES = 4096;
+constexpr inline i32 SPHERE_NUM_SEGMENTS = 24;
+
+u32 packColor(Vector4 color)
+{
+  auto unorm8 = [](float v) {
+    return (u32)(std::clamp(v, 0.f, 1.f) * 255.f + 0.5f);
+  };
+
+  return unorm8(color.x) | (unorm8(color.y) << 8) |
+      (unorm8(color.z) << 16) | (unorm8(color.w) << 24);
+}
+
+RasterShader loadShader(GPURuntime *gpu,
+                        ShaderByteCode byte_code,
+                        const RendererInit &init,
+                        PrimitiveTopology topology)
+{
+  using enum VertexFormat;
+  return gpu->createRasterShader({
+    .byteCode = byte_code,
+    .vertexEntry = "vertMain",
+    .fragmentEntry = "fragMain",
+    .rasterPass = init.rasterPass,
+    .numPerDrawBytes = sizeof(Camera),
+    .vertexBuffers = {{
+      .stride = sizeof(Vertex), .attributes = {
+        { .offset = offsetof(Vertex, position), .format = Vec3_F32 },
+        { .offset = offsetof(Vertex, color), .format = Vec4_UNorm8 },
+      }
+    }},
+    .topology = topology,
+    .rasterConfig = {
+      .depthCompare = init.depthCompare,
+      .writeDepth = false,
+      .cullMode = CullMode::None,
+    },
+  });
+}
+
+}
+
+Renderer createRenderer(GPURuntime *gpu, ShaderCompiler *shaderc,
+                        RendererInit init)
+{
+  StackAlloc alloc;
+  ShaderCompileResult compiled_shader = shaderc->compileShader(alloc, {
+    .path = GAS_DEBUG_DRAW_SHADER_DIR "debug_draw.slang",
+  });
+
+  if (!compiled_shader.success) {
+    FATAL("Failed to compile gas debug draw shader: %s\n",
+          compiled_shader.diagnostics.data());
+  }
+
+  ShaderByteCode byte_code = compiled_shader.getByteCodeForBackend(
+      gpu->backendShaderByteCodeType());
+
+  return Renderer {
+    .lineShader = loadShader(gpu, byte_code, init,
+                             PrimitiveTopology::LineList),
+    .pointShader = loadShader(gpu, byte_code, init,
+                              PrimitiveTopology::PointList),
+  };
+}
+
+void destroyRenderer(GPURuntime *gpu, Renderer &renderer)
+{
+  gpu->destroyRasterShader(renderer.pointShader);
+  gpu->destroyRasterShader(renderer.lineShader);
+}
+
+Batch::Batch(const Renderer &renderer, RasterPassEncoder &enc,
+             const Camera &camera)
+  : enc_(enc),
+    camera_(camera),
+    lines_ {
+      .shader = renderer.lineShader,
+      .numPrimitiveVertices = 2,
+    },
+    points_ {
+      .shader = renderer.pointShader,
+      .numPrimitiveVertices = 1,
+    }
+{}
+
+void Batch::line(Vector3 a, Vector3 b, Vector4 color)
+{
+  u32 packed = packColor(color);
+
+  Vertex *out = alloc(lines_, 2);
+  out[0] = { a, packed };
+  out[1] = { b, packed };
+}
+
+void Batch::box(Vector3 min, Vector3 max, Vector4 color)
+{
+  u32 packed = packColor(color);
+
+  auto corner = [&](i32 i) {
+    return Vector3 {
+      (i & 1) ? max.x : min.x,
+      (i & 2) ? max.y : min.y,
+      (i & 4) ? max.z : min.z,
+    };
+  };
+
+  // Each edge connects corners that differ in a single axis bit
+  Vertex *out = alloc(lines_, 24);
+  for (i32 i = 0; i < 8; i++) {
+    for (i32 axis_bit = 1; axis_bit < 8; axis_bit <<= 1) {
+      if ((i & axis_bit) == 0) {
+        *out++ = { corner(i), packed };
+        *out++ = { corner(i | axis_bit), packed };
+      }
+    }
+  }
+}
+
+void Batch::sphere(Vector3 center, float radius, Vector4 color)
+{
+  static const auto unit_circle = []() {
+    std::array<std::array<float, 2>, SPHERE_NUM_SEGMENTS> circle;
+    for (i32 i = 0; i < SPHERE_NUM_SEGMENTS; i++) {
+      float theta = 2.f * 3.14159265f * (float)i / (float)SPHERE_NUM_SEGMENTS;
+      circle[i] = { cosf(theta), sinf(theta) };
+    }
+    return circle;
+  }();
+
+  u32 packed = packColor(color);
+
+  Vertex *out = alloc(lines_, 3 * 2 * SPHERE_NUM_SEGMENTS);
+  for (i32 plane = 0; plane < 3; plane++) {
+    auto circlePoint = [&](i32 i) {
+      float u = radius * unit_circle[i % SPHERE_NUM_SEGMENTS][0];
+      float v = radius * unit_circle[i % SPHERE_NUM_SEGMENTS][1];
+
+      switch (plane) {
+        case 0: return Vector3 { center.x + u, center.y + v, center.z };
+        case 1: return Vector3 { center.x + u, center.y, center.z + v };
+        default: return Vector3 { center.x, center.y + u, center.z + v };
+      }
+    };
+
+    for (i32 i = 0; i < SPHERE_NUM_SEGMENTS; i++) {
+      *out++ = { circlePoint(i), packed };
+      *out++ = { circlePoint(i + 1), packed };
+    }
+  }
+}
+
+void Batch::point(Vector3 p, Vector4 color)
+{
+  *alloc(points_, 1) = { p, packColor(color) };
+}
+
+void Batch::flush()
+{
+  drawStream(lines_);
+  drawStream(points_);
+}
+
+Vertex * Batch::alloc(Stream &stream, u32 num_vertices)
+{
+  if (stream.numVertices + num_vertices > stream.capacity) [[unlikely]] {
+    // Draw what's already in the current chunk, then continue in a new one
+    drawStream(stream);
+
+    u32 capacity = std::max(num_vertices, CHUNK_NUM_VERTICES);
+    MappedTmpBuffer chunk = enc_.tmpBuffer(capacity * sizeof(Vertex));
+    assert(chunk.ptr != nullptr);
+
+    stream.buffer = chunk.buffer;
+    stream.vertices = (Vertex *)chunk.ptr;
+    stream.firstVertex = chunk.offset / sizeof(Vertex);
+    stream.capacity = capacity;
+  }
+
+  Vertex *out = stream.vertices + stream.numVertices;
+  stream.numVertices += num_vertices;
+
+  return out;
+}
+
+void Batch::drawStream(Stream &stream)
+{
+  if (stream.numVertices == 0) {
+    return;
+  }
+
+  enc_.setShader(stream.shader);
+  enc_.setVertexBuffer(0, stream.buffer);
+  enc_.drawData(camera_);
+  enc_.draw(stream.firstVertex,
+            stream.numVertices / stream.numPrimitiveVertices);
+
+  // Later primitives continue after the drawn ones in the same chunk
+  stream.vertices += stream.numVertices;
+  stream.firstVertex += stream.numVertices;
+  stream.capacity -= stream.numVertices;
+  stream.numVertices = 0;
+}
+
+}
+}
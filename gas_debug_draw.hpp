@@ -0,0 +1,84 @@
+#pragma once
+
+#include "gas.hpp"
+#include "shader_compiler.hpp"
+
+namespace gas {
+
+// Immediate mode debug lines and points. Vertices are written straight
+// into the raster pass's tmp buffer as primitives are added, and drawn
+// with a single line list draw and a single point list draw per flush
+// (plus one per extra tmp buffer chunk for very large batches), rather
+// than one draw per object. Points are always one pixel in size.
+namespace DebugDraw {
+
+// Must match DebugVertex in debug_draw.slang
+struct Vertex {
+  Vector3 position;
+  // RGBA8
+  u32 color;
+};
+
+struct Camera {
+  // Rows of the world to clip space transform
+  Vector4 viewProj[4];
+};
+
+struct RendererInit {
+  RasterPassInterface rasterPass;
+  // Debug geometry never writes depth, but can be tested against it when
+  // the pass has a depth attachment
+  DepthCompare depthCompare = DepthCompare::Disabled;
+};
+
+struct Renderer {
+  RasterShader lineShader = {};
+  RasterShader pointShader = {};
+};
+
+Renderer createRenderer(GPURuntime *gpu, ShaderCompiler *shaderc,
+                        RendererInit init);
+void destroyRenderer(GPURuntime *gpu, Renderer &renderer);
+
+// Records debug primitives for a single raster pass. Flushing binds the
+// debug shaders and vertex buffer 0, so draw state must be set again
+// before any other draws.
+class Batch {
+public:
+  Batch(const Renderer &renderer, RasterPassEncoder &enc,
+        const Camera &camera);
+  Batch(const Batch &) = delete;
+
+  void line(Vector3 a, Vector3 b, Vector4 color);
+  // Axis aligned box outline
+  void box(Vector3 min, Vector3 max, Vector4 color);
+  // Outlines of the sphere's XY, XZ and YZ great circles
+  void sphere(Vector3 center, float radius, Vector4 color);
+  void point(Vector3 p, Vector4 color);
+
+  // Draws all primitives added since the last flush
+  void flush();
+
+private:
+  struct Stream {
+    RasterShader shader;
+    u32 numPrimitiveVertices;
+    Buffer buffer;
+    Vertex *vertices;
+    u32 firstVertex;
+    u32 numVertices;
+    u32 capacity;
+  };
+
+  Vertex * alloc(Stream &stream, u32 num_vertices);
+  void drawStream(Stream &stream);
+
+  RasterPassEncoder &enc_;
+  Camera camera_;
+  Stream lines_;
+  Stream points_;
+};
+
+}
+
+}
@@ -0,0 +1,241 @@
+#include "gas_draw_queue.hpp"
+
+#include <madrona/crash.hpp>
+#include <madrona/memory.hpp>
+#include <madrona/utils.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace gas {
+namespace {
+
+constexpr inline u32 INIT_DRAW_CAPACITY = 1024;
+constexpr inline u32 INIT_DRAW_DATA_CAPACITY = 64 * 1024;
+constexpr inline u32 DRAW_DATA_ALIGNMENT = 16;
+
+constexpr inline u32 RADIX_NUM_BITS = 8;
+constexpr inline u32 RADIX_NUM_BINS = 1 << RADIX_NUM_BITS;
+constexpr inline u32 RADIX_NUM_PASSES = 64 / RADIX_NUM_BITS;
+
+u64 keyBits(u32 v, u32 num_bits)
+{
+  return (u64)(v & ((1_u32 << num_bits) - 1));
+}
+
+template <typename T>
+T * growArray(T *arr, u32 num_elems, u32 new_capacity)
+{
+  T *new_arr = (T *)rawAlloc(sizeof(T) * new_capacity);
+  if (arr != nullptr) {
+    memcpy(new_arr, arr, sizeof(T) * num_elems);
+    rawDealloc(arr);
+  }
+
+  return new_arr;
+}
+
+}
+
+u64 makeDrawSortKey(const DrawSortKeyInit &init)
+{
+  // Non-negative floats order the same as their bit patterns
+  assert(init.depth >= 0.f);
+  u32 depth_bits;
+  memcpy(&depth_bits, &init.depth, sizeof(float));
+
+  u32 buffer_bits =
+      ((u32)init.vertexBuffer.id << 6) ^ (u32)init.indexBuffer.id;
+
+  return (keyBits(init.shader.id, 14) << 50) |
+         (keyBits(init.paramBlock0.id, 12) << 38) |
+         (keyBits(init.paramBlock1.id, 10) << 28) |
+         (keyBits(buffer_bits, 12) << 16) |
+         (u64)(depth_bits >> 15);
+}
+
+DrawQueue::DrawQueue()
+  : entries_(nullptr),
+    keys_(nullptr),
+    alt_keys_(nullptr),
+    order_(nullptr),
+    alt_order_(nullptr),
+    num_draws_(0),
+    draw_capacity_(0),
+    draw_data_(nullptr),
+    num_draw_data_bytes_(0),
+    draw_data_capacity_(0)
+{}
+
+DrawQueue::~DrawQueue()
+{
+  if (draw_capacity_ > 0) {
+    rawDealloc(alt_order_);
+    rawDealloc(order_);
+    rawDealloc(alt_keys_);
+    rawDealloc(keys_);
+    rawDealloc(entries_);
+  }
+
+  if (draw_data_capacity_ > 0) {
+    rawDealloc(draw_data_);
+  }
+}
+
+void * DrawQueue::add(u64 sort_key, const QueuedDraw &draw,
+                      u32 num_draw_data_bytes)
+{
+  if (num_draws_ == draw_capacity_) [[unlikely]] {
+    growDraws();
+  }
+
+  u32 draw_data_offset =
+      utils::roundUp(num_draw_data_bytes_, DRAW_DATA_ALIGNMENT);
+  if (draw_data_offset + num_draw_data_bytes > draw_data_capacity_) {
+    growDrawData(draw_data_offset + num_draw_data_bytes);
+  }
+  num_draw_data_bytes_ = draw_data_offset + num_draw_data_bytes;
+
+  u32 draw_idx = num_draws_++;
+  entries_[draw_idx] = Entry {
+    .draw = draw,
+    .drawDataOffset = draw_data_offset,
+    .numDrawDataBytes = num_draw_data_bytes,
+  };
+  keys_[draw_idx] = sort_key;
+  order_[draw_idx] = draw_idx;
+
+  return draw_data_ + draw_data_offset;
+}
+
+void DrawQueue::encode(RasterPassEncoder &enc)
+{
+  sortDraws();
+
+  for (u32 i = 0; i < num_draws_; i++) {
+    const Entry &entry = entries_[order_[i]];
+    const QueuedDraw &draw = entry.draw;
+
+    enc.setShader(draw.shader);
+
+    for (i32 j = 0; j < 3; j++) {
+      if (!draw.paramBlocks[j].null()) {
+        enc.setParamBlock(j, draw.paramBlocks[j]);
+      }
+    }
+
+    for (i32 j = 0; j < 2; j++) {
+      if (!draw.vertexBuffers[j].null()) {
+        enc.setVertexBuffer(j, draw.vertexBuffers[j]);
+      }
+    }
+
+    if (entry.numDrawDataBytes > 0) {
+      memcpy(enc.drawData(entry.numDrawDataBytes),
+             draw_data_ + entry.drawDataOffset, entry.numDrawDataBytes);
+    }
+
+    bool indexed = true;
+    if (!draw.indexBuffer32.null()) {
+      enc.setIndexBufferU32(draw.indexBuffer32);
+    } else if (!draw.indexBuffer16.null()) {
+      enc.setIndexBufferU16(draw.indexBuffer16);
+    } else {
+      indexed = false;
+    }
+
+    if (indexed) {
+      enc.drawIndexedInstanced(draw.vertexOffset, draw.indexOffset,
+                               draw.numTriangles,
+                               draw.instanceOffset, draw.numInstances);
+    } else {
+      enc.drawInstanced(draw.vertexOffset, draw.numTriangles,
+                        draw.instanceOffset, draw.numInstances);
+    }
+  }
+
+  clear();
+}
+
+void DrawQueue::clear()
+{
+  num_draws_ = 0;
+  num_draw_data_bytes_ = 0;
+}
+
+// LSD radix sort of (key, draw index) pairs. The sort is stable, so draws
+// with equal keys are encoded in submission order. Passes where every key
+// has the same digit are skipped, which is common for the high bits.
+void DrawQueue::sortDraws()
+{
+  if (num_draws_ <= 1) {
+    return;
+  }
+
+  u32 histograms[RADIX_NUM_PASSES][RADIX_NUM_BINS] = {};
+
+  for (u32 i = 0; i < num_draws_; i++) {
+    u64 key = keys_[i];
+    for (u32 pass = 0; pass < RADIX_NUM_PASSES; pass++) {
+      u32 digit = u32(key >> (pass * RADIX_NUM_BITS)) & (RADIX_NUM_BINS - 1);
+      histograms[pass][digit] += 1;
+    }
+  }
+
+  for (u32 pass = 0; pass < RADIX_NUM_PASSES; pass++) {
+    u32 *histogram = histograms[pass];
+    u32 shift = pass * RADIX_NUM_BITS;
+
+    u32 first_digit = u32(keys_[0] >> shift) & (RADIX_NUM_BINS - 1);
+    if (histogram[first_digit] == num_draws_) {
+      continue;
+    }
+
+    u32 offset = 0;
+    for (u32 bin = 0; bin < RADIX_NUM_BINS; bin++) {
+      u32 count = histogram[bin];
+      histogram[bin] = offset;
+      offset += count;
+    }
+
+    for (u32 i = 0; i < num_draws_; i++) {
+      u64 key = keys_[i];
+      u32 digit = u32(key >> shift) & (RADIX_NUM_BINS - 1);
+      u32 dst = histogram[digit]++;
+
+      alt_keys_[dst] = key;
+      alt_order_[dst] = order_[i];
+    }
+
+    std::swap(keys_, alt_keys_);
+    std::swap(order_, alt_order_);
+  }
+}
+
+void DrawQueue::growDraws()
+{
+  u32 new_capacity = draw_capacity_ == 0 ?
+      INIT_DRAW_CAPACITY : draw_capacity_ * 2;
+
+  entries_ = growArray(entries_, num_draws_, new_capacity);
+  keys_ = growArray(keys_, num_draws_, new_capacity);
+  alt_keys_ = growArray(alt_keys_, 0, new_capacity);
+  order_ = growArray(order_, num_draws_, new_capacity);
+  alt_order_ = growArray(alt_order_, 0, new_capacity);
+
+  draw_capacity_ = new_capacity;
+}
+
+void DrawQueue::growDrawData(u32 min_num_bytes)
+{
+  u32 new_capacity = std::max(draw_data_capacity_ * 2,
+                              INIT_DRAW_DATA_CAPACITY);
+  new_capacity = std::max(new_capacity,
+                          utils::roundUp(min_num_bytes, DRAW_DATA_ALIGNMENT));
+
+  draw_data_ = growArray(draw_data_, num_draw_data_bytes_, new_capacity);
+  draw_data_capacity_ = new_capacity;
+}
+
+}
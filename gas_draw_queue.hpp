@@ -0,0 +1,99 @@
+#pragma once
+
+#include "gas.hpp"
+
+namespace gas {
+
+// Collects draws tagged with 64 bit sort keys, radix sorts them on the CPU
+// and encodes them in ascending key order. RasterPassEncoder already skips
+// binds that match the current state, so sorting by the most expensive
+// state first (shader, then param blocks, then buffers) minimizes the
+// number of pipeline and bind group changes without callers ordering
+// draws by hand. Keys only affect ordering: every draw's full state is
+// kept, so keys can be truncated or hashed freely.
+struct QueuedDraw {
+  RasterShader shader = {};
+  ParamBlock paramBlocks[3] = {};
+  Buffer vertexBuffers[2] = {};
+  // Non indexed draw if both are null
+  Buffer indexBuffer32 = {};
+  Buffer indexBuffer16 = {};
+  u32 vertexOffset = 0;
+  u32 indexOffset = 0;
+  u32 numTriangles = 0;
+  u32 instanceOffset = 0;
+  u32 numInstances = 1;
+};
+
+// Inputs to the default key layout, from most to least significant:
+// shader (14 bits), param block 0 (12 bits), param block 1 (10 bits),
+// vertex / index buffers (12 bits) and depth (16 bits). Depth must be
+// non-negative and sorts front to back, which suits opaque geometry.
+struct DrawSortKeyInit {
+  RasterShader shader = {};
+  ParamBlock paramBlock0 = {};
+  ParamBlock paramBlock1 = {};
+  Buffer vertexBuffer = {};
+  Buffer indexBuffer = {};
+  float depth = 0.f;
+};
+
+u64 makeDrawSortKey(const DrawSortKeyInit &init);
+
+class DrawQueue {
+public:
+  DrawQueue();
+  DrawQueue(const DrawQueue &) = delete;
+  ~DrawQueue();
+
+  // Returns num_draw_data_bytes of storage that is copied to
+  // RasterPassEncoder::drawData when the draw is encoded
+  void * add(u64 sort_key, const QueuedDraw &draw,
+             u32 num_draw_data_bytes = 0);
+
+  template <typename T>
+  void add(u64 sort_key, const QueuedDraw &draw, T draw_data);
+
+  inline u32 numDraws() const;
+
+  // Sorts and encodes all queued draws, then clears the queue
+  void encode(RasterPassEncoder &enc);
+  void clear();
+
+private:
+  struct Entry {
+    QueuedDraw draw;
+    u32 drawDataOffset;
+    u32 numDrawDataBytes;
+  };
+
+  void sortDraws();
+  void growDraws();
+  void growDrawData(u32 min_num_bytes);
+
+  Entry *entries_;
+  // Sorted in place, the alt arrays are ping pong buffers for sortDraws
+  u64 *keys_;
+  u64 *alt_keys_;
+  u32 *order_;
+  u32 *alt_order_;
+  u32 num_draws_;
+  u32 draw_capacity_;
+
+  u8 *draw_data_;
+  u32 num_draw_data_bytes_;
+  u32 draw_data_capacity_;
+};
+
+template <typename T>
+void DrawQueue::add(u64 sort_key, const QueuedDraw &draw, T draw_data)
+{
+  *(T *)add(sort_key, draw, (u32)sizeof(T)) = draw_data;
+}
+
+u32 DrawQueue::numDraws() const
+{
+  return num_draws_;
+}
+
+}
@@ -3,6 +3,7 @@
 namespace gas {
 
 class RasterPassEncoder;
+class RenderBundleEncoder;
 class ComputePassEncoder;
 class CopyPassEncoder;
 class CommandEncoder;
@@ -23,5 +24,7 @@ struct RasterPassInterface;
 struct RasterPass;
 struct RasterShader;
 struct ComputeShader;
+struct RenderBundle;
+struct QuerySet;
 
 }
@@ -0,0 +1,149 @@
+#include "gas_geometry_pool.hpp"
+
+#include <madrona/crash.hpp>
+#include <madrona/memory.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace gas {
+namespace {
+
+constexpr inline u32 INIT_ENTRY_CAPACITY = 256;
+constexpr inline u32 FREE_LIST_END = 0xFFFF'FFFF;
+
+}
+
+GeometryPool::GeometryPool(GPURuntime *gpu, const GeometryPoolInit &init)
+  : gpu_(gpu),
+    vertex_buffer_(gpu->createBuffer({
+      .numBytes = init.vertexStride * init.maxNumVertices,
+      .usage = BufferUsage::DrawVertex | BufferUsage::CopyDst,
+    })),
+    index_buffer_(gpu->createBuffer({
+      .numBytes = init.maxNumIndices * (u32)sizeof(u32),
+      .usage = BufferUsage::DrawIndex | BufferUsage::CopyDst,
+    })),
+    vertex_stride_(init.vertexStride),
+    vertex_alloc_(init.maxNumVertices),
+    index_alloc_(init.maxNumIndices),
+    entries_(nullptr),
+    num_entries_(0),
+    entry_capacity_(0),
+    free_head_(FREE_LIST_END)
+{
+  // Buffer copies must be 4 byte aligned
+  assert(init.vertexStride % 4 == 0);
+}
+
+GeometryPool::~GeometryPool()
+{
+  if (entry_capacity_ > 0) {
+    rawDealloc(entries_);
+  }
+
+  gpu_->destroyBuffer(index_buffer_);
+  gpu_->destroyBuffer(vertex_buffer_);
+}
+
+MeshID GeometryPool::addMesh(CopyPassEncoder &enc,
+                             const GeometryMeshInit &init)
+{
+  assert(init.numVertices > 0 && init.numIndices % 3 == 0);
+
+  OffsetAllocation vertex_alloc = vertex_alloc_.alloc(init.numVertices);
+  if (vertex_alloc.offset == AllocOOM) {
+    return {};
+  }
+
+  OffsetAllocation index_alloc = index_alloc_.alloc(init.numIndices);
+  if (index_alloc.offset == AllocOOM) {
+    vertex_alloc_.dealloc(vertex_alloc);
+    return {};
+  }
+
+  u32 entry_idx;
+  if (free_head_ != FREE_LIST_END) {
+    entry_idx = free_head_;
+    free_head_ = entries_[entry_idx].nextFree;
+  } else {
+    if (num_entries_ == entry_capacity_) [[unlikely]] {
+      growEntries();
+    }
+    entry_idx = num_entries_++;
+  }
+
+  entries_[entry_idx] = Entry {
+    .mesh = {
+      .vertexOffset = vertex_alloc.offset,
+      .indexOffset = index_alloc.offset,
+      .numTriangles = init.numIndices / 3,
+    },
+    .vertexAlloc = vertex_alloc,
+    .indexAlloc = index_alloc,
+    .nextFree = FREE_LIST_END,
+  };
+
+  upload(enc, vertex_buffer_, vertex_alloc.offset * vertex_stride_,
+         init.vertices, init.numVertices * vertex_stride_);
+  upload(enc, index_buffer_, index_alloc.offset * (u32)sizeof(u32),
+         init.indices, init.numIndices * (u32)sizeof(u32));
+
+  return MeshID { entry_idx };
+}
+
+void GeometryPool::removeMesh(MeshID mesh_id)
+{
+  assert(mesh_id.id < num_entries_);
+  Entry &entry = entries_[mesh_id.id];
+
+  vertex_alloc_.dealloc(entry.vertexAlloc);
+  index_alloc_.dealloc(entry.indexAlloc);
+
+  entry.mesh = {};
+  entry.nextFree = free_head_;
+  free_head_ = mesh_id.id;
+}
+
+void GeometryPool::bind(RasterPassEncoder &enc, i32 vertex_buffer_idx) const
+{
+  enc.setVertexBuffer(vertex_buffer_idx, vertex_buffer_);
+  enc.setIndexBufferU32(index_buffer_);
+}
+
+// Staging memory is limited to one tmp block per allocation, so large
+// meshes are uploaded in multiple copies
+void GeometryPool::upload(CopyPassEncoder &enc, Buffer dst, u32 dst_offset,
+                          const void *data, u32 num_bytes)
+{
+  const u8 *src = (const u8 *)data;
+  while (num_bytes > 0) {
+    u32 num_copy_bytes = std::min(num_bytes, GPUTmpMemBlock::BLOCK_SIZE);
+
+    MappedTmpBuffer staging = enc.tmpBuffer(num_copy_bytes);
+    memcpy(staging.ptr, src, num_copy_bytes);
+    enc.copyBufferToBuffer(staging.buffer, dst, staging.offset, dst_offset,
+                           num_copy_bytes);
+
+    src += num_copy_bytes;
+    dst_offset += num_copy_bytes;
+    num_bytes -= num_copy_bytes;
+  }
+}
+
+void GeometryPool::growEntries()
+{
+  u32 new_capacity = entry_capacity_ == 0 ?
+      INIT_ENTRY_CAPACITY : entry_capacity_ * 2;
+
+  Entry *new_entries = (Entry *)rawAlloc(sizeof(Entry) * new_capacity);
+  if (entries_ != nullptr) {
+    memcpy(new_entries, entries_, sizeof(Entry) * num_entries_);
+    rawDealloc(entries_);
+  }
+
+  entries_ = new_entries;
+  entry_capacity_ = new_capacity;
+}
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "gas.hpp"
+#include "mem.hpp"
+
+namespace gas {
+
+// Suballocates the vertices and indices of many meshes out of a single
+// vertex buffer and a single u32 index buffer. Every mesh in the pool
+// shares one vertex layout, so the buffers only need to be bound once per
+// pass and switching meshes just changes the vertex / index offsets of
+// the draw instead of forcing vertex and index buffer rebinds.
+struct GeometryPoolInit {
+  // Size of a single vertex in bytes, must be a multiple of 4
+  u32 vertexStride;
+  u32 maxNumVertices;
+  u32 maxNumIndices;
+};
+
+struct GeometryMeshInit {
+  const void *vertices;
+  u32 numVertices;
+  // Triangle list, indices are relative to the mesh's first vertex
+  const u32 *indices;
+  u32 numIndices;
+};
+
+struct MeshID {
+  u32 id = 0xFFFF'FFFF;
+
+  inline bool null() const { return id == 0xFFFF'FFFF; }
+};
+
+// Offsets are in vertices and indices, as passed to drawIndexedInstanced
+struct GeometryMesh {
+  u32 vertexOffset;
+  u32 indexOffset;
+  u32 numTriangles;
+};
+
+class GeometryPool {
+public:
+  GeometryPool(GPURuntime *gpu, const GeometryPoolInit &init);
+  GeometryPool(const GeometryPool &) = delete;
+  ~GeometryPool();
+
+  // Allocates space for the mesh and encodes the upload into enc. Returns
+  // a null MeshID if either buffer is out of space.
+  MeshID addMesh(CopyPassEncoder &enc, const GeometryMeshInit &init);
+
+  // The mesh's ranges are immediately reusable by addMesh, so the caller
+  // must not remove meshes still referenced by unsubmitted draws.
+  void removeMesh(MeshID mesh_id);
+
+  inline GeometryMesh mesh(MeshID mesh_id) const;
+  inline Buffer vertexBuffer() const;
+  inline Buffer indexBuffer() const;
+
+  // Binds the pool's vertex buffer to vertex_buffer_idx and its index
+  // buffer. RasterPassEncoder skips the binds if they are already set.
+  void bind(RasterPassEncoder &enc, i32 vertex_buffer_idx = 0) const;
+
+  // Draws the mesh with the offsets from the pool. bind must have been
+  // called first.
+  inline void draw(RasterPassEncoder &enc, MeshID mesh_id,
+                   u32 instance_offset = 0, u32 num_instances = 1) const;
+
+private:
+  struct Entry {
+    GeometryMesh mesh;
+    OffsetAllocation vertexAlloc;
+    OffsetAllocation indexAlloc;
+    u32 nextFree;
+  };
+
+  void upload(CopyPassEncoder &enc, Buffer dst, u32 dst_offset,
+              const void *data, u32 num_bytes);
+  void growEntries();
+
+  GPURuntime *gpu_;
+  Buffer vertex_buffer_;
+  Buffer index_buffer_;
+  u32 vertex_stride_;
+  OffsetAllocator vertex_alloc_;
+  OffsetAllocator index_alloc_;
+
+  Entry *entries_;
+  u32 num_entries_;
+  u32 entry_capacity_;
+  u32 free_head_;
+};
+
+GeometryMesh GeometryPool::mesh(MeshID mesh_id) const
+{
+  assert(mesh_id.id < num_entries_);
+  return entries_[mesh_id.id].mesh;
+}
+
+Buffer GeometryPool::vertexBuffer() const
+{
+  return vertex_buffer_;
+}
+
+Buffer GeometryPool::indexBuffer() const
+{
+  return index_buffer_;
+}
+
+void GeometryPool::draw(RasterPassEncoder &enc, MeshID mesh_id,
+                        u32 instance_offset, u32 num_instances) const
+{
+  GeometryMesh m = mesh(mesh_id);
+  enc.drawIndexedInstanced(m.vertexOffset, m.indexOffset, m.numTriangles,
+                           instance_offset, num_instances);
+}
+
+}
@@ -0,0 +1,541 @@
+#include "gas_gpu_algorithms.hpp"
+
+#include <madrona/crash.hpp>
+#include <madrona/utils.hpp>
+
+namespace gas::GPUAlgorithms {
+namespace {
+
+// Must match AlgorithmArgs in gpu_algorithms_common.slang
+struct AlgorithmArgs {
+  u32 numElements;
+  u32 numBlocks;
+  u32 shift;
+  u32 flags;
+};
+
+constexpr inline u32 FLAG_BLOCK_OFFSETS = 1;
+constexpr inline u32 FLAG_PREDICATE = 2;
+
+struct AlgorithmsState {
+  // Bound to unused aux slots, so no slot aliases a buffer the same
+  // dispatch writes
+  Buffer placeholder;
+
+  ParamBlockType scanIOType;
+  ParamBlockType scatterIOType;
+
+  ComputeShader scanReduce;
+  ComputeShader scanBlocks;
+  ComputeShader segmentedReduce;
+  ComputeShader radixHistogram;
+  ComputeShader radixScatter;
+  ComputeShader compactScatter;
+};
+
+AlgorithmsState *state = nullptr;
+
+void loadShaders(GPURuntime *gpu,
+                 ShaderCompiler *shaderc,
+                 const char *path,
+                 ParamBlockType io_type,
+                 i32 num_entries,
+                 const char * const *entries,
+                 ComputeShader *shaders_out)
+{
+  StackAlloc alloc;
+  ShaderCompileResult compiled_shader = shaderc->compileShader(alloc, {
+    .path = path,
+  });
+
+  if (!compiled_shader.success) {
+    FATAL("Failed to compile gas gpu algorithms shader %s: %s\n",
+          path, compiled_shader.diagnostics.data());
+  }
+
+  ShaderByteCode byte_code = compiled_shader.getByteCodeForBackend(
+      gpu->backendShaderByteCodeType());
+
+  for (i32 i = 0; i < num_entries; i++) {
+    shaders_out[i] = gpu->createComputeShader({
+      .byteCode = byte_code,
+      .entry = entries[i],
+      .paramBlockTypes = { io_type },
+      .numPerDispatchBytes = sizeof(AlgorithmArgs),
+    });
+  }
+}
+
+BufferBinding placeholderBinding()
+{
+  return { .buffer = state->placeholder };
+}
+
+u32 numBlocksForElements(u32 num_elements)
+{
+  return utils::divideRoundUp(num_elements, BLOCK_NUM_ELEMS);
+}
+
+void dispatchAlgorithm(ComputePassEncoder &enc,
+                       ComputeShader shader,
+                       ParamBlock param_block,
+                       u32 num_blocks,
+                       AlgorithmArgs args)
+{
+  enc.setShader(shader);
+  enc.setParamBlock(0, param_block);
+  enc.dispatchData(args);
+  enc.dispatch(num_blocks);
+}
+
+}
+
+void init(GPURuntime *gpu, ShaderCompiler *shaderc)
+{
+  using enum ShaderStage;
+  using enum BufferBindingType;
+
+  if (state) {
+    FATAL("GPUAlgorithms already initialized");
+  }
+
+  state = new AlgorithmsState {};
+
+  state->placeholder = gpu->createBuffer({
+    .numBytes = 256,
+    .usage = BufferUsage::ShaderStorage,
+  });
+
+  state->scanIOType = gpu->createParamBlockType({
+    .uuid = "gas_gpu_algorithms_scan_io"_to_uuid,
+    .buffers = {
+      { .type = Storage, .shaderUsage = Compute },
+      { .type = StorageRW, .shaderUsage = Compute },
+      { .type = Storage, .shaderUsage = Compute },
+    },
+  });
+
+  state->scatterIOType = gpu->createParamBlockType({
+    .uuid = "gas_gpu_algorithms_scatter_io"_to_uuid,
+    .buffers = {
+      { .type = Storage, .shaderUsage = Compute },
+      { .type = Storage, .shaderUsage = Compute },
+      { .type = Storage, .shaderUsage = Compute },
+      { .type = StorageRW, .shaderUsage = Compute },
+      { .type = StorageRW, .shaderUsage = Compute },
+    },
+  });
+
+  {
+    const char *entries[] = {
+      "scanReduce",
+      "scanBlocks",
+      "segmentedReduce",
+      "radixHistogram",
+    };
+
+    ComputeShader shaders[4];
+    loadShaders(gpu, shaderc,
+                GAS_GPU_ALGORITHMS_SHADER_DIR "gpu_algorithms_scan.slang",
+                state->scanIOType, 4, entries, shaders);
+
+    state->scanReduce = shaders[0];
+    state->scanBlocks = shaders[1];
+    state->segmentedReduce = shaders[2];
+    state->radixHistogram = shaders[3];
+  }
+
+  {
+    const char *entries[] = {
+      "radixScatter",
+      "compactScatter",
+    };
+
+    ComputeShader shaders[2];
+    loadShaders(gpu, shaderc,
+                GAS_GPU_ALGORITHMS_SHADER_DIR "gpu_algorithms_scatter.slang",
+                state->scatterIOType, 2, entries, shaders);
+
+    state->radixScatter = shaders[0];
+    state->compactScatter = shaders[1];
+  }
+}
+
+void shutdown(GPURuntime *gpu)
+{
+  gpu->destroyComputeShader(state->compactScatter);
+  gpu->destroyComputeShader(state->radixScatter);
+  gpu->destroyComputeShader(state->radixHistogram);
+  gpu->destroyComputeShader(state->segmentedReduce);
+  gpu->destroyComputeShader(state->scanBlocks);
+  gpu->destroyComputeShader(state->scanReduce);
+
+  gpu->destroyParamBlockType(state->scatterIOType);
+  gpu->destroyParamBlockType(state->scanIOType);
+
+  gpu->destroyBuffer(state->placeholder);
+
+  delete state;
+  state = nullptr;
+}
+
+// Level 0 scans the input into the output. Each following level scans
+// the per-block sums of the previous level, and the final level fits in
+// a single block. Every level > 0 has its own sums & scanned buffers:
+// WebGPU tracks storage usage per buffer, so a dispatch can't read one
+// range of a buffer while writing another.
+ExclusiveScan createExclusiveScan(GPURuntime *gpu, ExclusiveScanInit init)
+{
+  u32 level_num_elems[MAX_SCAN_LEVELS];
+  i32 num_levels = 0;
+  {
+    u32 n = init.maxNumElements;
+    while (true) {
+      if (num_levels == MAX_SCAN_LEVELS) {
+        FATAL("GPUAlgorithms: %u elements is too large to scan",
+              init.maxNumElements);
+      }
+
+      level_num_elems[num_levels++] = n;
+
+      if (n <= BLOCK_NUM_ELEMS) {
+        break;
+      }
+
+      n = numBlocksForElements(n);
+    }
+  }
+
+  ExclusiveScan scan {};
+  scan.numLevels = num_levels;
+
+  for (i32 i = 1; i < num_levels; i++) {
+    u32 num_level_bytes = level_num_elems[i] * (u32)sizeof(u32);
+
+    scan.levelSums[i] = gpu->createBuffer({
+      .numBytes = num_level_bytes,
+      .usage = BufferUsage::ShaderStorage,
+    });
+
+    scan.levelScanned[i] = gpu->createBuffer({
+      .numBytes = num_level_bytes,
+      .usage = BufferUsage::ShaderStorage,
+    });
+  }
+
+  auto levelInput = [&](i32 level) -> BufferBinding {
+    return { .buffer = level == 0 ? init.input : scan.levelSums[level] };
+  };
+
+  auto levelOutput = [&](i32 level) -> BufferBinding {
+    return { .buffer = level == 0 ? init.output : scan.levelScanned[level] };
+  };
+
+  for (i32 i = 0; i < num_levels; i++) {
+    BufferBinding input = levelInput(i);
+
+    if (i < num_levels - 1) {
+      scan.reduceBlocks[i] = gpu->createParamBlock({
+        .typeID = state->scanIOType,
+        .buffers = { input, levelInput(i + 1), placeholderBinding() },
+      });
+    }
+
+    // The top level has no block offsets
+    scan.scanBlocks[i] = gpu->createParamBlock({
+      .typeID = state->scanIOType,
+      .buffers = {
+        input,
+        levelOutput(i),
+        i < num_levels - 1 ? levelOutput(i + 1) : placeholderBinding(),
+      },
+    });
+  }
+
+  return scan;
+}
+
+void destroyExclusiveScan(GPURuntime *gpu, ExclusiveScan &scan)
+{
+  for (i32 i = 0; i < scan.numLevels; i++) {
+    if (i < scan.numLevels - 1) {
+      gpu->destroyParamBlock(scan.reduceBlocks[i]);
+    }
+    gpu->destroyParamBlock(scan.scanBlocks[i]);
+
+    if (i > 0) {
+      gpu->destroyBuffer(scan.levelScanned[i]);
+      gpu->destroyBuffer(scan.levelSums[i]);
+    }
+  }
+
+  scan = {};
+}
+
+namespace {
+
+// input_flags only apply to the elements of the level 0 input, higher
+// levels scan the per-block sums as is
+void encodeExclusiveScan(ComputePassEncoder &enc,
+                         const ExclusiveScan &scan,
+                         u32 num_elements,
+                         u32 input_flags)
+{
+  if (num_elements == 0) {
+    return;
+  }
+
+  u32 level_num_elems[MAX_SCAN_LEVELS];
+  i32 top_level = 0;
+  level_num_elems[0] = num_elements;
+  while (level_num_elems[top_level] > BLOCK_NUM_ELEMS) {
+    level_num_elems[top_level + 1] =
+        numBlocksForElements(level_num_elems[top_level]);
+    top_level += 1;
+  }
+  assert(top_level < scan.numLevels);
+
+  for (i32 i = 0; i < top_level; i++) {
+    dispatchAlgorithm(enc, state->scanReduce, scan.reduceBlocks[i],
+                      level_num_elems[i + 1], {
+      .numElements = level_num_elems[i],
+      .numBlocks = level_num_elems[i + 1],
+      .shift = 0,
+      .flags = i == 0 ? input_flags : 0,
+    });
+  }
+
+  for (i32 i = top_level; i >= 0; i--) {
+    u32 num_blocks = numBlocksForElements(level_num_elems[i]);
+
+    dispatchAlgorithm(enc, state->scanBlocks, scan.scanBlocks[i],
+                      num_blocks, {
+      .numElements = level_num_elems[i],
+      .numBlocks = num_blocks,
+      .shift = 0,
+      .flags = (i < top_level ? FLAG_BLOCK_OFFSETS : 0) |
+          (i == 0 ? input_flags : 0),
+    });
+  }
+}
+
+}
+
+void exclusiveScan(ComputePassEncoder &enc,
+                   const ExclusiveScan &scan,
+                   u32 num_elements)
+{
+  encodeExclusiveScan(enc, scan, num_elements, 0);
+}
+
+SegmentedReduce createSegmentedReduce(GPURuntime *gpu,
+                                      SegmentedReduceInit init)
+{
+  return SegmentedReduce {
+    .paramBlock = gpu->createParamBlock({
+      .typeID = state->scanIOType,
+      .buffers = {
+        { .buffer = init.values },
+        { .buffer = init.output },
+        { .buffer = init.segmentOffsets },
+      },
+    }),
+  };
+}
+
+void destroySegmentedReduce(GPURuntime *gpu, SegmentedReduce &reduce)
+{
+  gpu->destroyParamBlock(reduce.paramBlock);
+  reduce = {};
+}
+
+void segmentedReduce(ComputePassEncoder &enc,
+                     const SegmentedReduce &reduce,
+                     u32 num_values,
+                     u32 num_segments)
+{
+  if (num_segments == 0) {
+    return;
+  }
+
+  dispatchAlgorithm(enc, state->segmentedReduce, reduce.paramBlock,
+                    num_segments, {
+    .numElements = num_values,
+    .numBlocks = num_segments,
+    .shift = 0,
+    .flags = 0,
+  });
+}
+
+RadixSort createRadixSort(GPURuntime *gpu, RadixSortInit init)
+{
+  u32 num_bytes = init.maxNumElements * (u32)sizeof(u32);
+  u32 num_histogram_bytes = std::max(
+      numBlocksForElements(init.maxNumElements), 1_u32) *
+      RADIX_NUM_BINS * (u32)sizeof(u32);
+
+  RadixSort sort {};
+
+  sort.tmpKeys = gpu->createBuffer({
+    .numBytes = num_bytes,
+    .usage = BufferUsage::ShaderStorage,
+  });
+
+  sort.tmpValues = gpu->createBuffer({
+    .numBytes = num_bytes,
+    .usage = BufferUsage::ShaderStorage,
+  });
+
+  sort.histogram = gpu->createBuffer({
+    .numBytes = num_histogram_bytes,
+    .usage = BufferUsage::ShaderStorage,
+  });
+
+  sort.histogramOffsets = gpu->createBuffer({
+    .numBytes = num_histogram_bytes,
+    .usage = BufferUsage::ShaderStorage,
+  });
+
+  sort.histogramScan = createExclusiveScan(gpu, {
+    .input = sort.histogram,
+    .output = sort.histogramOffsets,
+    .maxNumElements = num_histogram_bytes / (u32)sizeof(u32),
+  });
+
+  Buffer keys[2] = { init.keys, sort.tmpKeys };
+  Buffer values[2] = { init.values, sort.tmpValues };
+
+  for (i32 i = 0; i < 2; i++) {
+    sort.histogramBlocks[i] = gpu->createParamBlock({
+      .typeID = state->scanIOType,
+      .buffers = {
+        { .buffer = keys[i] },
+        { .buffer = sort.histogram },
+        placeholderBinding(),
+      },
+    });
+
+    sort.scatterBlocks[i] = gpu->createParamBlock({
+      .typeID = state->scatterIOType,
+      .buffers = {
+        { .buffer = keys[i] },
+        { .buffer = values[i] },
+        { .buffer = sort.histogramOffsets },
+        { .buffer = keys[i ^ 1] },
+        { .buffer = values[i ^ 1] },
+      },
+    });
+  }
+
+  return sort;
+}
+
+void destroyRadixSort(GPURuntime *gpu, RadixSort &sort)
+{
+  for (i32 i = 0; i < 2; i++) {
+    gpu->destroyParamBlock(sort.scatterBlocks[i]);
+    gpu->destroyParamBlock(sort.histogramBlocks[i]);
+  }
+
+  destroyExclusiveScan(gpu, sort.histogramScan);
+
+  gpu->destroyBuffer(sort.histogramOffsets);
+  gpu->destroyBuffer(sort.histogram);
+  gpu->destroyBuffer(sort.tmpValues);
+  gpu->destroyBuffer(sort.tmpKeys);
+
+  sort = {};
+}
+
+void radixSort(ComputePassEncoder &enc,
+               const RadixSort &sort,
+               u32 num_elements,
+               u32 num_key_bits)
+{
+  assert(num_key_bits > 0 && num_key_bits <= 32 && num_key_bits % 8 == 0);
+
+  if (num_elements == 0) {
+    return;
+  }
+
+  u32 num_blocks = numBlocksForElements(num_elements);
+  u32 num_passes = num_key_bits / RADIX_NUM_BITS;
+
+  for (u32 pass_idx = 0; pass_idx < num_passes; pass_idx++) {
+    AlgorithmArgs args {
+      .numElements = num_elements,
+      .numBlocks = num_blocks,
+      .shift = pass_idx * RADIX_NUM_BITS,
+      .flags = 0,
+    };
+
+    dispatchAlgorithm(enc, state->radixHistogram,
+                      sort.histogramBlocks[pass_idx & 1], num_blocks, args);
+
+    exclusiveScan(enc, sort.histogramScan, num_blocks * RADIX_NUM_BINS);
+
+    dispatchAlgorithm(enc, state->radixScatter,
+                      sort.scatterBlocks[pass_idx & 1], num_blocks, args);
+  }
+}
+
+StreamCompaction createStreamCompaction(GPURuntime *gpu,
+                                        StreamCompactionInit init)
+{
+  StreamCompaction compaction {};
+
+  compaction.flagOffsets = gpu->createBuffer({
+    .numBytes = std::max(init.maxNumElements, 1_u32) * (u32)sizeof(u32),
+    .usage = BufferUsage::ShaderStorage,
+  });
+
+  compaction.flagScan = createExclusiveScan(gpu, {
+    .input = init.flags,
+    .output = compaction.flagOffsets,
+    .maxNumElements = init.maxNumElements,
+  });
+
+  compaction.scatterBlock = gpu->createParamBlock({
+    .typeID = state->scatterIOType,
+    .buffers = {
+      { .buffer = init.input },
+      { .buffer = init.flags },
+      { .buffer = compaction.flagOffsets },
+      { .buffer = init.output },
+      { .buffer = init.outputCount },
+    },
+  });
+
+  return compaction;
+}
+
+void destroyStreamCompaction(GPURuntime *gpu, StreamCompaction &compaction)
+{
+  gpu->destroyParamBlock(compaction.scatterBlock);
+  destroyExclusiveScan(gpu, compaction.flagScan);
+  gpu->destroyBuffer(compaction.flagOffsets);
+
+  compaction = {};
+}
+
+void streamCompaction(ComputePassEncoder &enc,
+                      const StreamCompaction &compaction,
+                      u32 num_elements)
+{
+  // Flags can hold any non-zero value, so scan whether each is set
+  encodeExclusiveScan(enc, compaction.flagScan, num_elements,
+                      FLAG_PREDICATE);
+
+  // Always dispatch at least one block so outputCount is written
+  u32 num_blocks = std::max(numBlocksForElements(num_elements), 1_u32);
+
+  dispatchAlgorithm(enc, state->compactScatter, compaction.scatterBlock,
+                    num_blocks, {
+    .numElements = num_elements,
+    .numBlocks = num_blocks,
+    .shift = 0,
+    .flags = 0,
+  });
+}
+
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "gas.hpp"
+#include "shader_compiler.hpp"
+
+namespace gas {
+
+// Device-wide parallel primitives built on gas compute passes.
+// All primitives operate on u32 elements. Buffers passed to the create
+// functions must be created with BufferUsage::ShaderStorage. Each
+// primitive is created once for a maximum element count so its param
+// blocks and scratch memory can be reused every frame; the actual
+// element count is passed when encoding.
+namespace GPUAlgorithms {
+
+// Number of elements processed by a single compute block (workgroup)
+constexpr inline u32 BLOCK_NUM_ELEMS = 1024;
+constexpr inline i32 MAX_SCAN_LEVELS = 3;
+constexpr inline u32 RADIX_NUM_BITS = 4;
+constexpr inline u32 RADIX_NUM_BINS = 1 << RADIX_NUM_BITS;
+
+struct ExclusiveScanInit {
+  Buffer input;
+  Buffer output;
+  u32 maxNumElements;
+};
+
+struct ExclusiveScan {
+  // Per-block sums of the previous level and their scan, for levels > 0
+  Buffer levelSums[MAX_SCAN_LEVELS] = {};
+  Buffer levelScanned[MAX_SCAN_LEVELS] = {};
+  i32 numLevels = 0;
+  ParamBlock reduceBlocks[MAX_SCAN_LEVELS] = {};
+  ParamBlock scanBlocks[MAX_SCAN_LEVELS] = {};
+};
+
+struct SegmentedReduceInit {
+  Buffer values;
+  // Start offset of each segment into values. Segment i ends at the
+  // start of segment i + 1, the last segment ends at num_values.
+  Buffer segmentOffsets;
+  Buffer output;
+};
+
+struct SegmentedReduce {
+  ParamBlock paramBlock = {};
+};
+
+struct RadixSortInit {
+  Buffer keys;
+  Buffer values;
+  u32 maxNumElements;
+};
+
+struct RadixSort {
+  Buffer tmpKeys = {};
+  Buffer tmpValues = {};
+  Buffer histogram = {};
+  Buffer histogramOffsets = {};
+  ExclusiveScan histogramScan = {};
+  ParamBlock histogramBlocks[2] = {};
+  ParamBlock scatterBlocks[2] = {};
+};
+
+struct StreamCompactionInit {
+  Buffer input;
+  // Elements with a non-zero flag are kept
+  Buffer flags;
+  Buffer output;
+  // Receives the number of elements written to output as a single u32
+  Buffer outputCount;
+  u32 maxNumElements;
+};
+
+struct StreamCompaction {
+  Buffer flagOffsets = {};
+  ExclusiveScan flagScan = {};
+  ParamBlock scatterBlock = {};
+};
+
+void init(GPURuntime *gpu, ShaderCompiler *shaderc);
+void shutdown(GPURuntime *gpu);
+
+ExclusiveScan createExclusiveScan(GPURuntime *gpu, ExclusiveScanInit init);
+void destroyExclusiveScan(GPURuntime *gpu, ExclusiveScan &scan);
+
+void exclusiveScan(ComputePassEncoder &enc,
+                   const ExclusiveScan &scan,
+                   u32 num_elements);
+
+SegmentedReduce createSegmentedReduce(GPURuntime *gpu,
+                                      SegmentedReduceInit init);
+void destroySegmentedReduce(GPURuntime *gpu, SegmentedReduce &reduce);
+
+void segmentedReduce(ComputePassEncoder &enc,
+                     const SegmentedReduce &reduce,
+                     u32 num_values,
+                     u32 num_segments);
+
+RadixSort createRadixSort(GPURuntime *gpu, RadixSortInit init);
+void destroyRadixSort(GPURuntime *gpu, RadixSort &sort);
+
+// Stable key / value sort of the low num_key_bits of each key.
+// num_key_bits must be a multiple of 8 so the sorted result ends up
+// back in the keys & values buffers passed to createRadixSort.
+void radixSort(ComputePassEncoder &enc,
+               const RadixSort &sort,
+               u32 num_elements,
+               u32 num_key_bits = 32);
+
+StreamCompaction createStreamCompaction(GPURuntime *gpu,
+                                        StreamCompactionInit init);
+void destroyStreamCompaction(GPURuntime *gpu, StreamCompaction &compaction);
+
+void streamCompaction(ComputePassEncoder &enc,
+                      const StreamCompaction &compaction,
+                      u32 num_elements);
+
+}
+
+}
@@ -0,0 +1,348 @@
+#include "gas_gpu_culling.hpp"
+
+#include <madrona/crash.hpp>
+#include <madrona/utils.hpp>
+
+#include <cmath>
+
+namespace gas::GPUCulling {
+namespace {
+
+// Must match CullArgs in gpu_culling.slang
+struct CullArgs {
+  Vector4 frustumPlanes[6];
+  Vector4 viewProj[4];
+  u32 numInstances;
+  u32 numDraws;
+  u32 flags;
+  u32 numPyramidLevels;
+  u32 pyramidWidth;
+  u32 pyramidHeight;
+  u32 pad[2];
+};
+
+// Must match PyramidArgs in gpu_depth_pyramid.slang
+struct PyramidArgs {
+  u32 srcWidth;
+  u32 srcHeight;
+  u32 srcOffset;
+  u32 dstWidth;
+  u32 dstHeight;
+  u32 dstOffset;
+  u32 flags;
+  u32 pad;
+};
+
+constexpr inline u32 FLAG_OCCLUSION = 1;
+constexpr inline u32 FLAG_FROM_DEPTH = 1;
+constexpr inline u32 FLAG_REVERSED_Z = 2;
+
+constexpr inline u32 CULL_NUM_THREADS = 64;
+constexpr inline u32 PYRAMID_NUM_THREADS_XY = 8;
+
+struct CullingState {
+  ParamBlockType cullIOType;
+  ParamBlockType pyramidIOType;
+
+  ComputeShader resetDrawArgs;
+  ComputeShader cullInstances;
+  ComputeShader buildPyramidLevel;
+};
+
+CullingState *state = nullptr;
+
+ShaderCompileResult compileShader(ShaderCompiler *shaderc,
+                                  StackAlloc &alloc,
+                                  const char *path)
+{
+  ShaderCompileResult compiled_shader = shaderc->compileShader(alloc, {
+    .path = path,
+  });
+
+  if (!compiled_shader.success) {
+    FATAL("Failed to compile gas gpu culling shader %s: %s\n",
+          path, compiled_shader.diagnostics.data());
+  }
+
+  return compiled_shader;
+}
+
+u32 nextPyramidLevelDim(u32 dim)
+{
+  return std::max((dim + 1) / 2, 1_u32);
+}
+
+// Gribb & Hartmann plane extraction for a [0, 1] clip space depth range
+void extractFrustumPlanes(const Vector4 *rows, Vector4 *planes_out)
+{
+  auto add = [](Vector4 a, Vector4 b) {
+    return Vector4 { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w };
+  };
+
+  auto sub = [](Vector4 a, Vector4 b) {
+    return Vector4 { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w };
+  };
+
+  planes_out[0] = add(rows[3], rows[0]);
+  planes_out[1] = sub(rows[3], rows[0]);
+  planes_out[2] = add(rows[3], rows[1]);
+  planes_out[3] = sub(rows[3], rows[1]);
+  planes_out[4] = rows[2];
+  planes_out[5] = sub(rows[3], rows[2]);
+
+  for (i32 i = 0; i < 6; i++) {
+    Vector4 &plane = planes_out[i];
+    float len = sqrtf(plane.x * plane.x + plane.y * plane.y +
+                      plane.z * plane.z);
+
+    // Degenerate planes (infinite far plane) never cull
+    if (len == 0.f) {
+      plane = Vector4 { 0, 0, 0, 1 };
+    } else {
+      plane = Vector4 {
+        plane.x / len, plane.y / len, plane.z / len, plane.w / len };
+    }
+  }
+}
+
+}
+
+void init(GPURuntime *gpu, ShaderCompiler *shaderc)
+{
+  using enum ShaderStage;
+  using enum BufferBindingType;
+
+  if (state) {
+    FATAL("GPUCulling already initialized");
+  }
+
+  state = new CullingState {};
+
+  state->cullIOType = gpu->createParamBlockType({
+    .uuid = "gas_gpu_culling_cull_io"_to_uuid,
+    .buffers = {
+      { .type = Storage, .shaderUsage = Compute },
+      { .type = Storage, .shaderUsage = Compute },
+      { .type = StorageRW, .shaderUsage = Compute },
+      { .type = StorageRW, .shaderUsage = Compute },
+      { .type = Storage, .shaderUsage = Compute },
+    },
+  });
+
+  state->pyramidIOType = gpu->createParamBlockType({
+    .uuid = "gas_gpu_culling_pyramid_io"_to_uuid,
+    .buffers = {
+      { .type = StorageRW, .shaderUsage = Compute },
+    },
+    .textures = {
+      {
+        .type = TextureBindingType::DepthTexture2D,
+        .shaderUsage = Compute,
+      },
+    },
+  });
+
+  ShaderByteCodeType byte_code_type = gpu->backendShaderByteCodeType();
+
+  {
+    StackAlloc alloc;
+    ShaderCompileResult compiled = compileShader(shaderc, alloc,
+        GAS_GPU_CULLING_SHADER_DIR "gpu_culling.slang");
+    ShaderByteCode byte_code = compiled.getByteCodeForBackend(byte_code_type);
+
+    state->resetDrawArgs = gpu->createComputeShader({
+      .byteCode = byte_code,
+      .entry = "resetDrawArgs",
+      .paramBlockTypes = { state->cullIOType },
+      .numPerDispatchBytes = sizeof(CullArgs),
+    });
+
+    state->cullInstances = gpu->createComputeShader({
+      .byteCode = byte_code,
+      .entry = "cullInstances",
+      .paramBlockTypes = { state->cullIOType },
+      .numPerDispatchBytes = sizeof(CullArgs),
+    });
+  }
+
+  {
+    StackAlloc alloc;
+    ShaderCompileResult compiled = compileShader(shaderc, alloc,
+        GAS_GPU_CULLING_SHADER_DIR "gpu_depth_pyramid.slang");
+
+    state->buildPyramidLevel = gpu->createComputeShader({
+      .byteCode = compiled.getByteCodeForBackend(byte_code_type),
+      .entry = "buildPyramidLevel",
+      .paramBlockTypes = { state->pyramidIOType },
+      .numPerDispatchBytes = sizeof(PyramidArgs),
+    });
+  }
+}
+
+void shutdown(GPURuntime *gpu)
+{
+  gpu->destroyComputeShader(state->buildPyramidLevel);
+  gpu->destroyComputeShader(state->cullInstances);
+  gpu->destroyComputeShader(state->resetDrawArgs);
+
+  gpu->destroyParamBlockType(state->pyramidIOType);
+  gpu->destroyParamBlockType(state->cullIOType);
+
+  delete state;
+  state = nullptr;
+}
+
+Culling createCulling(GPURuntime *gpu, CullingInit init)
+{
+  Culling culling {};
+
+  if (!init.depth.null()) {
+    culling.depthWidth = init.depthWidth;
+    culling.depthHeight = init.depthHeight;
+    culling.pyramidWidth = nextPyramidLevelDim(init.depthWidth);
+    culling.pyramidHeight = nextPyramidLevelDim(init.depthHeight);
+
+    u32 num_pyramid_texels = 0;
+    u32 width = culling.pyramidWidth;
+    u32 height = culling.pyramidHeight;
+    while (true) {
+      if (culling.numPyramidLevels == MAX_DEPTH_PYRAMID_LEVELS) {
+        FATAL("GPUCulling: %ux%u depth texture is too large",
+              init.depthWidth, init.depthHeight);
+      }
+
+      culling.numPyramidLevels += 1;
+      num_pyramid_texels += width * height;
+
+      if (width == 1 && height == 1) {
+        break;
+      }
+
+      width = nextPyramidLevelDim(width);
+      height = nextPyramidLevelDim(height);
+    }
+
+    culling.depthPyramid = gpu->createBuffer({
+      .numBytes = num_pyramid_texels * (u32)sizeof(float),
+      .usage = BufferUsage::ShaderStorage,
+    });
+
+    culling.pyramidBlock = gpu->createParamBlock({
+      .typeID = state->pyramidIOType,
+      .buffers = {
+        { .buffer = culling.depthPyramid },
+      },
+      .textures = { init.depth },
+    });
+  }
+
+  // Without occlusion culling the pyramid is never read, bind the draw
+  // templates as a placeholder
+  culling.cullBlock = gpu->createParamBlock({
+    .typeID = state->cullIOType,
+    .buffers = {
+      { .buffer = init.instanceBounds },
+      { .buffer = init.drawTemplates },
+      { .buffer = init.drawArgs },
+      { .buffer = init.visibleInstances },
+      { .buffer = init.depth.null() ?
+          init.drawTemplates : culling.depthPyramid },
+    },
+  });
+
+  return culling;
+}
+
+void destroyCulling(GPURuntime *gpu, Culling &culling)
+{
+  gpu->destroyParamBlock(culling.cullBlock);
+
+  if (!culling.depthPyramid.null()) {
+    gpu->destroyParamBlock(culling.pyramidBlock);
+    gpu->destroyBuffer(culling.depthPyramid);
+  }
+
+  culling = {};
+}
+
+void buildDepthPyramid(ComputePassEncoder &enc,
+                       const Culling &culling,
+                       bool reversed_z)
+{
+  assert(!culling.depthPyramid.null());
+
+  enc.setShader(state->buildPyramidLevel);
+  enc.setParamBlock(0, culling.pyramidBlock);
+
+  PyramidArgs args {
+    .srcWidth = culling.depthWidth,
+    .srcHeight = culling.depthHeight,
+    .srcOffset = 0,
+    .dstWidth = culling.pyramidWidth,
+    .dstHeight = culling.pyramidHeight,
+    .dstOffset = 0,
+    .flags = FLAG_FROM_DEPTH | (reversed_z ? FLAG_REVERSED_Z : 0),
+    .pad = 0,
+  };
+
+  for (i32 level = 0; level < culling.numPyramidLevels; level++) {
+    enc.dispatchData(args);
+    enc.dispatch(
+        utils::divideRoundUp(args.dstWidth, PYRAMID_NUM_THREADS_XY),
+        utils::divideRoundUp(args.dstHeight, PYRAMID_NUM_THREADS_XY));
+
+    args.srcWidth = args.dstWidth;
+    args.srcHeight = args.dstHeight;
+    args.srcOffset = args.dstOffset;
+    args.dstOffset += args.dstWidth * args.dstHeight;
+    args.dstWidth = nextPyramidLevelDim(args.dstWidth);
+    args.dstHeight = nextPyramidLevelDim(args.dstHeight);
+    args.flags &= ~FLAG_FROM_DEPTH;
+  }
+}
+
+void cull(ComputePassEncoder &enc,
+          const Culling &culling,
+          const CullingCamera &camera,
+          u32 num_instances,
+          u32 num_draws)
+{
+  if (num_draws == 0) {
+    return;
+  }
+
+  CullArgs args;
+  extractFrustumPlanes(camera.viewProj, args.frustumPlanes);
+  for (i32 i = 0; i < 4; i++) {
+    args.viewProj[i] = camera.viewProj[i];
+  }
+  args.numInstances = num_instances;
+  args.numDraws = num_draws;
+  args.flags = 0;
+  if (!culling.depthPyramid.null()) {
+    args.flags |= FLAG_OCCLUSION;
+  }
+  if (camera.reversedZ) {
+    args.flags |= FLAG_REVERSED_Z;
+  }
+  args.numPyramidLevels = (u32)culling.numPyramidLevels;
+  args.pyramidWidth = culling.pyramidWidth;
+  args.pyramidHeight = culling.pyramidHeight;
+  args.pad[0] = 0;
+  args.pad[1] = 0;
+
+  enc.setShader(state->resetDrawArgs);
+  enc.setParamBlock(0, culling.cullBlock);
+  enc.dispatchData(args);
+  enc.dispatch(utils::divideRoundUp(num_draws, CULL_NUM_THREADS));
+
+  if (num_instances == 0) {
+    return;
+  }
+
+  enc.setShader(state->cullInstances);
+  enc.dispatchData(args);
+  enc.dispatch(utils::divideRoundUp(num_instances, CULL_NUM_THREADS));
+}
+
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "gas.hpp"
+#include "shader_compiler.hpp"
+
+namespace gas {
+
+// GPU driven frustum & occlusion culling. Each instance's world space
+// bounding sphere is tested against the camera, and visible instances
+// are appended to a compacted list of instance indices along with one
+// DrawIndexedIndirectArgs per draw, ready to be consumed by
+// RasterPassEncoder::drawIndexedIndirect.
+//
+// Draw d's visible instance indices are written to visibleInstances
+// starting at DrawTemplate::instanceOffset. The draw's first instance is
+// always 0, since WebGPU devices without indirect first instance support
+// skip indirect draws that set it. Instead, pass the instance offset to
+// the vertex shader as per draw data and fetch the instance with
+// visibleInstances[instanceOffset + instance_index].
+namespace GPUCulling {
+
+constexpr inline i32 MAX_DEPTH_PYRAMID_LEVELS = 16;
+
+// Must match InstanceBounds in gpu_culling.slang
+struct InstanceBounds {
+  Vector3 center;
+  float radius;
+  u32 drawIdx;
+  u32 pad[3];
+};
+
+// Must match DrawTemplate in gpu_culling.slang
+struct DrawTemplate {
+  u32 numIndices;
+  u32 indexOffset;
+  i32 vertexOffset;
+  u32 instanceOffset;
+};
+
+// Layout of the arguments consumed by indexed indirect draws
+struct DrawIndexedIndirectArgs {
+  u32 numIndices;
+  u32 numInstances;
+  u32 indexOffset;
+  i32 vertexOffset;
+  // Always 0, see above
+  u32 instanceOffset;
+};
+
+struct CullingCamera {
+  // Rows of the world to clip space transform
+  Vector4 viewProj[4];
+  // Set when rendering with DepthCompare::GreaterOrEqual (far plane at 0)
+  bool reversedZ = false;
+};
+
+struct CullingInit {
+  // InstanceBounds per instance
+  Buffer instanceBounds;
+  // DrawTemplate per draw
+  Buffer drawTemplates;
+  // DrawIndexedIndirectArgs per draw. Must be created with
+  // BufferUsage::ShaderStorage | BufferUsage::IndirectArgs
+  Buffer drawArgs;
+  // Receives the u32 indices of visible instances
+  Buffer visibleInstances;
+
+  // Optional Depth32_Float texture, usually the previous frame's depth
+  // buffer. When set, instances hidden behind it are culled as well.
+  // Must be created with TextureUsage::ShaderSampled.
+  Texture depth = {};
+  u32 depthWidth = 0;
+  u32 depthHeight = 0;
+};
+
+struct Culling {
+  ParamBlock cullBlock = {};
+
+  Buffer depthPyramid = {};
+  ParamBlock pyramidBlock = {};
+  u32 pyramidWidth = 0;
+  u32 pyramidHeight = 0;
+  i32 numPyramidLevels = 0;
+  u32 depthWidth = 0;
+  u32 depthHeight = 0;
+};
+
+void init(GPURuntime *gpu, ShaderCompiler *shaderc);
+void shutdown(GPURuntime *gpu);
+
+Culling createCulling(GPURuntime *gpu, CullingInit init);
+void destroyCulling(GPURuntime *gpu, Culling &culling);
+
+// Rebuilds the max (or min with reversed_z) depth pyramid used for
+// occlusion culling from the depth texture passed to createCulling.
+// Encode after the depth texture has been rendered.
+void buildDepthPyramid(ComputePassEncoder &enc,
+                       const Culling &culling,
+                       bool reversed_z = false);
+
+// Resets the draw arguments and culls num_instances instances. Occlusion
+// culling is only performed if the culling stage has a depth texture,
+// against the pyramid from the last buildDepthPyramid call.
+void cull(ComputePassEncoder &enc,
+          const Culling &culling,
+          const CullingCamera &camera,
+          u32 num_instances,
+          u32 num_draws);
+
+}
+
+}
@@ -0,0 +1,143 @@
+#include "gas_render_target_pool.hpp"
+
+#include <madrona/crash.hpp>
+#include <madrona/memory.hpp>
+
+#include <cstring>
+
+namespace gas {
+namespace {
+
+constexpr inline u32 INIT_ENTRY_CAPACITY = 32;
+
+bool descsMatch(const RenderTargetDesc &a, const RenderTargetDesc &b)
+{
+  return a.format == b.format &&
+      a.width == b.width &&
+      a.height == b.height &&
+      a.numSamples == b.numSamples &&
+      a.usage == b.usage;
+}
+
+}
+
+RenderTargetPool::RenderTargetPool(GPURuntime *gpu,
+                                   RenderTargetPoolInit init)
+  : gpu_(gpu),
+    max_idle_frames_(init.maxIdleFrames),
+    cur_frame_(0),
+    entries_(nullptr),
+    num_entries_(0),
+    entry_capacity_(0)
+{}
+
+RenderTargetPool::~RenderTargetPool()
+{
+  for (u32 i = 0; i < num_entries_; i++) {
+    gpu_->destroyTexture(entries_[i].texture);
+  }
+
+  if (entry_capacity_ > 0) {
+    rawDealloc(entries_);
+  }
+}
+
+Texture RenderTargetPool::acquire(const RenderTargetDesc &desc)
+{
+  for (u32 i = 0; i < num_entries_; i++) {
+    Entry &entry = entries_[i];
+    if (!descsMatch(entry.desc, desc)) {
+      continue;
+    }
+
+    if (entry.state == State::Pending &&
+        gpu_->isSubmitFinished(entry.pendingToken)) {
+      entry.state = State::Free;
+    }
+
+    if (entry.state == State::Free || entry.state == State::Released) {
+      entry.state = State::Acquired;
+      entry.lastUsedFrame = cur_frame_;
+      return entry.texture;
+    }
+  }
+
+  if (num_entries_ == entry_capacity_) [[unlikely]] {
+    growEntries();
+  }
+
+  Texture texture = gpu_->createTexture({
+    .format = desc.format,
+    .width = desc.width,
+    .height = desc.height,
+    .numSamples = desc.numSamples,
+    .usage = desc.usage,
+  });
+
+  entries_[num_entries_++] = Entry {
+    .desc = desc,
+    .texture = texture,
+    .state = State::Acquired,
+    .pendingToken = {},
+    .lastUsedFrame = cur_frame_,
+  };
+
+  return texture;
+}
+
+void RenderTargetPool::release(Texture target)
+{
+  for (u32 i = 0; i < num_entries_; i++) {
+    Entry &entry = entries_[i];
+    if (entry.texture == target) {
+      assert(entry.state == State::Acquired);
+      entry.state = State::Released;
+      return;
+    }
+  }
+
+  assert(false);
+}
+
+void RenderTargetPool::endFrame(GPUSubmitToken submit_token)
+{
+  for (u32 i = 0; i < num_entries_;) {
+    Entry &entry = entries_[i];
+
+    if (entry.state == State::Acquired || entry.state == State::Released) {
+      entry.state = State::Pending;
+      entry.pendingToken = submit_token;
+    } else if (entry.state == State::Pending &&
+               gpu_->isSubmitFinished(entry.pendingToken)) {
+      entry.state = State::Free;
+    }
+
+    if (entry.state == State::Free &&
+        cur_frame_ - entry.lastUsedFrame >= max_idle_frames_) {
+      gpu_->destroyTexture(entry.texture);
+      entries_[i] = entries_[--num_entries_];
+      continue;
+    }
+
+    i++;
+  }
+
+  cur_frame_ += 1;
+}
+
+void RenderTargetPool::growEntries()
+{
+  u32 new_capacity = entry_capacity_ == 0 ?
+      INIT_ENTRY_CAPACITY : entry_capacity_ * 2;
+
+  Entry *new_entries = (Entry *)rawAlloc(sizeof(Entry) * new_capacity);
+  if (entries_ != nullptr) {
+    memcpy(new_entries, entries_, sizeof(Entry) * num_entries_);
+    rawDealloc(entries_);
+  }
+
+  entries_ = new_entries;
+  entry_capacity_ = new_capacity;
+}
+
+}
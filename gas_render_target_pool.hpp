@@ -0,0 +1,83 @@
+#pragma once
+
+#include "gas.hpp"
+
+namespace gas {
+
+// Frame scoped allocator for intermediate render targets. Textures are
+// handed out by (format, size, samples, usage) and reused rather than
+// created and destroyed every frame:
+//
+// - A target released during a frame can be acquired again by later
+//   passes of the same frame. Work submitted to a queue executes in
+//   encode order, so passes whose targets are live at different times
+//   share the same physical texture.
+// - At endFrame, every target used during the frame is held until the
+//   frame's submission completes, then recycled for future frames.
+//
+// Targets are looked up with a linear search, which is intended for the
+// tens of targets a frame's post processing chain uses, not thousands.
+struct RenderTargetDesc {
+  TextureFormat format;
+  u16 width;
+  u16 height;
+  u16 numSamples = 1;
+  TextureUsage usage = TextureUsage::ColorAttachment |
+      TextureUsage::ShaderSampled;
+};
+
+struct RenderTargetPoolInit {
+  // Free targets that haven't been acquired for this many frames are
+  // destroyed at endFrame
+  u32 maxIdleFrames = 8;
+};
+
+class RenderTargetPool {
+public:
+  RenderTargetPool(GPURuntime *gpu, RenderTargetPoolInit init = {});
+  RenderTargetPool(const RenderTargetPool &) = delete;
+  ~RenderTargetPool();
+
+  Texture acquire(const RenderTargetDesc &desc);
+  // target can be returned by acquire for passes encoded after this call
+  void release(Texture target);
+
+  // Releases any targets still held. They, and all targets released during
+  // the frame, can only be acquired again once submit_token has finished.
+  void endFrame(GPUSubmitToken submit_token);
+
+  inline u32 numTargets() const;
+
+private:
+  enum class State : u32 {
+    Free,
+    Acquired,
+    Released,
+    Pending,
+  };
+
+  struct Entry {
+    RenderTargetDesc desc;
+    Texture texture;
+    State state;
+    GPUSubmitToken pendingToken;
+    u64 lastUsedFrame;
+  };
+
+  void growEntries();
+
+  GPURuntime *gpu_;
+  u32 max_idle_frames_;
+  u64 cur_frame_;
+
+  Entry *entries_;
+  u32 num_entries_;
+  u32 entry_capacity_;
+};
+
+u32 RenderTargetPool::numTargets() const
+{
+  return num_entries_;
+}
+
+}
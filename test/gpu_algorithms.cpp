@@ -0,0 +1,299 @@
+#include "test_gpu.hpp"
+#include "gas_gpu_algorithms.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace gas::test {
+namespace {
+
+class GPUAlgorithmsTest : public GPUTest {
+protected:
+  void SetUp() override
+  {
+    main_queue_ = gpu->getMainQueue();
+    GPUAlgorithms::init(gpu, shaderc);
+    enc_ = gpu->createCommandEncoder(main_queue_);
+  }
+
+  void TearDown() override
+  {
+    gpu->waitUntilIdle();
+
+    gpu->destroyCommandEncoder(enc_);
+    GPUAlgorithms::shutdown(gpu);
+  }
+
+  Buffer createBuffer(const std::vector<u32> &data)
+  {
+    u32 num_bytes = std::max((u32)(data.size() * sizeof(u32)), 4_u32);
+    Buffer buffer = gpu->createBuffer({
+      .numBytes = num_bytes,
+      .usage = BufferUsage::ShaderStorage |
+          BufferUsage::CopySrc | BufferUsage::CopyDst,
+    });
+
+    if (data.size() == 0) {
+      return buffer;
+    }
+
+    Buffer staging = gpu->createStagingBuffer(num_bytes);
+    void *staging_ptr;
+    gpu->prepareStagingBuffers(1, &staging, &staging_ptr);
+    memcpy(staging_ptr, data.data(), num_bytes);
+    gpu->flushStagingBuffers(1, &staging);
+
+    enc_.beginEncoding();
+    CopyPassEncoder copy_enc = enc_.beginCopyPass();
+    copy_enc.copyBufferToBuffer(staging, buffer, 0, 0, num_bytes);
+    enc_.endCopyPass(copy_enc);
+    enc_.endEncoding();
+
+    gpu->submit(main_queue_, enc_);
+    gpu->waitUntilWorkFinished(main_queue_);
+
+    gpu->destroyStagingBuffer(staging);
+
+    return buffer;
+  }
+
+  std::vector<u32> readback(Buffer buffer, u32 num_elems)
+  {
+    u32 num_bytes = num_elems * sizeof(u32);
+    Buffer readback_buf = gpu->createReadbackBuffer(num_bytes);
+
+    enc_.beginEncoding();
+    CopyPassEncoder copy_enc = enc_.beginCopyPass();
+    copy_enc.copyBufferToBuffer(buffer, readback_buf, 0, 0, num_bytes);
+    enc_.endCopyPass(copy_enc);
+    enc_.endEncoding();
+
+    gpu->submit(main_queue_, enc_);
+    gpu->waitUntilWorkFinished(main_queue_);
+
+    std::vector<u32> out(num_elems);
+    u32 *ptr = (u32 *)gpu->beginReadback(readback_buf);
+    memcpy(out.data(), ptr, num_bytes);
+    gpu->endReadback(readback_buf);
+
+    gpu->destroyReadbackBuffer(readback_buf);
+
+    return out;
+  }
+
+  template <typename Fn>
+  void runCompute(Fn &&fn)
+  {
+    enc_.beginEncoding();
+    ComputePassEncoder compute_enc = enc_.beginComputePass();
+    fn(compute_enc);
+    enc_.endComputePass(compute_enc);
+    enc_.endEncoding();
+
+    gpu->submit(main_queue_, enc_);
+    gpu->waitUntilWorkFinished(main_queue_);
+  }
+
+  GPUQueue main_queue_;
+  CommandEncoder enc_;
+};
+
+std::vector<u32> randomValues(u32 num_elems, u32 max_value, u32 seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<u32> dist(0, max_value);
+
+  std::vector<u32> values(num_elems);
+  for (u32 &v : values) {
+    v = dist(rng);
+  }
+
+  return values;
+}
+
+TEST_F(GPUAlgorithmsTest, ExclusiveScan)
+{
+  // Multi level scan with a partial final block
+  const u32 max_num_elems = 2 * 1024 * 1024 + 17;
+  std::vector<u32> input = randomValues(max_num_elems, 16, 0);
+
+  Buffer in_buf = createBuffer(input);
+  Buffer out_buf = createBuffer(std::vector<u32>(max_num_elems, 0));
+
+  GPUAlgorithms::ExclusiveScan scan = GPUAlgorithms::createExclusiveScan(
+      gpu, {
+    .input = in_buf,
+    .output = out_buf,
+    .maxNumElements = max_num_elems,
+  });
+
+  for (u32 num_elems : { max_num_elems, 1000_u32, 5000_u32 }) {
+    runCompute([&](ComputePassEncoder &compute_enc) {
+      GPUAlgorithms::exclusiveScan(compute_enc, scan, num_elems);
+    });
+
+    std::vector<u32> result = readback(out_buf, num_elems);
+
+    u32 sum = 0;
+    for (u32 i = 0; i < num_elems; i++) {
+      ASSERT_EQ(result[i], sum) << "num_elems: " << num_elems << " i: " << i;
+      sum += input[i];
+    }
+  }
+
+  GPUAlgorithms::destroyExclusiveScan(gpu, scan);
+  gpu->destroyBuffer(out_buf);
+  gpu->destroyBuffer(in_buf);
+}
+
+TEST_F(GPUAlgorithmsTest, SegmentedReduce)
+{
+  const u32 num_values = 100000;
+  std::vector<u32> values = randomValues(num_values, 100, 1);
+
+  std::vector<u32> segment_offsets = { 0, 0, 1, 300, 5000, 5001, 99999 };
+  const u32 num_segments = (u32)segment_offsets.size();
+
+  Buffer values_buf = createBuffer(values);
+  Buffer offsets_buf = createBuffer(segment_offsets);
+  Buffer out_buf = createBuffer(std::vector<u32>(num_segments, 0xFFFF'FFFF));
+
+  GPUAlgorithms::SegmentedReduce reduce =
+      GPUAlgorithms::createSegmentedReduce(gpu, {
+    .values = values_buf,
+    .segmentOffsets = offsets_buf,
+    .output = out_buf,
+  });
+
+  runCompute([&](ComputePassEncoder &compute_enc) {
+    GPUAlgorithms::segmentedReduce(compute_enc, reduce,
+                                   num_values, num_segments);
+  });
+
+  std::vector<u32> result = readback(out_buf, num_segments);
+
+  for (u32 i = 0; i < num_segments; i++) {
+    u32 start = segment_offsets[i];
+    u32 end = i + 1 < num_segments ? segment_offsets[i + 1] : num_values;
+
+    u32 sum = 0;
+    for (u32 j = start; j < end; j++) {
+      sum += values[j];
+    }
+
+    EXPECT_EQ(result[i], sum) << "segment: " << i;
+  }
+
+  GPUAlgorithms::destroySegmentedReduce(gpu, reduce);
+  gpu->destroyBuffer(out_buf);
+  gpu->destroyBuffer(offsets_buf);
+  gpu->destroyBuffer(values_buf);
+}
+
+TEST_F(GPUAlgorithmsTest, RadixSort)
+{
+  const u32 num_elems = 300000;
+  std::vector<u32> keys = randomValues(num_elems, 0xFFFF'FFFF, 2);
+
+  // Lots of duplicate keys in the low 16 bits to check stability
+  for (u32 i = 0; i < num_elems; i += 2) {
+    keys[i] &= 0xFF;
+  }
+
+  std::vector<u32> values(num_elems);
+  for (u32 i = 0; i < num_elems; i++) {
+    values[i] = i;
+  }
+
+  Buffer keys_buf = createBuffer(keys);
+  Buffer values_buf = createBuffer(values);
+
+  GPUAlgorithms::RadixSort sort = GPUAlgorithms::createRadixSort(gpu, {
+    .keys = keys_buf,
+    .values = values_buf,
+    .maxNumElements = num_elems,
+  });
+
+  runCompute([&](ComputePassEncoder &compute_enc) {
+    GPUAlgorithms::radixSort(compute_enc, sort, num_elems);
+  });
+
+  std::vector<u32> sorted_keys = readback(keys_buf, num_elems);
+  std::vector<u32> sorted_values = readback(values_buf, num_elems);
+
+  std::vector<u32> expected(num_elems);
+  for (u32 i = 0; i < num_elems; i++) {
+    expected[i] = i;
+  }
+  std::stable_sort(expected.begin(), expected.end(),
+    [&](u32 a, u32 b) {
+      return keys[a] < keys[b];
+    });
+
+  for (u32 i = 0; i < num_elems; i++) {
+    ASSERT_EQ(sorted_values[i], expected[i]) << "i: " << i;
+    ASSERT_EQ(sorted_keys[i], keys[expected[i]]) << "i: " << i;
+  }
+
+  GPUAlgorithms::destroyRadixSort(gpu, sort);
+  gpu->destroyBuffer(values_buf);
+  gpu->destroyBuffer(keys_buf);
+}
+
+TEST_F(GPUAlgorithmsTest, StreamCompaction)
+{
+  const u32 num_elems = 50000;
+  std::vector<u32> input = randomValues(num_elems, 0xFFFF'FFFF, 3);
+  // Any non-zero flag keeps its element, not just 1
+  std::vector<u32> flags = randomValues(num_elems, 3, 4);
+
+  Buffer in_buf = createBuffer(input);
+  Buffer flags_buf = createBuffer(flags);
+  Buffer out_buf = createBuffer(std::vector<u32>(num_elems, 0));
+  Buffer count_buf = createBuffer({ 0xFFFF'FFFF });
+
+  GPUAlgorithms::StreamCompaction compaction =
+      GPUAlgorithms::createStreamCompaction(gpu, {
+    .input = in_buf,
+    .flags = flags_buf,
+    .output = out_buf,
+    .outputCount = count_buf,
+    .maxNumElements = num_elems,
+  });
+
+  runCompute([&](ComputePassEncoder &compute_enc) {
+    GPUAlgorithms::streamCompaction(compute_enc, compaction, num_elems);
+  });
+
+  std::vector<u32> expected;
+  for (u32 i = 0; i < num_elems; i++) {
+    if (flags[i] != 0) {
+      expected.push_back(input[i]);
+    }
+  }
+
+  std::vector<u32> count = readback(count_buf, 1);
+  ASSERT_EQ(count[0], (u32)expected.size());
+
+  std::vector<u32> result = readback(out_buf, (u32)expected.size());
+  for (u32 i = 0; i < (u32)expected.size(); i++) {
+    ASSERT_EQ(result[i], expected[i]) << "i: " << i;
+  }
+
+  runCompute([&](ComputePassEncoder &compute_enc) {
+    GPUAlgorithms::streamCompaction(compute_enc, compaction, 0);
+  });
+
+  count = readback(count_buf, 1);
+  EXPECT_EQ(count[0], 0_u32);
+
+  GPUAlgorithms::destroyStreamCompaction(gpu, compaction);
+  gpu->destroyBuffer(count_buf);
+  gpu->destroyBuffer(out_buf);
+  gpu->destroyBuffer(flags_buf);
+  gpu->destroyBuffer(in_buf);
+}
+
+}
+}
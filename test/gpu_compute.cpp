@@ -0,0 +1,318 @@
+#include "test_gpu.hpp"
+
+namespace gas::test {
+namespace {
+
+class GPUCompute : public GPUTest {
+protected:
+  ComputeShader setupComputeTestShader(const char *entry,
+                                       u32 num_per_dispatch_bytes = 0)
+  {
+    auto backend_bytecode_type = gpuAPI->backendShaderByteCodeType();
+
+    StackAlloc shaderc_alloc;
+    ShaderByteCode shader_bytecode;
+    {
+      ShaderCompileResult compile_result =
+        shaderc->compileShader(shaderc_alloc, {
+          .path = GAS_TEST_DIR "compute.slang",
+        });
+
+      if (compile_result.diagnostics.size() != 0) {
+        fprintf(stderr, "%s", compile_result.diagnostics.data());
+      }
+
+      if (!compile_result.success) {
+        FATAL("Shader compilation failed!");
+      }
+
+      shader_bytecode =
+          compile_result.getByteCodeForBackend(backend_bytecode_type);
+    }
+
+    ComputeShader shader = gpu->createComputeShader({
+      .byteCode = shader_bytecode,
+      .entry = entry,
+      .paramBlockTypes = { param_block_type_ },
+      .numPerDispatchBytes = num_per_dispatch_bytes,
+    });
+    shaderc_alloc.release();
+
+    return shader;
+  }
+
+  void SetUp() override
+  {
+    main_queue_ = gpu->getMainQueue();
+
+    param_block_type_ = gpu->createParamBlockType({
+      .uuid = "compute_test_pb"_to_uuid,
+      .buffers = {
+        {
+          .type = BufferBindingType::StorageRW,
+          .shaderUsage = ShaderStage::Compute,
+        },
+      },
+    });
+
+    shader_ = setupComputeTestShader("doubleValues");
+    data_shader_ = setupComputeTestShader("addDispatchData", sizeof(u32));
+  }
+
+  void TearDown() override
+  {
+    gpu->waitUntilIdle();
+
+    gpu->destroyComputeShader(data_shader_);
+    gpu->destroyComputeShader(shader_);
+    gpu->destroyParamBlockType(param_block_type_);
+  }
+
+  GPUQueue main_queue_;
+  ParamBlockType param_block_type_;
+  ComputeShader shader_;
+  ComputeShader data_shader_;
+};
+
+TEST_F(GPUCompute, Dispatch)
+{
+  constexpr u32 num_values = 64 * 16;
+  constexpr u32 num_bytes = num_values * sizeof(u32);
+
+  Buffer values = gpu->createBuffer({
+    .numBytes = num_bytes,
+    .usage = BufferUsage::ShaderStorage |
+        BufferUsage::CopySrc | BufferUsage::CopyDst,
+  });
+
+  ParamBlock param_block = gpu->createParamBlock({
+    .typeID = param_block_type_,
+    .buffers = {
+      { .buffer = values },
+    },
+  });
+
+  Buffer readback = gpu->createReadbackBuffer(num_bytes);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+
+    MappedTmpBuffer init = copy_enc.tmpBuffer(num_bytes);
+    for (u32 i = 0; i < num_values; i++) {
+      ((u32 *)init.ptr)[i] = i;
+    }
+
+    copy_enc.copyBufferToBuffer(init.buffer, values,
+                                init.offset, 0, num_bytes);
+    enc.endCopyPass(copy_enc);
+  }
+
+  {
+    ComputePassEncoder compute_enc = enc.beginComputePass();
+    compute_enc.setShader(shader_);
+    compute_enc.setParamBlock(0, param_block);
+    compute_enc.dispatch(num_values / 64);
+    // Second dispatch only re-encodes the ctrl word since no state changed
+    compute_enc.dispatch(num_values / 64);
+    enc.endComputePass(compute_enc);
+  }
+
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+    copy_enc.copyBufferToBuffer(values, readback, 0, 0, num_bytes);
+    enc.endCopyPass(copy_enc);
+  }
+
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  {
+    u32 *readback_ptr = (u32 *)gpu->beginReadback(readback);
+
+    for (u32 i = 0; i < num_values; i++) {
+      EXPECT_EQ(readback_ptr[i], (i * 2 + i) * 2 + i);
+    }
+
+    gpu->endReadback(readback);
+  }
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyReadbackBuffer(readback);
+  gpu->destroyParamBlock(param_block);
+  gpu->destroyBuffer(values);
+}
+
+TEST_F(GPUCompute, DispatchIndirect)
+{
+  constexpr u32 num_values = 64 * 16;
+  constexpr u32 num_bytes = num_values * sizeof(u32);
+
+  Buffer values = gpu->createBuffer({
+    .numBytes = num_bytes,
+    .usage = BufferUsage::ShaderStorage |
+        BufferUsage::CopySrc | BufferUsage::CopyDst,
+  });
+
+  Buffer args = gpu->createBuffer({
+    .numBytes = 256,
+    .usage = BufferUsage::IndirectArgs | BufferUsage::CopyDst,
+  });
+
+  ParamBlock param_block = gpu->createParamBlock({
+    .typeID = param_block_type_,
+    .buffers = {
+      { .buffer = values },
+    },
+  });
+
+  Buffer readback = gpu->createReadbackBuffer(num_bytes);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+
+    MappedTmpBuffer init = copy_enc.tmpBuffer(num_bytes);
+    for (u32 i = 0; i < num_values; i++) {
+      ((u32 *)init.ptr)[i] = i;
+    }
+
+    copy_enc.copyBufferToBuffer(init.buffer, values,
+                                init.offset, 0, num_bytes);
+
+    // Only dispatch over the first half of the buffer
+    MappedTmpBuffer init_args = copy_enc.tmpBuffer(4 * sizeof(u32));
+    ((u32 *)init_args.ptr)[0] = 0;
+    ((u32 *)init_args.ptr)[1] = num_values / 128;
+    ((u32 *)init_args.ptr)[2] = 1;
+    ((u32 *)init_args.ptr)[3] = 1;
+
+    copy_enc.copyBufferToBuffer(init_args.buffer, args,
+                                init_args.offset, 0, 4 * sizeof(u32));
+    enc.endCopyPass(copy_enc);
+  }
+
+  {
+    ComputePassEncoder compute_enc = enc.beginComputePass();
+    compute_enc.setShader(shader_);
+    compute_enc.setParamBlock(0, param_block);
+    compute_enc.dispatchIndirect(args, sizeof(u32));
+    enc.endComputePass(compute_enc);
+  }
+
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+    copy_enc.copyBufferToBuffer(values, readback, 0, 0, num_bytes);
+    enc.endCopyPass(copy_enc);
+  }
+
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  {
+    u32 *readback_ptr = (u32 *)gpu->beginReadback(readback);
+
+    for (u32 i = 0; i < num_values; i++) {
+      if (i < num_values / 2) {
+        EXPECT_EQ(readback_ptr[i], i * 2 + i);
+      } else {
+        EXPECT_EQ(readback_ptr[i], i);
+      }
+    }
+
+    gpu->endReadback(readback);
+  }
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyReadbackBuffer(readback);
+  gpu->destroyParamBlock(param_block);
+  gpu->destroyBuffer(args);
+  gpu->destroyBuffer(values);
+}
+
+TEST_F(GPUCompute, DispatchData)
+{
+  constexpr u32 num_values = 64 * 16;
+  constexpr u32 num_bytes = num_values * sizeof(u32);
+  constexpr i32 num_dispatches = 8;
+
+  Buffer values = gpu->createBuffer({
+    .numBytes = num_bytes,
+    .usage = BufferUsage::ShaderStorage |
+        BufferUsage::CopySrc | BufferUsage::CopyDst,
+  });
+
+  ParamBlock param_block = gpu->createParamBlock({
+    .typeID = param_block_type_,
+    .buffers = {
+      { .buffer = values },
+    },
+  });
+
+  Buffer readback = gpu->createReadbackBuffer(num_bytes);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+    copy_enc.clearBuffer(values, 0, num_bytes);
+    enc.endCopyPass(copy_enc);
+  }
+
+  {
+    ComputePassEncoder compute_enc = enc.beginComputePass();
+    compute_enc.setShader(data_shader_);
+    compute_enc.setParamBlock(0, param_block);
+
+    for (i32 i = 0; i < num_dispatches; i++) {
+      compute_enc.dispatchData<u32>(u32(i + 1));
+      compute_enc.dispatch(num_values / 64);
+    }
+
+    enc.endComputePass(compute_enc);
+  }
+
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+    copy_enc.copyBufferToBuffer(values, readback, 0, 0, num_bytes);
+    enc.endCopyPass(copy_enc);
+  }
+
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  {
+    u32 *readback_ptr = (u32 *)gpu->beginReadback(readback);
+
+    for (u32 i = 0; i < num_values; i++) {
+      EXPECT_EQ(readback_ptr[i], num_dispatches * (num_dispatches + 1) / 2);
+    }
+
+    gpu->endReadback(readback);
+  }
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyReadbackBuffer(readback);
+  gpu->destroyParamBlock(param_block);
+  gpu->destroyBuffer(values);
+}
+
+}
+}
@@ -0,0 +1,149 @@
+#include "test_gpu.hpp"
+
+#include <vector>
+
+namespace gas::test {
+namespace {
+
+class GPUCopy : public GPUTest {
+protected:
+  void SetUp() override
+  {
+    main_queue_ = gpu->getMainQueue();
+    enc_ = gpu->createCommandEncoder(main_queue_);
+  }
+
+  void TearDown() override
+  {
+    gpu->waitUntilIdle();
+
+    gpu->destroyCommandEncoder(enc_);
+  }
+
+  GPUQueue main_queue_;
+  CommandEncoder enc_;
+};
+
+TEST_F(GPUCopy, ScatterUpdate)
+{
+  constexpr u32 num_values = 64 * 1024;
+  constexpr u32 num_bytes = num_values * sizeof(u32);
+  constexpr u32 num_regions = 4096;
+  constexpr u32 region_num_values = 12;
+
+  Buffer buffer = gpu->createBuffer({
+    .numBytes = num_bytes,
+    .usage = BufferUsage::ShaderStorage |
+        BufferUsage::CopySrc | BufferUsage::CopyDst,
+  });
+  Buffer readback_buf = gpu->createReadbackBuffer(num_bytes);
+
+  std::vector<u32> expected(num_values, 0);
+  std::vector<u32> region_data(num_regions * region_num_values);
+  std::vector<ScatterRegion> regions(num_regions);
+
+  // Every 16 values, update the first region_num_values. Regions are
+  // listed back to front to make sure they aren't assumed to be sorted.
+  for (u32 i = 0; i < num_regions; i++) {
+    u32 region_idx = num_regions - i - 1;
+    u32 dst_value_offset = region_idx * 16;
+
+    u32 *data = region_data.data() + i * region_num_values;
+    for (u32 j = 0; j < region_num_values; j++) {
+      data[j] = region_idx * 1000 + j + 1;
+      expected[dst_value_offset + j] = data[j];
+    }
+
+    regions[i] = {
+      .dstOffset = dst_value_offset * (u32)sizeof(u32),
+      .numBytes = region_num_values * (u32)sizeof(u32),
+      .data = data,
+    };
+  }
+
+  enc_.beginEncoding();
+  {
+    CopyPassEncoder copy_enc = enc_.beginCopyPass();
+    copy_enc.clearBuffer(buffer, 0, num_bytes);
+    copy_enc.scatterUpdate(buffer, { regions.data(), (i64)regions.size() });
+    copy_enc.copyBufferToBuffer(buffer, readback_buf, 0, 0, num_bytes);
+    enc_.endCopyPass(copy_enc);
+  }
+  enc_.endEncoding();
+
+  gpu->submit(main_queue_, enc_);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  u32 *readback_ptr = (u32 *)gpu->beginReadback(readback_buf);
+  for (u32 i = 0; i < num_values; i++) {
+    EXPECT_EQ(readback_ptr[i], expected[i]);
+  }
+  gpu->endReadback(readback_buf);
+
+  gpu->destroyReadbackBuffer(readback_buf);
+  gpu->destroyBuffer(buffer);
+}
+
+TEST_F(GPUCopy, ScatterUpdateLargeRegion)
+{
+  // The middle region doesn't fit in a single tmp staging block and must
+  // be split across packs
+  constexpr u32 num_values = 2 * 1024 * 1024;
+  constexpr u32 num_bytes = num_values * sizeof(u32);
+  constexpr u32 large_num_values = num_values - 64;
+
+  Buffer buffer = gpu->createBuffer({
+    .numBytes = num_bytes,
+    .usage = BufferUsage::ShaderStorage |
+        BufferUsage::CopySrc | BufferUsage::CopyDst,
+  });
+  Buffer readback_buf = gpu->createReadbackBuffer(num_bytes);
+
+  std::vector<u32> expected(num_values, 0);
+  for (u32 i = 0; i < num_values; i++) {
+    expected[i] = i + 1;
+  }
+
+  ScatterRegion regions[] = {
+    {
+      .dstOffset = 0,
+      .numBytes = 32 * (u32)sizeof(u32),
+      .data = expected.data(),
+    },
+    {
+      .dstOffset = 32 * (u32)sizeof(u32),
+      .numBytes = large_num_values * (u32)sizeof(u32),
+      .data = expected.data() + 32,
+    },
+    {
+      .dstOffset = (32 + large_num_values) * (u32)sizeof(u32),
+      .numBytes = 32 * (u32)sizeof(u32),
+      .data = expected.data() + 32 + large_num_values,
+    },
+  };
+
+  enc_.beginEncoding();
+  {
+    CopyPassEncoder copy_enc = enc_.beginCopyPass();
+    copy_enc.clearBuffer(buffer, 0, num_bytes);
+    copy_enc.scatterUpdate(buffer, { regions, 3 });
+    copy_enc.copyBufferToBuffer(buffer, readback_buf, 0, 0, num_bytes);
+    enc_.endCopyPass(copy_enc);
+  }
+  enc_.endEncoding();
+
+  gpu->submit(main_queue_, enc_);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  u32 *readback_ptr = (u32 *)gpu->beginReadback(readback_buf);
+  for (u32 i = 0; i < num_values; i++) {
+    ASSERT_EQ(readback_ptr[i], expected[i]);
+  }
+  gpu->endReadback(readback_buf);
+
+  gpu->destroyReadbackBuffer(readback_buf);
+  gpu->destroyBuffer(buffer);
+}
+
+}
+}
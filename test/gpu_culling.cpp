@@ -0,0 +1,461 @@
+#include "test_gpu.hpp"
+#include "gas_gpu_culling.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace gas::test {
+namespace {
+
+using GPUCulling::InstanceBounds;
+using GPUCulling::DrawTemplate;
+using GPUCulling::DrawIndexedIndirectArgs;
+
+class GPUCullingTest : public GPUTest {
+protected:
+  void SetUp() override
+  {
+    main_queue_ = gpu->getMainQueue();
+    GPUCulling::init(gpu, shaderc);
+    enc_ = gpu->createCommandEncoder(main_queue_);
+  }
+
+  void TearDown() override
+  {
+    gpu->waitUntilIdle();
+
+    gpu->destroyCommandEncoder(enc_);
+    GPUCulling::shutdown(gpu);
+  }
+
+  Buffer createBuffer(u32 num_bytes, BufferUsage usage,
+                      const void *data = nullptr)
+  {
+    Buffer buffer = gpu->createBuffer({
+      .numBytes = num_bytes,
+      .usage = usage | BufferUsage::CopySrc | BufferUsage::CopyDst,
+    });
+
+    if (data) {
+      enc_.beginEncoding();
+      CopyPassEncoder copy_enc = enc_.beginCopyPass();
+      MappedTmpBuffer staging = copy_enc.tmpBuffer(num_bytes);
+      memcpy(staging.ptr, data, num_bytes);
+      copy_enc.copyBufferToBuffer(staging.buffer, buffer,
+                                  staging.offset, 0, num_bytes);
+      enc_.endCopyPass(copy_enc);
+      enc_.endEncoding();
+
+      gpu->submit(main_queue_, enc_);
+      gpu->waitUntilWorkFinished(main_queue_);
+    }
+
+    return buffer;
+  }
+
+  template <typename T>
+  std::vector<T> readback(Buffer buffer, u32 num_elems)
+  {
+    u32 num_bytes = num_elems * (u32)sizeof(T);
+    Buffer readback_buf = gpu->createReadbackBuffer(num_bytes);
+
+    enc_.beginEncoding();
+    CopyPassEncoder copy_enc = enc_.beginCopyPass();
+    copy_enc.copyBufferToBuffer(buffer, readback_buf, 0, 0, num_bytes);
+    enc_.endCopyPass(copy_enc);
+    enc_.endEncoding();
+
+    gpu->submit(main_queue_, enc_);
+    gpu->waitUntilWorkFinished(main_queue_);
+
+    std::vector<T> out(num_elems);
+    memcpy(out.data(), gpu->beginReadback(readback_buf), num_bytes);
+    gpu->endReadback(readback_buf);
+
+    gpu->destroyReadbackBuffer(readback_buf);
+
+    return out;
+  }
+
+  std::vector<u32> visibleForDraw(const std::vector<u32> &visible,
+                                  const DrawTemplate &draw,
+                                  const DrawIndexedIndirectArgs &args)
+  {
+    std::vector<u32> out(visible.begin() + draw.instanceOffset,
+        visible.begin() + draw.instanceOffset + args.numInstances);
+    std::sort(out.begin(), out.end());
+    return out;
+  }
+
+  GPUQueue main_queue_;
+  CommandEncoder enc_;
+};
+
+// Identity transform: the visible volume is x, y in [-1, 1], z in [0, 1]
+GPUCulling::CullingCamera identityCamera()
+{
+  return {
+    .viewProj = {
+      { 1, 0, 0, 0 },
+      { 0, 1, 0, 0 },
+      { 0, 0, 1, 0 },
+      { 0, 0, 0, 1 },
+    },
+  };
+}
+
+InstanceBounds sphere(float x, float y, float z, u32 draw_idx)
+{
+  return InstanceBounds {
+    .center = { x, y, z },
+    .radius = 0.1f,
+    .drawIdx = draw_idx,
+    .pad = {},
+  };
+}
+
+TEST_F(GPUCullingTest, Frustum)
+{
+  InstanceBounds instances[] = {
+    sphere(0, 0, 0.5f, 0),
+    sphere(5, 0, 0.5f, 0),
+    sphere(-0.5f, 0.5f, 0.3f, 0),
+    sphere(0, 0, -2, 1),
+    sphere(1.05f, 0, 0.5f, 1),
+    sphere(0, 3, 0.5f, 2),
+  };
+  constexpr u32 num_instances = sizeof(instances) / sizeof(InstanceBounds);
+
+  DrawTemplate draws[] = {
+    { .numIndices = 36, .indexOffset = 0, .vertexOffset = 0,
+      .instanceOffset = 0 },
+    { .numIndices = 6, .indexOffset = 36, .vertexOffset = 24,
+      .instanceOffset = 3 },
+    { .numIndices = 3, .indexOffset = 42, .vertexOffset = 28,
+      .instanceOffset = 5 },
+  };
+  constexpr u32 num_draws = sizeof(draws) / sizeof(DrawTemplate);
+
+  Buffer instances_buf = createBuffer(
+      sizeof(instances), BufferUsage::ShaderStorage, instances);
+  Buffer draws_buf = createBuffer(
+      sizeof(draws), BufferUsage::ShaderStorage, draws);
+  Buffer args_buf = createBuffer(
+      num_draws * sizeof(DrawIndexedIndirectArgs),
+      BufferUsage::ShaderStorage | BufferUsage::IndirectArgs);
+  Buffer visible_buf = createBuffer(
+      num_instances * sizeof(u32), BufferUsage::ShaderStorage);
+
+  GPUCulling::Culling culling = GPUCulling::createCulling(gpu, {
+    .instanceBounds = instances_buf,
+    .drawTemplates = draws_buf,
+    .drawArgs = args_buf,
+    .visibleInstances = visible_buf,
+  });
+
+  enc_.beginEncoding();
+  {
+    ComputePassEncoder compute_enc = enc_.beginComputePass();
+    GPUCulling::cull(compute_enc, culling, identityCamera(),
+                     num_instances, num_draws);
+    enc_.endComputePass(compute_enc);
+  }
+  enc_.endEncoding();
+
+  gpu->submit(main_queue_, enc_);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  std::vector<DrawIndexedIndirectArgs> args =
+      readback<DrawIndexedIndirectArgs>(args_buf, num_draws);
+  std::vector<u32> visible = readback<u32>(visible_buf, num_instances);
+
+  for (u32 i = 0; i < num_draws; i++) {
+    EXPECT_EQ(args[i].numIndices, draws[i].numIndices);
+    EXPECT_EQ(args[i].indexOffset, draws[i].indexOffset);
+    EXPECT_EQ(args[i].vertexOffset, draws[i].vertexOffset);
+    EXPECT_EQ(args[i].instanceOffset, 0_u32);
+  }
+
+  ASSERT_EQ(args[0].numInstances, 2_u32);
+  ASSERT_EQ(args[1].numInstances, 1_u32);
+  ASSERT_EQ(args[2].numInstances, 0_u32);
+
+  EXPECT_EQ(visibleForDraw(visible, draws[0], args[0]), std::vector<u32>({ 0, 2 }));
+  EXPECT_EQ(visibleForDraw(visible, draws[1], args[1]), std::vector<u32>({ 4 }));
+
+  GPUCulling::destroyCulling(gpu, culling);
+  gpu->destroyBuffer(visible_buf);
+  gpu->destroyBuffer(args_buf);
+  gpu->destroyBuffer(draws_buf);
+  gpu->destroyBuffer(instances_buf);
+}
+
+TEST_F(GPUCullingTest, Occlusion)
+{
+  constexpr u16 depth_res = 64;
+
+  InstanceBounds instances[] = {
+    sphere(0, 0, 0.2f, 0),
+    sphere(0, 0, 0.8f, 0),
+    sphere(0.5f, -0.5f, 0.45f, 0),
+  };
+  constexpr u32 num_instances = sizeof(instances) / sizeof(InstanceBounds);
+
+  DrawTemplate draws[] = {
+    { .numIndices = 36, .indexOffset = 0, .vertexOffset = 0,
+      .instanceOffset = 0 },
+  };
+
+  Buffer instances_buf = createBuffer(
+      sizeof(instances), BufferUsage::ShaderStorage, instances);
+  Buffer draws_buf = createBuffer(
+      sizeof(draws), BufferUsage::ShaderStorage, draws);
+  Buffer args_buf = createBuffer(
+      sizeof(DrawIndexedIndirectArgs),
+      BufferUsage::ShaderStorage | BufferUsage::IndirectArgs);
+  Buffer visible_buf = createBuffer(
+      num_instances * sizeof(u32), BufferUsage::ShaderStorage);
+
+  // Occluder covering the whole screen at depth 0.5
+  RasterPassInterface depth_iface = gpu->createRasterPassInterface({
+    .uuid = "culling_depth_rp"_to_uuid,
+    .depthAttachment = {
+      .format = TextureFormat::Depth32_Float,
+      .loadMode = AttachmentLoadMode::Clear,
+      .clearValue = 0.5f,
+    },
+  });
+
+  Texture depth = gpu->createTexture({
+    .format = TextureFormat::Depth32_Float,
+    .width = depth_res,
+    .height = depth_res,
+    .usage = TextureUsage::DepthAttachment | TextureUsage::ShaderSampled,
+  });
+
+  RasterPass depth_pass = gpu->createRasterPass({
+    .interface = depth_iface,
+    .depthAttachment = depth,
+  });
+
+  GPUCulling::Culling culling = GPUCulling::createCulling(gpu, {
+    .instanceBounds = instances_buf,
+    .drawTemplates = draws_buf,
+    .drawArgs = args_buf,
+    .visibleInstances = visible_buf,
+    .depth = depth,
+    .depthWidth = depth_res,
+    .depthHeight = depth_res,
+  });
+
+  enc_.beginEncoding();
+  {
+    RasterPassEncoder raster_enc = enc_.beginRasterPass(depth_pass);
+    enc_.endRasterPass(raster_enc);
+  }
+
+  {
+    ComputePassEncoder compute_enc = enc_.beginComputePass();
+    GPUCulling::buildDepthPyramid(compute_enc, culling);
+    GPUCulling::cull(compute_enc, culling, identityCamera(),
+                     num_instances, 1);
+    enc_.endComputePass(compute_enc);
+  }
+  enc_.endEncoding();
+
+  gpu->submit(main_queue_, enc_);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  std::vector<DrawIndexedIndirectArgs> args =
+      readback<DrawIndexedIndirectArgs>(args_buf, 1);
+  std::vector<u32> visible = readback<u32>(visible_buf, num_instances);
+
+  ASSERT_EQ(args[0].numInstances, 2_u32);
+  EXPECT_EQ(visibleForDraw(visible, draws[0], args[0]), std::vector<u32>({ 0, 2 }));
+
+  GPUCulling::destroyCulling(gpu, culling);
+  gpu->destroyRasterPass(depth_pass);
+  gpu->destroyTexture(depth);
+  gpu->destroyRasterPassInterface(depth_iface);
+  gpu->destroyBuffer(visible_buf);
+  gpu->destroyBuffer(args_buf);
+  gpu->destroyBuffer(draws_buf);
+  gpu->destroyBuffer(instances_buf);
+}
+
+// Draws the culled instances without a non-zero indirect first instance,
+// so it passes whether or not the device supports one
+TEST_F(GPUCullingTest, DrawVisibleInstances)
+{
+  constexpr u16 res = 64;
+  constexpr u32 num_strips = 4;
+
+  // Instance i covers the i-th vertical strip. Instances 1 and 2 are culled.
+  InstanceBounds instances[] = {
+    sphere(0, 0, 0.5f, 0),
+    sphere(5, 0, 0.5f, 0),
+    sphere(0, 0, -2, 1),
+    sphere(0.5f, 0.5f, 0.5f, 1),
+  };
+  constexpr u32 num_instances = sizeof(instances) / sizeof(InstanceBounds);
+
+  DrawTemplate draws[] = {
+    { .numIndices = 6, .indexOffset = 0, .vertexOffset = 0,
+      .instanceOffset = 0 },
+    { .numIndices = 6, .indexOffset = 0, .vertexOffset = 0,
+      .instanceOffset = 2 },
+  };
+  constexpr u32 num_draws = sizeof(draws) / sizeof(DrawTemplate);
+
+  u32 indices[] = { 0, 1, 2, 3, 4, 5 };
+
+  Buffer instances_buf = createBuffer(
+      sizeof(instances), BufferUsage::ShaderStorage, instances);
+  Buffer draws_buf = createBuffer(
+      sizeof(draws), BufferUsage::ShaderStorage, draws);
+  Buffer args_buf = createBuffer(
+      num_draws * sizeof(DrawIndexedIndirectArgs),
+      BufferUsage::ShaderStorage | BufferUsage::IndirectArgs);
+  Buffer visible_buf = createBuffer(
+      num_instances * sizeof(u32), BufferUsage::ShaderStorage);
+  Buffer index_buf = createBuffer(
+      sizeof(indices), BufferUsage::DrawIndex, indices);
+
+  GPUCulling::Culling culling = GPUCulling::createCulling(gpu, {
+    .instanceBounds = instances_buf,
+    .drawTemplates = draws_buf,
+    .drawArgs = args_buf,
+    .visibleInstances = visible_buf,
+  });
+
+  ParamBlockType culled_type = gpu->createParamBlockType({
+    .uuid = "culling_test_visible"_to_uuid,
+    .buffers = {
+      { .type = BufferBindingType::Storage,
+        .shaderUsage = ShaderStage::Vertex },
+    },
+  });
+
+  ParamBlock culled_block = gpu->createParamBlock({
+    .typeID = culled_type,
+    .buffers = {
+      { .buffer = visible_buf },
+    },
+  });
+
+  RasterPassInterface rp_iface = gpu->createRasterPassInterface({
+    .uuid = "culling_test_draw_rp"_to_uuid,
+    .colorAttachments = {
+      { .format = TextureFormat::RGBA8_UNorm },
+    },
+  });
+
+  Texture color = gpu->createTexture({
+    .format = TextureFormat::RGBA8_UNorm,
+    .width = res,
+    .height = res,
+    .usage = TextureUsage::ColorAttachment | TextureUsage::CopySrc,
+  });
+
+  RasterPass pass = gpu->createRasterPass({
+    .interface = rp_iface,
+    .colorAttachments = { color },
+  });
+
+  RasterShader shader;
+  {
+    StackAlloc alloc;
+    ShaderCompileResult compile_result = shaderc->compileShader(alloc, {
+      .path = GAS_TEST_DIR "culled_instances.slang",
+    });
+
+    if (compile_result.diagnostics.size() != 0) {
+      fprintf(stderr, "%s", compile_result.diagnostics.data());
+    }
+
+    if (!compile_result.success) {
+      FATAL("Shader compilation failed!");
+    }
+
+    shader = gpu->createRasterShader({
+      .byteCode = compile_result.getByteCodeForBackend(
+          gpuAPI->backendShaderByteCodeType()),
+      .vertexEntry = "vertMain",
+      .fragmentEntry = "fragMain",
+      .rasterPass = { rp_iface },
+      .paramBlockTypes = { culled_type },
+      .numPerDrawBytes = 4 * sizeof(u32),
+    });
+  }
+
+  constexpr u32 num_texel_bytes = (u32)res * (u32)res * 4;
+  Buffer readback_buf = gpu->createReadbackBuffer(num_texel_bytes);
+
+  enc_.beginEncoding();
+  {
+    ComputePassEncoder compute_enc = enc_.beginComputePass();
+    GPUCulling::cull(compute_enc, culling, identityCamera(),
+                     num_instances, num_draws);
+    enc_.endComputePass(compute_enc);
+  }
+
+  {
+    RasterPassEncoder raster_enc = enc_.beginRasterPass(pass);
+    raster_enc.setShader(shader);
+    raster_enc.setParamBlock(0, culled_block);
+    raster_enc.setIndexBufferU32(index_buf);
+
+    for (u32 i = 0; i < num_draws; i++) {
+      u32 *draw_data = (u32 *)raster_enc.drawData(4 * (u32)sizeof(u32));
+      draw_data[0] = draws[i].instanceOffset;
+
+      raster_enc.drawIndexedIndirect(
+          args_buf, i * (u32)sizeof(DrawIndexedIndirectArgs));
+    }
+    enc_.endRasterPass(raster_enc);
+  }
+
+  {
+    CopyPassEncoder copy_enc = enc_.beginCopyPass();
+    copy_enc.copyTextureToBuffer(color, readback_buf);
+    enc_.endCopyPass(copy_enc);
+  }
+  enc_.endEncoding();
+
+  gpu->submit(main_queue_, enc_);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  {
+    const u8 *texels = (const u8 *)gpu->beginReadback(readback_buf);
+
+    for (u32 y = 0; y < res; y++) {
+      for (u32 x = 0; x < res; x++) {
+        u32 strip = x / (res / num_strips);
+        u8 expected = (strip == 0 || strip == 3) ? 255 : 0;
+
+        ASSERT_EQ(texels[4 * (y * res + x)], expected)
+            << "x: " << x << " y: " << y;
+      }
+    }
+
+    gpu->endReadback(readback_buf);
+  }
+
+  gpu->destroyReadbackBuffer(readback_buf);
+  gpu->destroyRasterShader(shader);
+  gpu->destroyRasterPass(pass);
+  gpu->destroyTexture(color);
+  gpu->destroyRasterPassInterface(rp_iface);
+  gpu->destroyParamBlock(culled_block);
+  gpu->destroyParamBlockType(culled_type);
+  GPUCulling::destroyCulling(gpu, culling);
+  gpu->destroyBuffer(index_buf);
+  gpu->destroyBuffer(visible_buf);
+  gpu->destroyBuffer(args_buf);
+  gpu->destroyBuffer(draws_buf);
+  gpu->destroyBuffer(instances_buf);
+}
+
+}
+}
@@ -0,0 +1,185 @@
+#include "test_gpu.hpp"
+#include "gas_render_target_pool.hpp"
+
+#include <cstring>
+
+namespace gas::test {
+namespace {
+
+class GPUQueues : public GPUTest {
+protected:
+  void SetUp() override
+  {
+    main_queue_ = gpu->getMainQueue();
+    upload_queue_ = gpu->getUploadQueue();
+
+    main_enc_ = gpu->createCommandEncoder(main_queue_);
+    upload_enc_ = gpu->createCommandEncoder(upload_queue_);
+  }
+
+  void TearDown() override
+  {
+    gpu->waitUntilIdle();
+
+    gpu->destroyCommandEncoder(upload_enc_);
+    gpu->destroyCommandEncoder(main_enc_);
+  }
+
+  GPUSubmitToken upload(Buffer dst, u32 dst_offset,
+                        const u32 *values, u32 num_values)
+  {
+    u32 num_bytes = num_values * sizeof(u32);
+
+    upload_enc_.beginEncoding();
+    CopyPassEncoder copy_enc = upload_enc_.beginCopyPass();
+    MappedTmpBuffer staging = copy_enc.tmpBuffer(num_bytes);
+    memcpy(staging.ptr, values, num_bytes);
+    copy_enc.copyBufferToBuffer(staging.buffer, dst,
+                                staging.offset, dst_offset, num_bytes);
+    upload_enc_.endCopyPass(copy_enc);
+    upload_enc_.endEncoding();
+
+    return gpu->submit(upload_queue_, upload_enc_);
+  }
+
+  void readback(Buffer src, Buffer readback_buf, u32 num_bytes,
+                Span<const GPUSubmitToken> wait_tokens)
+  {
+    main_enc_.beginEncoding();
+    CopyPassEncoder copy_enc = main_enc_.beginCopyPass();
+    copy_enc.copyBufferToBuffer(src, readback_buf, 0, 0, num_bytes);
+    main_enc_.endCopyPass(copy_enc);
+    main_enc_.endEncoding();
+
+    gpu->submit(main_queue_, main_enc_, wait_tokens);
+    gpu->waitUntilWorkFinished(main_queue_);
+  }
+
+  GPUQueue main_queue_;
+  GPUQueue upload_queue_;
+  CommandEncoder main_enc_;
+  CommandEncoder upload_enc_;
+};
+
+TEST_F(GPUQueues, MainWaitsOnUpload)
+{
+  constexpr u32 num_values = 256;
+  constexpr u32 num_bytes = num_values * sizeof(u32);
+
+  Buffer buffer = gpu->createBuffer({
+    .numBytes = num_bytes,
+    .usage = BufferUsage::CopySrc | BufferUsage::CopyDst,
+  });
+  Buffer readback_buf = gpu->createReadbackBuffer(num_bytes);
+
+  u32 values[num_values];
+  for (u32 i = 0; i < num_values; i++) {
+    values[i] = i * 3 + 1;
+  }
+
+  GPUSubmitToken token = upload(buffer, 0, values, num_values);
+  ASSERT_EQ(token.queue, upload_queue_.id);
+
+  readback(buffer, readback_buf, num_bytes, { token });
+
+  u32 *readback_ptr = (u32 *)gpu->beginReadback(readback_buf);
+  for (u32 i = 0; i < num_values; i++) {
+    EXPECT_EQ(readback_ptr[i], values[i]);
+  }
+  gpu->endReadback(readback_buf);
+
+  gpu->waitForSubmit(token);
+  EXPECT_TRUE(gpu->isSubmitFinished(token));
+
+  gpu->destroyReadbackBuffer(readback_buf);
+  gpu->destroyBuffer(buffer);
+}
+
+TEST_F(GPUQueues, ManyPendingUploads)
+{
+  constexpr u32 num_uploads = 20;
+  constexpr u32 values_per_upload = 64;
+  constexpr u32 num_values = num_uploads * values_per_upload;
+  constexpr u32 num_bytes = num_values * sizeof(u32);
+
+  Buffer buffer = gpu->createBuffer({
+    .numBytes = num_bytes,
+    .usage = BufferUsage::CopySrc | BufferUsage::CopyDst,
+  });
+  Buffer readback_buf = gpu->createReadbackBuffer(num_bytes);
+
+  // Every upload overwrites the whole tail of the buffer, so the final
+  // contents are only correct if the uploads execute in submission order
+  GPUSubmitToken last_token;
+  for (u32 i = 0; i < num_uploads; i++) {
+    u32 values[num_values];
+    u32 num_tail_values = num_values - i * values_per_upload;
+    for (u32 j = 0; j < num_tail_values; j++) {
+      values[j] = i;
+    }
+
+    GPUSubmitToken token =
+        upload(buffer, i * values_per_upload * sizeof(u32),
+               values, num_tail_values);
+
+    if (i > 0) {
+      EXPECT_EQ(token.id, last_token.id + 1);
+    }
+    last_token = token;
+  }
+
+  readback(buffer, readback_buf, num_bytes, { last_token });
+
+  u32 *readback_ptr = (u32 *)gpu->beginReadback(readback_buf);
+  for (u32 i = 0; i < num_values; i++) {
+    EXPECT_EQ(readback_ptr[i], i / values_per_upload);
+  }
+  gpu->endReadback(readback_buf);
+
+  gpu->waitForSubmit(last_token);
+  EXPECT_TRUE(gpu->isSubmitFinished(last_token));
+
+  gpu->destroyReadbackBuffer(readback_buf);
+  gpu->destroyBuffer(buffer);
+}
+
+TEST_F(GPUQueues, NullSubmitToken)
+{
+  GPUSubmitToken null_token {};
+
+  EXPECT_TRUE(gpu->isSubmitFinished(null_token));
+  gpu->waitForSubmit(null_token);
+
+  // Null tokens are also skipped when waited on by a submission
+  Buffer buffer = gpu->createBuffer({
+    .numBytes = 16,
+    .usage = BufferUsage::CopySrc | BufferUsage::CopyDst,
+  });
+  Buffer readback_buf = gpu->createReadbackBuffer(16);
+
+  readback(buffer, readback_buf, 16, { null_token });
+
+  // Frames without GPU work can end with a null token, their targets are
+  // reusable immediately
+  {
+    RenderTargetPool pool(gpu);
+
+    RenderTargetDesc desc {
+      .format = TextureFormat::RGBA8_UNorm,
+      .width = 16,
+      .height = 16,
+    };
+
+    Texture target = pool.acquire(desc);
+    pool.endFrame(null_token);
+
+    EXPECT_TRUE(pool.acquire(desc) == target);
+    pool.endFrame(null_token);
+  }
+
+  gpu->destroyReadbackBuffer(readback_buf);
+  gpu->destroyBuffer(buffer);
+}
+
+}
+}
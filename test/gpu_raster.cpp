@@ -0,0 +1,1326 @@
+#include "test_gpu.hpp"
+
+#include "gas_debug_draw.hpp"
+#include "gas_draw_queue.hpp"
+#include "gas_geometry_pool.hpp"
+#include "gas_render_target_pool.hpp"
+
+namespace gas::test {
+namespace {
+
+class GPURaster : public GPUTest {
+protected:
+  RasterShader createTestShader(const char *path, u32 num_per_draw_bytes,
+                                bool pack_draw_data = false,
+                                RasterHWConfig raster_config = {},
+                                RasterPassInterface rp_iface = {},
+                                Span<const VertexBufferConfig> vbufs = {})
+  {
+    auto backend_bytecode_type = gpuAPI->backendShaderByteCodeType();
+
+    StackAlloc shaderc_alloc;
+    ShaderByteCode shader_bytecode;
+    {
+      ShaderCompileResult compile_result =
+        shaderc->compileShader(shaderc_alloc, {
+          .path = path,
+        });
+
+      if (compile_result.diagnostics.size() != 0) {
+        fprintf(stderr, "%s", compile_result.diagnostics.data());
+      }
+
+      if (!compile_result.success) {
+        FATAL("Shader compilation failed!");
+      }
+
+      shader_bytecode =
+          compile_result.getByteCodeForBackend(backend_bytecode_type);
+    }
+
+    RasterShader shader = gpu->createRasterShader({
+      .byteCode = shader_bytecode,
+      .vertexEntry = "vertMain",
+      .fragmentEntry = "fragMain",
+      .rasterPass = { rp_iface.null() ? rp_iface_ : rp_iface },
+      .numPerDrawBytes = num_per_draw_bytes,
+      .packDrawData = pack_draw_data,
+      .vertexBuffers = vbufs,
+      .rasterConfig = raster_config,
+    });
+    shaderc_alloc.release();
+
+    return shader;
+  }
+
+  void SetUp() override
+  {
+    main_queue_ = gpu->getMainQueue();
+
+    rp_iface_ = gpu->createRasterPassInterface({
+      .uuid = "raster_test_rp"_to_uuid,
+      .colorAttachments = {
+        { .format = TextureFormat::RGBA8_UNorm },
+      },
+    });
+
+    shader_ = createTestShader(GAS_TEST_DIR "tmp_input.slang",
+                               sizeof(Vector3));
+
+    for (i32 i = 0; i < 2; i++) {
+      attachments_[i] = gpu->createTexture({
+        .format = TextureFormat::RGBA8_UNorm,
+        .width = RES,
+        .height = RES,
+        .usage = TextureUsage::ColorAttachment | TextureUsage::CopySrc,
+      });
+
+      passes_[i] = gpu->createRasterPass({
+        .interface = rp_iface_,
+        .colorAttachments = { attachments_[i] },
+      });
+    }
+
+    readback_ = gpu->createReadbackBuffer(2 * NUM_ATTACHMENT_BYTES);
+  }
+
+  void TearDown() override
+  {
+    gpu->waitUntilIdle();
+
+    gpu->destroyReadbackBuffer(readback_);
+
+    for (i32 i = 0; i < 2; i++) {
+      gpu->destroyRasterPass(passes_[i]);
+      gpu->destroyTexture(attachments_[i]);
+    }
+
+    gpu->destroyRasterShader(shader_);
+    gpu->destroyRasterPassInterface(rp_iface_);
+  }
+
+  void readbackAttachments(CommandEncoder &enc)
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+    copy_enc.copyTextureToBuffer(attachments_[0], readback_, 0, 0);
+    copy_enc.copyTextureToBuffer(attachments_[1], readback_, 0,
+                                 NUM_ATTACHMENT_BYTES);
+    enc.endCopyPass(copy_enc);
+  }
+
+  void checkAttachment(const u8 *texels, u8 r, u8 g, u8 b, u8 a)
+  {
+    for (u32 i = 0; i < (u32)RES * (u32)RES; i++) {
+      EXPECT_EQ(texels[4 * i], r);
+      EXPECT_EQ(texels[4 * i + 1], g);
+      EXPECT_EQ(texels[4 * i + 2], b);
+      EXPECT_EQ(texels[4 * i + 3], a);
+    }
+  }
+
+  static constexpr u16 RES = 64;
+  static constexpr u32 NUM_ATTACHMENT_BYTES = (u32)RES * (u32)RES * 4;
+
+  GPUQueue main_queue_;
+  RasterPassInterface rp_iface_;
+  RasterShader shader_;
+  Texture attachments_[2];
+  RasterPass passes_[2];
+  Buffer readback_;
+};
+
+TEST_F(GPURaster, DrawIndirect)
+{
+  // Non indexed args at offset 0, indexed args at offset 16, followed by
+  // an indexed draw with no instances
+  u32 args[] = {
+    3, 1, 0, 0,
+    3, 1, 0, 0, 0,
+    3, 0, 0, 0, 0,
+  };
+
+  Buffer args_buf = gpu->createBuffer({
+    .numBytes = sizeof(args),
+    .usage = BufferUsage::IndirectArgs,
+    .initData = { .ptr = args },
+  }, main_queue_);
+
+  u32 indices[] = { 0, 1, 2 };
+  Buffer index_buf = gpu->createBuffer({
+    .numBytes = sizeof(indices),
+    .usage = BufferUsage::DrawIndex,
+    .initData = { .ptr = indices },
+  }, main_queue_);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[0]);
+    raster_enc.setShader(shader_);
+    raster_enc.drawData(Vector3 { 1, 1, 0 });
+    raster_enc.drawIndirect(args_buf);
+    enc.endRasterPass(raster_enc);
+  }
+
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[1]);
+    raster_enc.setShader(shader_);
+    raster_enc.setIndexBufferU32(index_buf);
+    raster_enc.drawData(Vector3 { 0, 1, 1 });
+    raster_enc.drawIndexedIndirect(args_buf, 4 * sizeof(u32));
+    raster_enc.drawData(Vector3 { 1, 0, 0 });
+    raster_enc.drawIndexedIndirect(args_buf, 9 * sizeof(u32));
+    enc.endRasterPass(raster_enc);
+  }
+
+  readbackAttachments(enc);
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  const u8 *texels = (const u8 *)gpu->beginReadback(readback_);
+  checkAttachment(texels, 255, 255, 0, 255);
+  checkAttachment(texels + NUM_ATTACHMENT_BYTES, 0, 255, 255, 255);
+  gpu->endReadback(readback_);
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyBuffer(index_buf);
+  gpu->destroyBuffer(args_buf);
+}
+
+TEST_F(GPURaster, MultiDrawIndexedIndirect)
+{
+  // Only the second draw has instances, so the attachment is only written
+  // if the GPU count includes it
+  u32 args[] = {
+    3, 0, 0, 0, 0,
+    3, 1, 0, 0, 0,
+  };
+
+  u32 counts[] = { 1, 2 };
+
+  Buffer args_buf = gpu->createBuffer({
+    .numBytes = sizeof(args),
+    .usage = BufferUsage::IndirectArgs | BufferUsage::ShaderStorage,
+    .initData = { .ptr = args },
+  }, main_queue_);
+
+  Buffer count_buf = gpu->createBuffer({
+    .numBytes = sizeof(counts),
+    .usage = BufferUsage::IndirectArgs | BufferUsage::ShaderStorage,
+    .initData = { .ptr = counts },
+  }, main_queue_);
+
+  u32 indices[] = { 0, 1, 2 };
+  Buffer index_buf = gpu->createBuffer({
+    .numBytes = sizeof(indices),
+    .usage = BufferUsage::DrawIndex,
+    .initData = { .ptr = indices },
+  }, main_queue_);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  for (i32 i = 0; i < 2; i++) {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[i]);
+    raster_enc.setShader(shader_);
+    raster_enc.setIndexBufferU32(index_buf);
+    raster_enc.drawData(Vector3 { 1, 0, 1 });
+    raster_enc.multiDrawIndexedIndirect(args_buf, 0, 2,
+                                        count_buf, i * sizeof(u32));
+    enc.endRasterPass(raster_enc);
+  }
+
+  readbackAttachments(enc);
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  const u8 *texels = (const u8 *)gpu->beginReadback(readback_);
+  checkAttachment(texels, 0, 0, 0, 0);
+  checkAttachment(texels + NUM_ATTACHMENT_BYTES, 255, 0, 255, 255);
+  gpu->endReadback(readback_);
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyBuffer(index_buf);
+  gpu->destroyBuffer(count_buf);
+  gpu->destroyBuffer(args_buf);
+}
+
+TEST_F(GPURaster, RenderBundles)
+{
+  RasterShader instance_shader =
+      createTestShader(GAS_TEST_DIR "raster.slang", 0);
+
+  // The last instance covers the screen, giving blue
+  RenderBundleEncoder bundle_enc = gpu->beginRenderBundle({
+    .rasterPass = { rp_iface_ },
+  });
+  bundle_enc.setShader(instance_shader);
+  bundle_enc.drawInstanced(0, 1, 0, 5);
+  RenderBundle bundle = gpu->endRenderBundle(bundle_enc);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  // Replay the bundle over multiple submissions
+  for (i32 frame = 0; frame < 2; frame++) {
+    gpu->waitUntilReady(main_queue_);
+    enc.beginEncoding();
+
+    {
+      RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[0]);
+      raster_enc.executeBundles({ bundle });
+      enc.endRasterPass(raster_enc);
+    }
+
+    // Draw state has to be set again after the bundle
+    {
+      RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[1]);
+      raster_enc.setShader(shader_);
+      raster_enc.drawData(Vector3 { 1, 0, 0 });
+      raster_enc.draw(0, 1);
+      raster_enc.executeBundles({ bundle, bundle });
+      raster_enc.setShader(shader_);
+      raster_enc.drawData(Vector3 { 0, 1, 0 });
+      raster_enc.draw(0, 1);
+      enc.endRasterPass(raster_enc);
+    }
+
+    readbackAttachments(enc);
+    enc.endEncoding();
+
+    gpu->submit(main_queue_, enc);
+    gpu->waitUntilWorkFinished(main_queue_);
+
+    const u8 *texels = (const u8 *)gpu->beginReadback(readback_);
+    checkAttachment(texels, 0, 0, 255, 255);
+    checkAttachment(texels + NUM_ATTACHMENT_BYTES, 0, 255, 0, 255);
+    gpu->endReadback(readback_);
+  }
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyRenderBundle(bundle);
+  gpu->destroyRasterShader(instance_shader);
+}
+
+TEST_F(GPURaster, EncodeDraws)
+{
+  RasterShader instance_shader =
+      createTestShader(GAS_TEST_DIR "raster.slang", 0);
+
+  // Enough draws to span multiple chunks and command blocks. Only the last
+  // draw's data is yellow.
+  constexpr u32 num_draws = 200;
+  Vector3 colors[num_draws];
+  u32 num_triangles[num_draws];
+  for (u32 i = 0; i < num_draws; i++) {
+    colors[i] = i == num_draws - 1 ?
+        Vector3 { 1, 1, 0 } : Vector3 { 0, 0, (float)(i % 2) };
+    num_triangles[i] = 1;
+  }
+
+  // Instance 6 is cyan
+  RasterShader shaders[] = { shader_, instance_shader, instance_shader };
+  u32 instance_offsets[] = { 0, 1, 6 };
+  u32 num_instances[] = { 1, 3, 1 };
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[0]);
+    raster_enc.setShader(shader_);
+    raster_enc.encodeDraws({
+      .numDraws = num_draws,
+      .numTriangles = num_triangles,
+      .drawData = colors,
+      .numDrawDataBytes = sizeof(Vector3),
+    });
+    enc.endRasterPass(raster_enc);
+  }
+
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[1]);
+    raster_enc.drawData(Vector3 { 1, 0, 0 });
+    raster_enc.encodeDraws({
+      .numDraws = 3,
+      .shaders = shaders,
+      .numTriangles = num_triangles,
+      .instanceOffsets = instance_offsets,
+      .numInstances = num_instances,
+    });
+    enc.endRasterPass(raster_enc);
+  }
+
+  readbackAttachments(enc);
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  const u8 *texels = (const u8 *)gpu->beginReadback(readback_);
+  checkAttachment(texels, 255, 255, 0, 255);
+  checkAttachment(texels + NUM_ATTACHMENT_BYTES, 0, 255, 255, 255);
+  gpu->endReadback(readback_);
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyRasterShader(instance_shader);
+}
+
+TEST_F(GPURaster, PackedDrawData)
+{
+  RasterShader packed_shader = createTestShader(
+      GAS_TEST_DIR "packed_draw_data.slang", sizeof(Vector4), true);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[0]);
+    raster_enc.setShader(packed_shader);
+
+    u32 red = raster_enc.packedDrawData(Vector4 { 1, 0, 0, 1 });
+    raster_enc.drawInstanced(0, 1, red, 1);
+
+    // Second instance is drawn last
+    PackedDrawData instances =
+        raster_enc.packedDrawData(sizeof(Vector4), 2);
+    ((Vector4 *)instances.ptr)[0] = Vector4 { 0, 1, 0, 1 };
+    ((Vector4 *)instances.ptr)[1] = Vector4 { 0, 0, 1, 1 };
+    raster_enc.drawInstanced(0, 1, instances.instanceOffset, 2);
+
+    enc.endRasterPass(raster_enc);
+  }
+
+  // Switching between packed and uniform per draw data
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[1]);
+    raster_enc.setShader(packed_shader);
+    raster_enc.drawInstanced(
+        0, 1, raster_enc.packedDrawData(Vector4 { 1, 0, 1, 1 }), 1);
+
+    raster_enc.setShader(shader_);
+    raster_enc.drawData(Vector3 { 1, 1, 0 });
+    raster_enc.draw(0, 1);
+
+    raster_enc.setShader(packed_shader);
+    raster_enc.drawInstanced(
+        0, 1, raster_enc.packedDrawData(Vector4 { 0, 1, 1, 1 }), 1);
+    enc.endRasterPass(raster_enc);
+  }
+
+  readbackAttachments(enc);
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  const u8 *texels = (const u8 *)gpu->beginReadback(readback_);
+  checkAttachment(texels, 0, 0, 255, 255);
+  checkAttachment(texels + NUM_ATTACHMENT_BYTES, 0, 255, 255, 255);
+  gpu->endReadback(readback_);
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyRasterShader(packed_shader);
+}
+
+TEST_F(GPURaster, DynamicPassState)
+{
+  BlendingConfig constant_blend {
+    .colorOp = BlendOperation::Add,
+    .srcColorFactor = BlendFactor::Constant,
+    .dstColorFactor = BlendFactor::Zero,
+    .alphaOp = BlendOperation::Add,
+    .srcAlphaFactor = BlendFactor::One,
+    .dstAlphaFactor = BlendFactor::Zero,
+  };
+
+  RasterShader blend_shader = createTestShader(
+      GAS_TEST_DIR "tmp_input.slang", sizeof(Vector3), false, {
+        .blending = { constant_blend },
+      });
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  // Split screen: left half red, right half green
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[0]);
+    raster_enc.setShader(shader_);
+
+    raster_enc.setViewport(0, 0, RES / 2, RES);
+    raster_enc.drawData(Vector3 { 1, 0, 0 });
+    raster_enc.draw(0, 1);
+
+    raster_enc.setViewport(RES / 2, 0, RES / 2, RES);
+    raster_enc.drawData(Vector3 { 0, 1, 0 });
+    raster_enc.draw(0, 1);
+    enc.endRasterPass(raster_enc);
+  }
+
+  // White scaled by the blend constant. The stencil reference is encoded
+  // but has no effect without a stencil attachment.
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[1]);
+    raster_enc.setShader(blend_shader);
+    raster_enc.setBlendConstant(Vector4 { 1, 0, 0, 1 });
+    raster_enc.setBlendConstant(Vector4 { 1, 0, 1, 1 });
+    raster_enc.setStencilReference(1);
+    raster_enc.drawData(Vector3 { 1, 1, 1 });
+    raster_enc.draw(0, 1);
+    enc.endRasterPass(raster_enc);
+  }
+
+  readbackAttachments(enc);
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  const u8 *texels = (const u8 *)gpu->beginReadback(readback_);
+  for (u32 y = 0; y < RES; y++) {
+    for (u32 x = 0; x < RES; x++) {
+      const u8 *texel = texels + 4 * (y * RES + x);
+      bool left = x < RES / 2;
+      EXPECT_EQ(texel[0], left ? 255 : 0);
+      EXPECT_EQ(texel[1], left ? 0 : 255);
+      EXPECT_EQ(texel[2], 0);
+      EXPECT_EQ(texel[3], 255);
+    }
+  }
+  checkAttachment(texels + NUM_ATTACHMENT_BYTES, 255, 0, 255, 255);
+  gpu->endReadback(readback_);
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyRasterShader(blend_shader);
+}
+
+TEST_F(GPURaster, MSAAResolve)
+{
+  RasterPassInterface msaa_iface = gpu->createRasterPassInterface({
+    .uuid = "raster_test_msaa_rp"_to_uuid,
+    .colorAttachments = {
+      {
+        .format = TextureFormat::RGBA8_UNorm,
+        .storeMode = AttachmentStoreMode::Undefined,
+      },
+    },
+    .numSamples = 4,
+  });
+
+  RasterShader msaa_shader = createTestShader(
+      GAS_TEST_DIR "tmp_input.slang", sizeof(Vector3), false, {},
+      msaa_iface);
+
+  Texture msaa_attachment = gpu->createTexture({
+    .format = TextureFormat::RGBA8_UNorm,
+    .width = RES,
+    .height = RES,
+    .numSamples = 4,
+    .usage = TextureUsage::ColorAttachment,
+  });
+
+  RasterPass msaa_pass = gpu->createRasterPass({
+    .interface = msaa_iface,
+    .colorAttachments = { msaa_attachment },
+    .resolveAttachments = { attachments_[0] },
+  });
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  // Starting the viewport half a pixel in covers 2 of the 4 standard
+  // sample positions in the first column
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(msaa_pass);
+    raster_enc.setShader(msaa_shader);
+    raster_enc.setViewport(0.5f, 0, RES - 0.5f, RES);
+    raster_enc.drawData(Vector3 { 1, 1, 1 });
+    raster_enc.draw(0, 1);
+    enc.endRasterPass(raster_enc);
+  }
+
+  readbackAttachments(enc);
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  const u8 *texels = (const u8 *)gpu->beginReadback(readback_);
+  for (u32 y = 0; y < RES; y++) {
+    const u8 *row = texels + 4 * y * RES;
+    EXPECT_GT(row[0], 64);
+    EXPECT_LT(row[0], 192);
+
+    for (u32 x = 1; x < RES; x++) {
+      EXPECT_EQ(row[4 * x], 255);
+      EXPECT_EQ(row[4 * x + 1], 255);
+      EXPECT_EQ(row[4 * x + 2], 255);
+    }
+  }
+  gpu->endReadback(readback_);
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyRasterPass(msaa_pass);
+  gpu->destroyTexture(msaa_attachment);
+  gpu->destroyRasterShader(msaa_shader);
+  gpu->destroyRasterPassInterface(msaa_iface);
+}
+
+TEST_F(GPURaster, StencilMask)
+{
+  RasterPassInterface stencil_iface = gpu->createRasterPassInterface({
+    .uuid = "raster_test_stencil_rp"_to_uuid,
+    .depthAttachment = {
+      .format = TextureFormat::Depth24Plus_Stencil8,
+      .stencilClearValue = 0,
+    },
+    .colorAttachments = {
+      { .format = TextureFormat::RGBA8_UNorm },
+    },
+  });
+
+  StencilFaceConfig write_stencil {
+    .passOp = StencilOp::Replace,
+  };
+
+  StencilFaceConfig test_stencil {
+    .compare = StencilCompare::Equal,
+  };
+
+  RasterShader write_shader = createTestShader(
+      GAS_TEST_DIR "tmp_input.slang", sizeof(Vector3), false, {
+        .depthCompare = DepthCompare::Disabled,
+        .writeDepth = false,
+        .stencilFront = write_stencil,
+        .stencilBack = write_stencil,
+      }, stencil_iface);
+
+  RasterShader test_shader = createTestShader(
+      GAS_TEST_DIR "tmp_input.slang", sizeof(Vector3), false, {
+        .depthCompare = DepthCompare::Disabled,
+        .writeDepth = false,
+        .stencilFront = test_stencil,
+        .stencilBack = test_stencil,
+      }, stencil_iface);
+
+  Texture depth_stencil = gpu->createTexture({
+    .format = TextureFormat::Depth24Plus_Stencil8,
+    .width = RES,
+    .height = RES,
+    .usage = TextureUsage::DepthAttachment,
+  });
+
+  RasterPass stencil_pass = gpu->createRasterPass({
+    .interface = stencil_iface,
+    .depthAttachment = depth_stencil,
+    .colorAttachments = { attachments_[0] },
+  });
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  // Mark the top half of the stencil buffer, then only the marked half
+  // passes the equality test
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(stencil_pass);
+    raster_enc.setStencilReference(1);
+
+    raster_enc.setShader(write_shader);
+    raster_enc.setViewport(0, 0, RES, RES / 2);
+    raster_enc.drawData(Vector3 { 1, 0, 0 });
+    raster_enc.draw(0, 1);
+
+    raster_enc.setShader(test_shader);
+    raster_enc.setViewport(0, 0, RES, RES);
+    raster_enc.drawData(Vector3 { 0, 1, 0 });
+    raster_enc.draw(0, 1);
+    enc.endRasterPass(raster_enc);
+  }
+
+  readbackAttachments(enc);
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  const u8 *texels = (const u8 *)gpu->beginReadback(readback_);
+  for (u32 y = 0; y < RES; y++) {
+    for (u32 x = 0; x < RES; x++) {
+      const u8 *texel = texels + 4 * (y * RES + x);
+      bool marked = y < RES / 2;
+      EXPECT_EQ(texel[0], 0);
+      EXPECT_EQ(texel[1], marked ? 255 : 0);
+      EXPECT_EQ(texel[2], 0);
+      EXPECT_EQ(texel[3], marked ? 255 : 0);
+    }
+  }
+  gpu->endReadback(readback_);
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyRasterPass(stencil_pass);
+  gpu->destroyTexture(depth_stencil);
+  gpu->destroyRasterShader(test_shader);
+  gpu->destroyRasterShader(write_shader);
+  gpu->destroyRasterPassInterface(stencil_iface);
+}
+
+TEST_F(GPURaster, InstanceVertexBuffers)
+{
+  struct Instance {
+    u16 color[4];
+    u8 mask[4];
+  };
+
+  VertexAttributeConfig vertex_attrs[] = {
+    { .offset = 0, .format = VertexFormat::Vec2_F32 },
+  };
+
+  VertexAttributeConfig instance_attrs[] = {
+    { .offset = offsetof(Instance, color), .format = VertexFormat::Vec4_F16 },
+    { .offset = offsetof(Instance, mask), .format = VertexFormat::Vec4_U8 },
+  };
+
+  VertexBufferConfig vbufs[] = {
+    {
+      .stride = 2 * sizeof(float),
+      .attributes = { vertex_attrs, 1 },
+    },
+    {
+      .stride = sizeof(Instance),
+      .attributes = { instance_attrs, 2 },
+      .stepMode = VertexStepMode::Instance,
+    },
+  };
+
+  RasterShader instanced_shader = createTestShader(
+      GAS_TEST_DIR "instanced_vertex.slang", 0, false, {}, {},
+      { vbufs, 2 });
+
+  // Fullscreen triangle
+  float positions[] = {
+    -1, 1,
+    -1, -3,
+    3, 1,
+  };
+
+  // Half float 1 is 0x3C00. The last instance drawn is cyan after masking.
+  Instance instances[] = {
+    { { 0x3C00, 0, 0, 0x3C00 }, { 1, 1, 1, 1 } },
+    { { 0x3C00, 0x3C00, 0x3C00, 0x3C00 }, { 0, 1, 1, 1 } },
+    { { 0x3C00, 0, 0x3C00, 0x3C00 }, { 1, 1, 1, 1 } },
+  };
+
+  Buffer vertex_buf = gpu->createBuffer({
+    .numBytes = sizeof(positions),
+    .usage = BufferUsage::DrawVertex,
+    .initData = { .ptr = positions },
+  }, main_queue_);
+
+  Buffer instance_buf = gpu->createBuffer({
+    .numBytes = sizeof(instances),
+    .usage = BufferUsage::DrawVertex,
+    .initData = { .ptr = instances },
+  }, main_queue_);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  for (i32 i = 0; i < 2; i++) {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[i]);
+    raster_enc.setShader(instanced_shader);
+    raster_enc.setVertexBuffer(0, vertex_buf);
+    raster_enc.setVertexBuffer(1, instance_buf);
+    // Instance 2 is skipped in the first pass, and is the only instance
+    // drawn in the second
+    if (i == 0) {
+      raster_enc.drawInstanced(0, 1, 0, 2);
+    } else {
+      raster_enc.drawInstanced(0, 1, 2, 1);
+    }
+    enc.endRasterPass(raster_enc);
+  }
+
+  readbackAttachments(enc);
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  const u8 *texels = (const u8 *)gpu->beginReadback(readback_);
+  checkAttachment(texels, 0, 255, 255, 255);
+  checkAttachment(texels + NUM_ATTACHMENT_BYTES, 255, 0, 255, 255);
+  gpu->endReadback(readback_);
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyBuffer(instance_buf);
+  gpu->destroyBuffer(vertex_buf);
+  gpu->destroyRasterShader(instanced_shader);
+}
+
+TEST_F(GPURaster, DrawQueue)
+{
+  DrawQueue queue;
+
+  QueuedDraw draw {
+    .shader = shader_,
+    .numTriangles = 1,
+  };
+
+  // Overlapping fullscreen draws, so the last draw encoded after sorting
+  // determines the final color. Keys differ in high and low bits to cover
+  // multiple radix passes, and equal keys keep their submission order.
+  for (i32 i = 0; i < 2; i++) {
+    queue.add(5_u64 << 56, draw, Vector3 { 0, 1, 0 });
+    queue.add(7_u64 << 56 | 1, draw, Vector3 { 1, 0, 0 });
+    queue.add(7_u64 << 56, draw, Vector3 { 0, 0, 1 });
+    queue.add(3, draw, Vector3 { 1, 1, 1 });
+  }
+  queue.add(7_u64 << 56 | 1, draw, Vector3 { 1, 1, 0 });
+  EXPECT_EQ(queue.numDraws(), 9_u32);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[0]);
+    queue.encode(raster_enc);
+    enc.endRasterPass(raster_enc);
+  }
+  EXPECT_EQ(queue.numDraws(), 0_u32);
+
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[1]);
+    queue.add(1, draw, Vector3 { 0, 1, 1 });
+    queue.add(0, draw, Vector3 { 1, 0, 1 });
+    queue.encode(raster_enc);
+    enc.endRasterPass(raster_enc);
+  }
+
+  readbackAttachments(enc);
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  const u8 *texels = (const u8 *)gpu->beginReadback(readback_);
+  checkAttachment(texels, 255, 255, 0, 255);
+  checkAttachment(texels + NUM_ATTACHMENT_BYTES, 0, 255, 255, 255);
+  gpu->endReadback(readback_);
+
+  gpu->destroyCommandEncoder(enc);
+}
+
+
+TEST_F(GPURaster, GeometryPool)
+{
+  struct Vertex {
+    float pos[2];
+    float color[4];
+  };
+
+  VertexAttributeConfig vertex_attrs[] = {
+    { .offset = offsetof(Vertex, pos), .format = VertexFormat::Vec2_F32 },
+    { .offset = offsetof(Vertex, color), .format = VertexFormat::Vec4_F32 },
+  };
+
+  VertexBufferConfig vbuf = {
+    .stride = sizeof(Vertex),
+    .attributes = { vertex_attrs, 2 },
+  };
+
+  RasterShader mesh_shader = createTestShader(
+      GAS_TEST_DIR "pooled_mesh.slang", 0, false, {}, {}, { &vbuf, 1 });
+
+  GeometryPool pool(gpu, {
+    .vertexStride = sizeof(Vertex),
+    .maxNumVertices = 1024,
+    .maxNumIndices = 1024,
+  });
+
+  auto makeQuad = [](Vertex *verts, float x_min, float x_max,
+                     float r, float g, float b) {
+    float xs[] = { x_min, x_max, x_max, x_min };
+    float ys[] = { 1, 1, -1, -1 };
+    for (i32 i = 0; i < 4; i++) {
+      verts[i] = { { xs[i], ys[i] }, { r, g, b, 1 } };
+    }
+  };
+
+  u32 quad_indices[] = { 0, 1, 2, 0, 2, 3 };
+
+  Vertex left[4], right[4], full[4];
+  makeQuad(left, -1, 0, 1, 0, 0);
+  makeQuad(right, 0, 1, 0, 1, 0);
+  makeQuad(full, -1, 1, 0, 0, 1);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  MeshID left_mesh, right_mesh, full_mesh;
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+    left_mesh = pool.addMesh(copy_enc, {
+      .vertices = left, .numVertices = 4,
+      .indices = quad_indices, .numIndices = 6,
+    });
+    right_mesh = pool.addMesh(copy_enc, {
+      .vertices = right, .numVertices = 4,
+      .indices = quad_indices, .numIndices = 6,
+    });
+    enc.endCopyPass(copy_enc);
+  }
+  ASSERT_FALSE(left_mesh.null());
+  ASSERT_FALSE(right_mesh.null());
+  EXPECT_EQ(pool.mesh(right_mesh).numTriangles, 2_u32);
+  EXPECT_NE(pool.mesh(left_mesh).vertexOffset,
+            pool.mesh(right_mesh).vertexOffset);
+
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[0]);
+    raster_enc.setShader(mesh_shader);
+    pool.bind(raster_enc);
+    pool.draw(raster_enc, left_mesh);
+    pool.draw(raster_enc, right_mesh);
+    enc.endRasterPass(raster_enc);
+  }
+
+  // The removed mesh's ranges are reused by the next mesh added
+  GeometryMesh removed = pool.mesh(left_mesh);
+  pool.removeMesh(left_mesh);
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+    full_mesh = pool.addMesh(copy_enc, {
+      .vertices = full, .numVertices = 4,
+      .indices = quad_indices, .numIndices = 6,
+    });
+    enc.endCopyPass(copy_enc);
+  }
+  ASSERT_FALSE(full_mesh.null());
+  EXPECT_EQ(full_mesh.id, left_mesh.id);
+  EXPECT_EQ(pool.mesh(full_mesh).vertexOffset, removed.vertexOffset);
+  EXPECT_EQ(pool.mesh(full_mesh).indexOffset, removed.indexOffset);
+
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[1]);
+    raster_enc.setShader(mesh_shader);
+    pool.bind(raster_enc);
+    pool.draw(raster_enc, full_mesh);
+    enc.endRasterPass(raster_enc);
+  }
+
+  readbackAttachments(enc);
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  const u8 *texels = (const u8 *)gpu->beginReadback(readback_);
+  for (u32 y = 0; y < RES; y++) {
+    for (u32 x = 0; x < RES; x++) {
+      const u8 *texel = texels + 4 * (y * RES + x);
+      bool is_left = x < RES / 2;
+      EXPECT_EQ(texel[0], is_left ? 255 : 0);
+      EXPECT_EQ(texel[1], is_left ? 0 : 255);
+      EXPECT_EQ(texel[2], 0);
+      EXPECT_EQ(texel[3], 255);
+    }
+  }
+  checkAttachment(texels + NUM_ATTACHMENT_BYTES, 0, 0, 255, 255);
+  gpu->endReadback(readback_);
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyRasterShader(mesh_shader);
+}
+
+
+TEST_F(GPURaster, OcclusionQueries)
+{
+  VertexAttributeConfig vertex_attrs[] = {
+    { .offset = 0, .format = VertexFormat::Vec2_F32 },
+    { .offset = 2 * sizeof(float), .format = VertexFormat::Vec4_F32 },
+  };
+
+  VertexBufferConfig vbuf = {
+    .stride = 6 * sizeof(float),
+    .attributes = { vertex_attrs, 2 },
+  };
+
+  RasterShader mesh_shader = createTestShader(
+      GAS_TEST_DIR "pooled_mesh.slang", 0, false, {}, {}, { &vbuf, 1 });
+
+  // A fullscreen triangle followed by one that is entirely clipped
+  float vertices[] = {
+    -1, 1, 1, 0, 0, 1,
+    -1, -3, 1, 0, 0, 1,
+    3, 1, 1, 0, 0, 1,
+    2, 2, 0, 1, 0, 1,
+    2, 3, 0, 1, 0, 1,
+    3, 2, 0, 1, 0, 1,
+  };
+
+  Buffer vertex_buf = gpu->createBuffer({
+    .numBytes = sizeof(vertices),
+    .usage = BufferUsage::DrawVertex,
+    .initData = { .ptr = vertices },
+  }, main_queue_);
+
+  constexpr u32 num_queries = 3;
+  constexpr u32 num_result_bytes = num_queries * sizeof(u64);
+
+  QuerySet queries = gpu->createQuerySet({ .numQueries = num_queries });
+
+  RasterPass query_pass = gpu->createRasterPass({
+    .interface = rp_iface_,
+    .colorAttachments = { attachments_[0] },
+    .occlusionQuerySet = queries,
+  });
+
+  Buffer results = gpu->createBuffer({
+    .numBytes = num_result_bytes,
+    .usage = BufferUsage::QueryResolve | BufferUsage::CopySrc,
+  });
+  Buffer results_readback = gpu->createReadbackBuffer(num_result_bytes);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(query_pass);
+    raster_enc.setShader(mesh_shader);
+    raster_enc.setVertexBuffer(0, vertex_buf);
+
+    raster_enc.beginOcclusionQuery(0);
+    raster_enc.draw(0, 1);
+    raster_enc.endOcclusionQuery();
+
+    raster_enc.beginOcclusionQuery(1);
+    raster_enc.draw(3, 1);
+    raster_enc.endOcclusionQuery();
+
+    // Query 2 covers no draws
+    raster_enc.beginOcclusionQuery(2);
+    raster_enc.endOcclusionQuery();
+
+    enc.endRasterPass(raster_enc);
+  }
+
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+    copy_enc.resolveQuerySet(queries, 0, num_queries, results);
+    copy_enc.copyBufferToBuffer(results, results_readback, 0, 0,
+                                num_result_bytes);
+    enc.endCopyPass(copy_enc);
+  }
+
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  const u64 *query_results = (const u64 *)gpu->beginReadback(results_readback);
+  EXPECT_GT(query_results[0], 0_u64);
+  EXPECT_EQ(query_results[1], 0_u64);
+  EXPECT_EQ(query_results[2], 0_u64);
+  gpu->endReadback(results_readback);
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyReadbackBuffer(results_readback);
+  gpu->destroyBuffer(results);
+  gpu->destroyRasterPass(query_pass);
+  gpu->destroyQuerySet(queries);
+  gpu->destroyBuffer(vertex_buf);
+  gpu->destroyRasterShader(mesh_shader);
+}
+
+
+TEST_F(GPURaster, DebugDraw)
+{
+  DebugDraw::Renderer renderer = DebugDraw::createRenderer(gpu, shaderc, {
+    .rasterPass = rp_iface_,
+  });
+
+  DebugDraw::Camera camera {{
+    { 1, 0, 0, 0 },
+    { 0, 1, 0, 0 },
+    { 0, 0, 1, 0 },
+    { 0, 0, 0, 1 },
+  }};
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  auto pixelCenter = [](u32 i) {
+    return ((float)i + 0.5f) / (float)RES * 2.f - 1.f;
+  };
+
+  // One point per pixel, plus one more to spill into a second chunk
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[0]);
+    DebugDraw::Batch batch(renderer, raster_enc, camera);
+
+    for (u32 y = 0; y < RES; y++) {
+      for (u32 x = 0; x < RES; x++) {
+        batch.point({ pixelCenter(x), -pixelCenter(y), 0.5f },
+                    { 0, 1, 0, 1 });
+      }
+    }
+    batch.point({ 0, 0, 0.5f }, { 0, 1, 0, 1 });
+
+    batch.flush();
+    enc.endRasterPass(raster_enc);
+  }
+
+  // One line through the center of every row, extending past the edges
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(passes_[1]);
+    DebugDraw::Batch batch(renderer, raster_enc, camera);
+
+    for (u32 y = 0; y < RES; y++) {
+      batch.line({ -2, pixelCenter(y), 0.5f }, { 2, pixelCenter(y), 0.5f },
+                 { 1, 0, 0, 1 });
+    }
+    batch.box({ -0.5f, -0.5f, 0.25f }, { 0.5f, 0.5f, 0.75f }, { 1, 0, 0, 1 });
+    batch.sphere({ 0, 0, 0.5f }, 0.5f, { 1, 0, 0, 1 });
+
+    batch.flush();
+    enc.endRasterPass(raster_enc);
+  }
+
+  readbackAttachments(enc);
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  const u8 *texels = (const u8 *)gpu->beginReadback(readback_);
+  checkAttachment(texels, 0, 255, 0, 255);
+  checkAttachment(texels + NUM_ATTACHMENT_BYTES, 255, 0, 0, 255);
+  gpu->endReadback(readback_);
+
+  gpu->destroyCommandEncoder(enc);
+  DebugDraw::destroyRenderer(gpu, renderer);
+}
+
+
+TEST_F(GPURaster, TransientRasterPasses)
+{
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  // Transient and pre-created passes can be freely mixed and can target
+  // the same attachments
+  Vector3 colors[] = {
+    { 1, 0, 0 },
+    { 0, 0, 1 },
+    { 0, 1, 0 },
+  };
+
+  for (i32 i = 0; i < 3; i++) {
+    RasterPassEncoder raster_enc = i == 1 ?
+        enc.beginRasterPass(passes_[0]) :
+        enc.beginRasterPass(rp_iface_, { attachments_[i / 2] });
+    raster_enc.setShader(shader_);
+    raster_enc.drawData(colors[i]);
+    raster_enc.draw(0, 1);
+    enc.endRasterPass(raster_enc);
+  }
+
+  readbackAttachments(enc);
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  const u8 *texels = (const u8 *)gpu->beginReadback(readback_);
+  checkAttachment(texels, 0, 0, 255, 255);
+  checkAttachment(texels + NUM_ATTACHMENT_BYTES, 0, 255, 0, 255);
+  gpu->endReadback(readback_);
+
+  gpu->destroyCommandEncoder(enc);
+}
+
+
+TEST_F(GPURaster, TransientRasterPassResolveAndQueries)
+{
+  RasterPassInterface msaa_iface = gpu->createRasterPassInterface({
+    .uuid = "raster_test_transient_msaa_rp"_to_uuid,
+    .colorAttachments = {
+      {
+        .format = TextureFormat::RGBA8_UNorm,
+        .storeMode = AttachmentStoreMode::Undefined,
+      },
+    },
+    .numSamples = 4,
+  });
+
+  RasterShader msaa_shader = createTestShader(
+      GAS_TEST_DIR "tmp_input.slang", sizeof(Vector3), false, {},
+      msaa_iface);
+
+  Texture msaa_attachment = gpu->createTexture({
+    .format = TextureFormat::RGBA8_UNorm,
+    .width = RES,
+    .height = RES,
+    .numSamples = 4,
+    .usage = TextureUsage::ColorAttachment,
+  });
+
+  QuerySet queries = gpu->createQuerySet({ .numQueries = 1 });
+
+  Buffer results = gpu->createBuffer({
+    .numBytes = sizeof(u64),
+    .usage = BufferUsage::QueryResolve | BufferUsage::CopySrc,
+  });
+  Buffer results_readback = gpu->createReadbackBuffer(sizeof(u64));
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(
+        msaa_iface, { msaa_attachment }, {}, { attachments_[0] }, queries);
+    raster_enc.setShader(msaa_shader);
+    raster_enc.drawData(Vector3 { 1, 0, 1 });
+    raster_enc.beginOcclusionQuery(0);
+    raster_enc.draw(0, 1);
+    raster_enc.endOcclusionQuery();
+    enc.endRasterPass(raster_enc);
+  }
+
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+    copy_enc.resolveQuerySet(queries, 0, 1, results);
+    copy_enc.copyBufferToBuffer(results, results_readback, 0, 0,
+                                sizeof(u64));
+    enc.endCopyPass(copy_enc);
+  }
+
+  readbackAttachments(enc);
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  const u8 *texels = (const u8 *)gpu->beginReadback(readback_);
+  checkAttachment(texels, 255, 0, 255, 255);
+  gpu->endReadback(readback_);
+
+  const u64 *query_results = (const u64 *)gpu->beginReadback(results_readback);
+  EXPECT_GT(query_results[0], 0_u64);
+  gpu->endReadback(results_readback);
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyReadbackBuffer(results_readback);
+  gpu->destroyBuffer(results);
+  gpu->destroyQuerySet(queries);
+  gpu->destroyTexture(msaa_attachment);
+  gpu->destroyRasterShader(msaa_shader);
+  gpu->destroyRasterPassInterface(msaa_iface);
+}
+
+
+TEST_F(GPURaster, RenderTargetPool)
+{
+  RenderTargetPool pool(gpu);
+
+  RenderTargetDesc desc {
+    .format = TextureFormat::RGBA8_UNorm,
+    .width = RES,
+    .height = RES,
+    .usage = TextureUsage::ColorAttachment | TextureUsage::CopySrc,
+  };
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  auto fill = [&](Texture target, Vector3 color) {
+    RasterPassEncoder raster_enc = enc.beginRasterPass(rp_iface_, { target });
+    raster_enc.setShader(shader_);
+    raster_enc.drawData(color);
+    raster_enc.draw(0, 1);
+    enc.endRasterPass(raster_enc);
+  };
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  // Targets released earlier in the frame are aliased by later passes
+  Texture a = pool.acquire(desc);
+  fill(a, { 1, 0, 0 });
+  pool.release(a);
+
+  Texture b = pool.acquire(desc);
+  EXPECT_TRUE(a == b);
+  fill(b, { 0, 1, 0 });
+
+  Texture c = pool.acquire(desc);
+  EXPECT_FALSE(b == c);
+  fill(c, { 0, 0, 1 });
+
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+    copy_enc.copyTextureToBuffer(b, readback_, 0, 0);
+    copy_enc.copyTextureToBuffer(c, readback_, 0, NUM_ATTACHMENT_BYTES);
+    enc.endCopyPass(copy_enc);
+  }
+  enc.endEncoding();
+
+  GPUSubmitToken token = gpu->submit(main_queue_, enc);
+  pool.endFrame(token);
+  EXPECT_EQ(pool.numTargets(), 2_u32);
+
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  const u8 *texels = (const u8 *)gpu->beginReadback(readback_);
+  checkAttachment(texels, 0, 255, 0, 255);
+  checkAttachment(texels + NUM_ATTACHMENT_BYTES, 0, 0, 255, 255);
+  gpu->endReadback(readback_);
+
+  // Once the frame's submission finishes its targets are recycled
+  Texture d = pool.acquire(desc);
+  EXPECT_TRUE(d == b || d == c);
+  pool.release(d);
+  EXPECT_EQ(pool.numTargets(), 2_u32);
+
+  // Targets are freed after going unused for maxIdleFrames frames
+  for (i32 i = 0; i < 9; i++) {
+    pool.endFrame(token);
+  }
+  EXPECT_EQ(pool.numTargets(), 0_u32);
+
+  gpu->destroyCommandEncoder(enc);
+}
+
+}
+}
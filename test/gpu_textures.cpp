@@ -0,0 +1,410 @@
+#include "test_gpu.hpp"
+
+namespace gas::test {
+namespace {
+
+class GPUTextures : public GPUTest {
+protected:
+  void SetUp() override
+  {
+    main_queue_ = gpu->getMainQueue();
+  }
+
+  void TearDown() override
+  {
+    gpu->waitUntilIdle();
+  }
+
+  GPUQueue main_queue_;
+};
+
+constexpr u32 MIP_TEST_DIM = 64;
+constexpr u32 MIP_TEST_NUM_LEVELS = 7;
+
+// Left half of R is 255, G is constant, B & A are 0 & 255
+void writeMipTestBaseLevel(u8 *out)
+{
+  for (u32 y = 0; y < MIP_TEST_DIM; y++) {
+    for (u32 x = 0; x < MIP_TEST_DIM; x++) {
+      u8 *texel = out + 4 * (y * MIP_TEST_DIM + x);
+      texel[0] = x < MIP_TEST_DIM / 2 ? 255 : 0;
+      texel[1] = 200;
+      texel[2] = 0;
+      texel[3] = 255;
+    }
+  }
+}
+
+void checkLastMipLevel(const u8 *texel)
+{
+  EXPECT_GE(texel[0], 126);
+  EXPECT_LE(texel[0], 129);
+  EXPECT_EQ(texel[1], 200);
+  EXPECT_EQ(texel[2], 0);
+  EXPECT_EQ(texel[3], 255);
+}
+
+TEST_F(GPUTextures, StorageTexture)
+{
+  constexpr u32 width = 64;
+  constexpr u32 height = 8;
+  constexpr u32 num_bytes = width * height * sizeof(u32);
+
+  ParamBlockType param_block_type = gpu->createParamBlockType({
+    .uuid = "storage_texture_test_pb"_to_uuid,
+    .textures = {
+      {
+        .type = TextureBindingType::StorageTexture2D,
+        .shaderUsage = ShaderStage::Compute,
+        .storageFormat = TextureFormat::R32_UInt,
+        .storageAccess = StorageTextureAccess::ReadWrite,
+      },
+    },
+  });
+
+  ComputeShader shader;
+  {
+    StackAlloc shaderc_alloc;
+    ShaderCompileResult compile_result =
+      shaderc->compileShader(shaderc_alloc, {
+        .path = GAS_TEST_DIR "textures.slang",
+      });
+
+    if (compile_result.diagnostics.size() != 0) {
+      fprintf(stderr, "%s", compile_result.diagnostics.data());
+    }
+
+    if (!compile_result.success) {
+      FATAL("Shader compilation failed!");
+    }
+
+    shader = gpu->createComputeShader({
+      .byteCode = compile_result.getByteCodeForBackend(
+          gpuAPI->backendShaderByteCodeType()),
+      .entry = "writeStorageImage",
+      .paramBlockTypes = { param_block_type },
+    });
+    shaderc_alloc.release();
+  }
+
+  Texture image = gpu->createTexture({
+    .format = TextureFormat::R32_UInt,
+    .width = (u16)width,
+    .height = (u16)height,
+    .usage = TextureUsage::ShaderStorage | TextureUsage::CopySrc,
+  });
+
+  ParamBlock param_block = gpu->createParamBlock({
+    .typeID = param_block_type,
+    .textures = { image },
+  });
+
+  Buffer readback = gpu->createReadbackBuffer(num_bytes);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  {
+    ComputePassEncoder compute_enc = enc.beginComputePass();
+    compute_enc.setShader(shader);
+    compute_enc.setParamBlock(0, param_block);
+    compute_enc.dispatch(width / 8, height / 8);
+    enc.endComputePass(compute_enc);
+  }
+
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+    copy_enc.copyTextureToBuffer(image, readback);
+    enc.endCopyPass(copy_enc);
+  }
+
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  {
+    u32 *readback_ptr = (u32 *)gpu->beginReadback(readback);
+
+    for (u32 i = 0; i < width * height; i++) {
+      EXPECT_EQ(readback_ptr[i], i);
+    }
+
+    gpu->endReadback(readback);
+  }
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyReadbackBuffer(readback);
+  gpu->destroyParamBlock(param_block);
+  gpu->destroyTexture(image);
+  gpu->destroyComputeShader(shader);
+  gpu->destroyParamBlockType(param_block_type);
+}
+
+TEST_F(GPUTextures, GenerateMipsOnUpload)
+{
+  constexpr u32 num_base_bytes = MIP_TEST_DIM * MIP_TEST_DIM * 4;
+  u8 base_level[num_base_bytes];
+  writeMipTestBaseLevel(base_level);
+
+  Texture tex = gpu->createTexture({
+    .format = TextureFormat::RGBA8_UNorm,
+    .width = (u16)MIP_TEST_DIM,
+    .height = (u16)MIP_TEST_DIM,
+    .numMipLevels = (u16)MIP_TEST_NUM_LEVELS,
+    .usage = TextureUsage::ShaderSampled | TextureUsage::CopySrc,
+    .initData = { .ptr = base_level },
+  }, main_queue_);
+
+  Buffer readback = gpu->createReadbackBuffer(256);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+    copy_enc.copyTextureToBuffer(tex, readback, MIP_TEST_NUM_LEVELS - 1);
+    enc.endCopyPass(copy_enc);
+  }
+
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  checkLastMipLevel((const u8 *)gpu->beginReadback(readback));
+  gpu->endReadback(readback);
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyReadbackBuffer(readback);
+  gpu->destroyTexture(tex);
+}
+
+TEST_F(GPUTextures, GenerateMipsCommand)
+{
+  constexpr u32 num_base_bytes = MIP_TEST_DIM * MIP_TEST_DIM * 4;
+
+  Texture tex = gpu->createTexture({
+    .format = TextureFormat::RGBA8_UNorm,
+    .width = (u16)MIP_TEST_DIM,
+    .height = (u16)MIP_TEST_DIM,
+    .numMipLevels = (u16)MIP_TEST_NUM_LEVELS,
+    .usage = TextureUsage::ShaderSampled |
+        TextureUsage::CopySrc | TextureUsage::CopyDst,
+  });
+
+  Buffer readback = gpu->createReadbackBuffer(256);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+
+    MappedTmpBuffer init = copy_enc.tmpBuffer(num_base_bytes, 256);
+    writeMipTestBaseLevel(init.ptr);
+
+    copy_enc.copyBufferToTexture(init.buffer, tex, init.offset);
+    copy_enc.generateMips(tex);
+    copy_enc.copyTextureToBuffer(tex, readback, MIP_TEST_NUM_LEVELS - 1);
+    enc.endCopyPass(copy_enc);
+  }
+
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  checkLastMipLevel((const u8 *)gpu->beginReadback(readback));
+  gpu->endReadback(readback);
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyReadbackBuffer(readback);
+  gpu->destroyTexture(tex);
+}
+
+TEST_F(GPUTextures, GenerateMipsHalfFloat)
+{
+  constexpr u32 num_base_texels = MIP_TEST_DIM * MIP_TEST_DIM;
+
+  // Left half of R is 1, G is 0.5, B & A are 0 & 1
+  u16 base_level[num_base_texels * 4];
+  for (u32 y = 0; y < MIP_TEST_DIM; y++) {
+    for (u32 x = 0; x < MIP_TEST_DIM; x++) {
+      u16 *texel = base_level + 4 * (y * MIP_TEST_DIM + x);
+      texel[0] = x < MIP_TEST_DIM / 2 ? 0x3C00 : 0;
+      texel[1] = 0x3800;
+      texel[2] = 0;
+      texel[3] = 0x3C00;
+    }
+  }
+
+  Texture tex = gpu->createTexture({
+    .format = TextureFormat::RGBA16_Float,
+    .width = (u16)MIP_TEST_DIM,
+    .height = (u16)MIP_TEST_DIM,
+    .numMipLevels = (u16)MIP_TEST_NUM_LEVELS,
+    .usage = TextureUsage::ShaderSampled | TextureUsage::CopySrc,
+    .initData = { .ptr = base_level },
+  }, main_queue_);
+
+  Buffer readback = gpu->createReadbackBuffer(256);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+    copy_enc.copyTextureToBuffer(tex, readback, MIP_TEST_NUM_LEVELS - 1);
+    enc.endCopyPass(copy_enc);
+  }
+
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  {
+    const u16 *texel = (const u16 *)gpu->beginReadback(readback);
+    EXPECT_GE(texel[0], 0x37F8);
+    EXPECT_LE(texel[0], 0x3808);
+    EXPECT_EQ(texel[1], 0x3800);
+    EXPECT_EQ(texel[2], 0);
+    EXPECT_EQ(texel[3], 0x3C00);
+    gpu->endReadback(readback);
+  }
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyReadbackBuffer(readback);
+  gpu->destroyTexture(tex);
+}
+
+TEST_F(GPUTextures, ConvertToLuminance)
+{
+  constexpr u32 num_texels = MIP_TEST_DIM * MIP_TEST_DIM;
+  u8 base_level[num_texels * 4];
+  writeMipTestBaseLevel(base_level);
+
+  Texture tex = gpu->createTexture({
+    .format = TextureFormat::RGBA8_UNorm,
+    .width = (u16)MIP_TEST_DIM,
+    .height = (u16)MIP_TEST_DIM,
+    .usage = TextureUsage::ShaderSampled | TextureUsage::CopyDst,
+    .initData = { .ptr = base_level },
+  }, main_queue_);
+
+  ASSERT_EQ(textureConversionBytesPerTexel(
+      TextureConversion::Luminance_UNorm8), 1_u32);
+  Buffer readback = gpu->createReadbackBuffer(num_texels);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+    copy_enc.copyTextureToBufferConverted(tex, readback,
+        TextureConversion::Luminance_UNorm8);
+    enc.endCopyPass(copy_enc);
+  }
+
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  // 0.2126 * 255 + 0.7152 * 200 and 0.7152 * 200
+  const u8 *luminance = (const u8 *)gpu->beginReadback(readback);
+  for (u32 y = 0; y < MIP_TEST_DIM; y++) {
+    for (u32 x = 0; x < MIP_TEST_DIM; x++) {
+      u8 v = luminance[y * MIP_TEST_DIM + x];
+      u8 expected = x < MIP_TEST_DIM / 2 ? 197 : 143;
+      EXPECT_GE(v, expected - 1);
+      EXPECT_LE(v, expected + 1);
+    }
+  }
+  gpu->endReadback(readback);
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyReadbackBuffer(readback);
+  gpu->destroyTexture(tex);
+}
+
+TEST_F(GPUTextures, ConvertToHalf)
+{
+  constexpr u32 width = 16;
+  constexpr u32 height = 4;
+  constexpr u32 num_texels = width * height;
+
+  float texels[num_texels * 4];
+  for (u32 i = 0; i < num_texels; i++) {
+    texels[4 * i] = 0.5f;
+    texels[4 * i + 1] = 1.f;
+    texels[4 * i + 2] = -2.f;
+    texels[4 * i + 3] = 3.25f;
+  }
+
+  Texture tex = gpu->createTexture({
+    .format = TextureFormat::RGBA32_Float,
+    .width = (u16)width,
+    .height = (u16)height,
+    .usage = TextureUsage::ShaderSampled | TextureUsage::CopyDst,
+    .initData = { .ptr = texels },
+  }, main_queue_);
+
+  u32 rgba_num_bytes = num_texels * textureConversionBytesPerTexel(
+      TextureConversion::RGBA16_Float);
+  u32 r_num_bytes = num_texels * textureConversionBytesPerTexel(
+      TextureConversion::R16_Float);
+
+  Buffer readback = gpu->createReadbackBuffer(rgba_num_bytes + r_num_bytes);
+
+  CommandEncoder enc = gpu->createCommandEncoder(main_queue_);
+
+  gpu->waitUntilReady(main_queue_);
+  enc.beginEncoding();
+
+  {
+    CopyPassEncoder copy_enc = enc.beginCopyPass();
+    copy_enc.copyTextureToBufferConverted(tex, readback,
+        TextureConversion::RGBA16_Float);
+    copy_enc.copyTextureToBufferConverted(tex, readback,
+        TextureConversion::R16_Float, 0, rgba_num_bytes);
+    enc.endCopyPass(copy_enc);
+  }
+
+  enc.endEncoding();
+
+  gpu->submit(main_queue_, enc);
+  gpu->waitUntilWorkFinished(main_queue_);
+
+  const u16 *halves = (const u16 *)gpu->beginReadback(readback);
+  for (u32 i = 0; i < num_texels; i++) {
+    EXPECT_EQ(halves[4 * i], 0x3800);
+    EXPECT_EQ(halves[4 * i + 1], 0x3C00);
+    EXPECT_EQ(halves[4 * i + 2], 0xC000);
+    EXPECT_EQ(halves[4 * i + 3], 0x4280);
+  }
+
+  halves += num_texels * 4;
+  for (u32 i = 0; i < num_texels; i++) {
+    EXPECT_EQ(halves[i], 0x3800);
+  }
+  gpu->endReadback(readback);
+
+  gpu->destroyCommandEncoder(enc);
+  gpu->destroyReadbackBuffer(readback);
+  gpu->destroyTexture(tex);
+}
+
+}
+}
@@ -37,6 +37,14 @@ inline wgpu::TextureFormat convertTextureFormat(TextureFormat in)
     case BGRA8_UNorm: return O::BGRA8Unorm;
     case BGRA8_SRGB: return O::BGRA8UnormSrgb;
     case Depth32_Float: return O::Depth32Float;
+    case R32_UInt: return O::R32Uint;
+    case R32_Float: return O::R32Float;
+    case RGBA16_Float: return O::RGBA16Float;
+    case RGBA32_Float: return O::RGBA32Float;
+    case Depth16_UNorm: return O::Depth16Unorm;
+    case Depth24Plus: return O::Depth24Plus;
+    case Depth24Plus_Stencil8: return O::Depth24PlusStencil8;
+    case Depth32_Float_Stencil8: return O::Depth32FloatStencil8;
     default: MADRONA_UNREACHABLE();
   }
 }
@@ -55,6 +63,24 @@ inline TextureFormat convertWebGPUTextureFormat(wgpu::TextureFormat in)
   }
 };
 
+// Formats with a mip generation pipeline: the downsample pass samples
+// with linear filtering and renders to the next level
+inline bool supportsMipGeneration(TextureFormat format)
+{
+  using enum TextureFormat;
+
+  switch (format) {
+    case RGBA8_UNorm:
+    case RGBA8_SRGB:
+    case BGRA8_UNorm:
+    case BGRA8_SRGB:
+    case RGBA16_Float:
+      return true;
+    default:
+      return false;
+  }
+}
+
 inline wgpu::TextureUsage convertTextureUsage(TextureUsage in)
 {
   using O = wgpu::TextureUsage;
@@ -75,7 +101,7 @@ inline wgpu::TextureUsage convertTextureUsage(TextureUsage in)
     out |= (u64)O::TextureBinding;
   }
 
-  if ((in & ShaderStorage) == ShaderSampled) {
+  if ((in & ShaderStorage) == ShaderStorage) {
     out |= (u64)O::StorageBinding;
   }
 
@@ -161,9 +187,31 @@ inline wgpu::BufferUsage convertBufferUsage(BufferUsage in)
     out |= (u64)O::Storage;
   }
 
+  if ((in & IndirectArgs) == IndirectArgs) {
+    out |= (u64)O::Indirect;
+  }
+
+  if ((in & QueryResolve) == QueryResolve) {
+    out |= (u64)O::QueryResolve;
+  }
+
   return (O)out;
 }
 
+inline wgpu::StorageTextureAccess convertStorageTextureAccess(
+    StorageTextureAccess in)
+{
+  using O = wgpu::StorageTextureAccess;
+  using enum StorageTextureAccess;
+
+  switch (in) {
+    case WriteOnly: return O::WriteOnly;
+    case ReadOnly: return O::ReadOnly;
+    case ReadWrite: return O::ReadWrite;
+    default: MADRONA_UNREACHABLE();
+  }
+}
+
 inline wgpu::CompareFunction convertDepthCompare(DepthCompare in)
 {
   using O = wgpu::CompareFunction;
@@ -177,6 +225,58 @@ inline wgpu::CompareFunction convertDepthCompare(DepthCompare in)
   }
 }
 
+inline bool formatHasStencil(wgpu::TextureFormat fmt)
+{
+  return fmt == wgpu::TextureFormat::Depth24PlusStencil8 ||
+      fmt == wgpu::TextureFormat::Depth32FloatStencil8;
+}
+
+inline wgpu::CompareFunction convertStencilCompare(StencilCompare in)
+{
+  using O = wgpu::CompareFunction;
+  using enum StencilCompare;
+
+  switch (in) {
+    case Always: return O::Always;
+    case Never: return O::Never;
+    case Equal: return O::Equal;
+    case NotEqual: return O::NotEqual;
+    case Less: return O::Less;
+    case LessOrEqual: return O::LessEqual;
+    case Greater: return O::Greater;
+    case GreaterOrEqual: return O::GreaterEqual;
+    default: MADRONA_UNREACHABLE();
+  }
+}
+
+inline wgpu::StencilOperation convertStencilOp(StencilOp in)
+{
+  using O = wgpu::StencilOperation;
+  using enum StencilOp;
+
+  switch (in) {
+    case Keep: return O::Keep;
+    case Zero: return O::Zero;
+    case Replace: return O::Replace;
+    case Invert: return O::Invert;
+    case IncrementClamp: return O::IncrementClamp;
+    case DecrementClamp: return O::DecrementClamp;
+    case IncrementWrap: return O::IncrementWrap;
+    case DecrementWrap: return O::DecrementWrap;
+    default: MADRONA_UNREACHABLE();
+  }
+}
+
+inline wgpu::StencilFaceState convertStencilFace(const StencilFaceConfig &in)
+{
+  return wgpu::StencilFaceState {
+    .compare = convertStencilCompare(in.compare),
+    .failOp = convertStencilOp(in.failOp),
+    .depthFailOp = convertStencilOp(in.depthFailOp),
+    .passOp = convertStencilOp(in.passOp),
+  };
+}
+
 inline wgpu::CullMode convertCullMode(CullMode in)
 {
   using O = wgpu::CullMode;
@@ -190,6 +290,31 @@ inline wgpu::CullMode convertCullMode(CullMode in)
   }
 }
 
+inline wgpu::PrimitiveTopology convertPrimitiveTopology(PrimitiveTopology in)
+{
+  using O = wgpu::PrimitiveTopology;
+  using enum PrimitiveTopology;
+
+  switch (in) {
+    case TriangleList: return O::TriangleList;
+    case LineList: return O::LineList;
+    case PointList: return O::PointList;
+    default: MADRONA_UNREACHABLE();
+  }
+}
+
+inline u32 primitiveTopologyNumVertices(PrimitiveTopology in)
+{
+  using enum PrimitiveTopology;
+
+  switch (in) {
+    case TriangleList: return 3;
+    case LineList: return 2;
+    case PointList: return 1;
+    default: MADRONA_UNREACHABLE();
+  }
+}
+
 inline wgpu::LoadOp convertAttachmentLoadMode(AttachmentLoadMode in)
 {
   using O = wgpu::LoadOp;
@@ -261,6 +386,23 @@ inline wgpu::VertexFormat convertVertexFormat(VertexFormat in)
     case Vec2_F32: return O::Float32x2;
     case Vec3_F32: return O::Float32x3;
     case Vec4_UNorm8: return O::Unorm8x4;
+    case Vec4_F32: return O::Float32x4;
+    case Vec2_F16: return O::Float16x2;
+    case Vec4_F16: return O::Float16x4;
+    case Vec4_SNorm8: return O::Snorm8x4;
+    case Vec2_UNorm16: return O::Unorm16x2;
+    case Vec4_UNorm16: return O::Unorm16x4;
+    case Vec2_SNorm16: return O::Snorm16x2;
+    case Vec4_SNorm16: return O::Snorm16x4;
+    case Vec2_U8: return O::Uint8x2;
+    case Vec4_U8: return O::Uint8x4;
+    case Vec2_U16: return O::Uint16x2;
+    case Vec4_U16: return O::Uint16x4;
+    case Scalar_U32: return O::Uint32;
+    case Vec2_U32: return O::Uint32x2;
+    case Vec3_U32: return O::Uint32x3;
+    case Vec4_U32: return O::Uint32x4;
+    case Vec4_UNorm10_10_10_2: return O::Unorm10_10_10_2;
     default: MADRONA_UNREACHABLE();
   }
 }
@@ -294,6 +436,8 @@ inline wgpu::BlendFactor convertBlendFactor(BlendFactor in)
     case OneMinusDst: return O::OneMinusDst;
     case DstAlpha: return O::DstAlpha;
     case OneMinusDstAlpha: return O::OneMinusDstAlpha;
+    case Constant: return O::Constant;
+    case OneMinusConstant: return O::OneMinusConstant;
     default: MADRONA_UNREACHABLE();
   }
 }
@@ -343,6 +487,219 @@ void uncapturedErrorCB(const wgpu::Device &wgpu_dev,
   debuggerBreakPoint();
 }
 
+// Fullscreen triangle that bilinearly samples the previous mip level.
+// Each destination texel lands exactly between 4 source texels, so this
+// is a 2x2 box filter for even sized levels.
+constexpr const char *MIP_GEN_SHADER_SRC = R"(
+@group(0) @binding(0) var src_tex: texture_2d<f32>;
+@group(0) @binding(1) var src_sampler: sampler;
+
+struct VertexOut {
+  @builtin(position) pos: vec4f,
+  @location(0) uv: vec2f,
+};
+
+@vertex
+fn vertMain(@builtin(vertex_index) idx: u32) -> VertexOut {
+  let uv = vec2f(f32((idx << 1u) & 2u), f32(idx & 2u));
+
+  var out: VertexOut;
+  out.pos = vec4f(uv * vec2f(2.0, -2.0) + vec2f(-1.0, 1.0), 0.0, 1.0);
+  out.uv = uv;
+  return out;
+}
+
+@fragment
+fn fragMain(in: VertexOut) -> @location(0) vec4f {
+  return textureSample(src_tex, src_sampler, in.uv);
+}
+)";
+
+constexpr inline u32 MAX_WORKGROUPS_PER_DIM = 65535;
+
+// One workgroup per region. See CopyPassEncoder::scatterUpdate for the
+// packed layout.
+constexpr const char *SCATTER_UPDATE_SHADER_SRC = R"(
+@group(0) @binding(0) var<storage, read> packed: array<u32>;
+@group(0) @binding(1) var<storage, read_write> dst: array<u32>;
+
+@compute @workgroup_size(64)
+fn scatterUpdate(@builtin(workgroup_id) wg_id: vec3u,
+                 @builtin(num_workgroups) num_wgs: vec3u,
+                 @builtin(local_invocation_index) lane: u32) {
+  let region_idx = wg_id.y * num_wgs.x + wg_id.x;
+  if (region_idx >= packed[0]) {
+    return;
+  }
+
+  let entry = 4u + 4u * region_idx;
+  let dst_offset = packed[entry];
+  let src_offset = packed[entry + 1u];
+  let num_words = packed[entry + 2u];
+
+  for (var i = lane; i < num_words; i += 64u) {
+    dst[dst_offset + i] = packed[src_offset + i];
+  }
+}
+)";
+
+// Each invocation writes one u32 of tightly packed output. Entry points
+// must be declared in TextureConversion order.
+constexpr const char *TEXTURE_CONVERSION_SHADER_SRC = R"(
+@group(0) @binding(0) var color_tex: texture_2d<f32>;
+@group(0) @binding(1) var<storage, read_write> out_words: array<u32>;
+@group(0) @binding(2) var depth_tex: texture_depth_2d;
+
+fn outWordIdx(wg_id: vec3u, num_wgs: vec3u, lane: u32) -> u32 {
+  return (wg_id.y * num_wgs.x + wg_id.x) * 64u + lane;
+}
+
+fn texelCoord(idx: u32, dims: vec2u) -> vec2u {
+  return vec2u(idx % dims.x, idx / dims.x);
+}
+
+fn loadColor(idx: u32, dims: vec2u) -> vec4f {
+  if (idx >= dims.x * dims.y) {
+    return vec4f(0.0);
+  }
+  return textureLoad(color_tex, texelCoord(idx, dims), 0);
+}
+
+fn loadDepth(idx: u32, dims: vec2u) -> f32 {
+  if (idx >= dims.x * dims.y) {
+    return 0.0;
+  }
+  return textureLoad(depth_tex, texelCoord(idx, dims), 0);
+}
+
+fn luminance(idx: u32, dims: vec2u) -> f32 {
+  return dot(loadColor(idx, dims).rgb, vec3f(0.2126, 0.7152, 0.0722));
+}
+
+@compute @workgroup_size(64)
+fn toLuminanceUNorm8(@builtin(workgroup_id) wg_id: vec3u,
+                     @builtin(num_workgroups) num_wgs: vec3u,
+                     @builtin(local_invocation_index) lane: u32) {
+  let word_idx = outWordIdx(wg_id, num_wgs, lane);
+  let dims = textureDimensions(color_tex);
+  let base = word_idx * 4u;
+  if (base >= dims.x * dims.y) {
+    return;
+  }
+
+  out_words[word_idx] = pack4x8unorm(vec4f(
+    luminance(base, dims),
+    luminance(base + 1u, dims),
+    luminance(base + 2u, dims),
+    luminance(base + 3u, dims)));
+}
+
+@compute @workgroup_size(64)
+fn toDepthUNorm16(@builtin(workgroup_id) wg_id: vec3u,
+                  @builtin(num_workgroups) num_wgs: vec3u,
+                  @builtin(local_invocation_index) lane: u32) {
+  let word_idx = outWordIdx(wg_id, num_wgs, lane);
+  let dims = textureDimensions(depth_tex);
+  let base = word_idx * 2u;
+  if (base >= dims.x * dims.y) {
+    return;
+  }
+
+  out_words[word_idx] = pack2x16unorm(vec2f(
+    loadDepth(base, dims), loadDepth(base + 1u, dims)));
+}
+
+@compute @workgroup_size(64)
+fn toR16Float(@builtin(workgroup_id) wg_id: vec3u,
+              @builtin(num_workgroups) num_wgs: vec3u,
+              @builtin(local_invocation_index) lane: u32) {
+  let word_idx = outWordIdx(wg_id, num_wgs, lane);
+  let dims = textureDimensions(color_tex);
+  let base = word_idx * 2u;
+  if (base >= dims.x * dims.y) {
+    return;
+  }
+
+  out_words[word_idx] = pack2x16float(vec2f(
+    loadColor(base, dims).r, loadColor(base + 1u, dims).r));
+}
+
+@compute @workgroup_size(64)
+fn toRGBA16Float(@builtin(workgroup_id) wg_id: vec3u,
+                 @builtin(num_workgroups) num_wgs: vec3u,
+                 @builtin(local_invocation_index) lane: u32) {
+  let word_idx = outWordIdx(wg_id, num_wgs, lane);
+  let dims = textureDimensions(color_tex);
+  let texel_idx = word_idx / 2u;
+  if (texel_idx >= dims.x * dims.y) {
+    return;
+  }
+
+  let color = loadColor(texel_idx, dims);
+  if (word_idx % 2u == 0u) {
+    out_words[word_idx] = pack2x16float(color.rg);
+  } else {
+    out_words[word_idx] = pack2x16float(color.ba);
+  }
+}
+)";
+
+constexpr const char *TEXTURE_CONVERSION_ENTRIES[] = {
+  "toLuminanceUNorm8",
+  "toDepthUNorm16",
+  "toR16Float",
+  "toRGBA16Float",
+};
+
+static_assert(sizeof(TEXTURE_CONVERSION_ENTRIES) / sizeof(const char *) ==
+              NUM_TEXTURE_CONVERSIONS);
+
+// Emulation args are written by RasterPassEncoder::multiDrawIndexedIndirect.
+// Draws past the count still execute, but with no instances.
+constexpr const char *MULTI_DRAW_EMULATION_SHADER_SRC = R"(
+struct EmulationArgs {
+  args_offset: u32,
+  count_offset: u32,
+  max_draws: u32,
+  pad: u32,
+};
+
+@group(0) @binding(0) var<uniform> emulation_args: EmulationArgs;
+@group(1) @binding(0) var<storage, read> src_args: array<u32>;
+@group(1) @binding(1) var<storage, read> counts: array<u32>;
+@group(1) @binding(2) var<storage, read_write> dst_args: array<u32>;
+
+@compute @workgroup_size(64)
+fn clampDrawArgs(@builtin(workgroup_id) wg_id: vec3u,
+                 @builtin(num_workgroups) num_wgs: vec3u,
+                 @builtin(local_invocation_index) lane: u32) {
+  let draw_idx = (wg_id.y * num_wgs.x + wg_id.x) * 64u + lane;
+  if (draw_idx >= emulation_args.max_draws) {
+    return;
+  }
+
+  let src = emulation_args.args_offset + 5u * draw_idx;
+  let dst = 5u * draw_idx;
+  for (var i = 0u; i < 5u; i++) {
+    dst_args[dst + i] = src_args[src + i];
+  }
+
+  if (draw_idx >= counts[emulation_args.count_offset]) {
+    dst_args[dst + 1u] = 0u;
+  }
+}
+)";
+
+constexpr inline u32 DRAW_INDEXED_INDIRECT_ARGS_NUM_BYTES = 5 * sizeof(u32);
+
+// Each multi draw gets its own storage binding in the scratch buffer, so
+// regions must respect minStorageBufferOffsetAlignment
+u32 multiDrawEmulationNumBytes(u32 max_draws)
+{
+  return utils::roundUp(max_draws * DRAW_INDEXED_INDIRECT_ARGS_NUM_BYTES,
+                        256_u32);
+}
+
 }
 
 GPUAPI * WebGPUAPI::init(const APIConfig &cfg)
@@ -506,12 +863,37 @@ static InitDeviceResult initDevice(
   }
 
   wgpu::Device device;
+  bool supports_multi_draw_indirect;
   {
     wgpu::RequiredLimits required_limits {};
     required_limits.limits.maxUniformBufferBindingSize =
         supported_limits.limits.maxUniformBufferBindingSize;
 
+    // Indirect draws with a non-zero first instance are skipped without
+    // this feature. Built-in GPU generated draws never rely on it.
+    std::array<wgpu::FeatureName, 3> required_features;
+    i32 num_required_features = 0;
+    if (adapter.HasFeature(wgpu::FeatureName::IndirectFirstInstance)) {
+      required_features[num_required_features++] =
+          wgpu::FeatureName::IndirectFirstInstance;
+    }
+
+    // Otherwise multiDrawIndexedIndirect is emulated
+    supports_multi_draw_indirect =
+        adapter.HasFeature(wgpu::FeatureName::MultiDrawIndirect);
+    if (supports_multi_draw_indirect) {
+      required_features[num_required_features++] =
+          wgpu::FeatureName::MultiDrawIndirect;
+    }
+
+    if (adapter.HasFeature(wgpu::FeatureName::Depth32FloatStencil8)) {
+      required_features[num_required_features++] =
+          wgpu::FeatureName::Depth32FloatStencil8;
+    }
+
     wgpu::DeviceDescriptor dev_desc;
+    dev_desc.requiredFeatureCount = (size_t)num_required_features;
+    dev_desc.requiredFeatures = required_features.data();
     dev_desc.requiredLimits = &required_limits;
 
     dev_desc.SetDeviceLostCallback(wgpu::CallbackMode::AllowSpontaneous,
@@ -542,6 +924,7 @@ static InitDeviceResult initDevice(
   BackendLimits out_limits {
     .maxNumUniformBytes =
         (u32)supported_limits.limits.maxUniformBufferBindingSize,
+    .supportsMultiDrawIndirect = supports_multi_draw_indirect,
   };
 
   return { std::move(adapter), std::move(device), out_limits };
@@ -623,116 +1006,445 @@ Backend::Backend(wgpu::Adapter &&adapter_in,
     tmpDynamicUniformLayout = dev.CreateBindGroupLayout(&layout_desc);
   }
 
-  for (BackendQueueData &queue_data : queueDatas) {
-    GPUTmpInputState &gpu_tmp_input = queue_data.gpuTmpInput;
-    gpu_tmp_input.curTmpStagingRange = 0;
-    gpu_tmp_input.curTmpInputRange = 0;
-    gpu_tmp_input.maxNumUsedTmpGPUBuffers = 0;
+  {
+    wgpu::BindGroupLayoutEntry layout_entry {
+      .binding = 0,
+      .visibility = wgpu::ShaderStage((u64)wgpu::ShaderStage::Vertex |
+                                      (u64)wgpu::ShaderStage::Fragment),
+      .buffer = wgpu::BufferBindingLayout {
+        .type = wgpu::BufferBindingType::ReadOnlyStorage,
+        .hasDynamicOffset = false,
+        .minBindingSize = 0,
+      },
+    };
 
-    gpu_tmp_input.tmpBufferHandlesBase =
-        buffers.reserveRows(MAX_TMP_BUFFERS_PER_QUEUE);
+    wgpu::BindGroupLayoutDescriptor layout_desc {
+      .entryCount = 1,
+      .entries = &layout_entry,
+    };
 
-    TmpParamBlockState &tmp_param_block_state = queue_data.tmpParamBlockState;
-    tmp_param_block_state.numLive = 0;
-    tmp_param_block_state.baseHandleOffset =
-        paramBlocks.reserveRows(MAX_TMP_PARAM_BLOCKS_PER_QUEUE);
+    tmpStorageLayout = dev.CreateBindGroupLayout(&layout_desc);
   }
 
-  // Pre allocate a tmp data block for the main queue
   {
-    GPUTmpInputState &gpu_tmp_input = queueDatas[0].gpuTmpInput;
-    allocGPUTmpBuffer(gpu_tmp_input, 0);
-  }
+    wgpu::BindGroupLayoutEntry layout_entries[2] {
+      {
+        .binding = 0,
+        .visibility = wgpu::ShaderStage::Fragment,
+        .texture = wgpu::TextureBindingLayout {
+          .sampleType = wgpu::TextureSampleType::Float,
+          .viewDimension = wgpu::TextureViewDimension::e2D,
+        },
+      },
+      {
+        .binding = 1,
+        .visibility = wgpu::ShaderStage::Fragment,
+        .sampler = wgpu::SamplerBindingLayout {
+          .type = wgpu::SamplerBindingType::Filtering,
+        },
+      },
+    };
 
-}
+    wgpu::BindGroupLayoutDescriptor layout_desc {
+      .entryCount = 2,
+      .entries = layout_entries,
+    };
 
-void Backend::destroy()
-{
-  for (BackendQueueData &queue_data : queueDatas) {
-    GPUTmpInputState &gpu_tmp_input = queue_data.gpuTmpInput;
+    mipGenerator.layout = dev.CreateBindGroupLayout(&layout_desc);
 
-    for (i32 i = 0; i < (i32)gpu_tmp_input.maxNumUsedTmpGPUBuffers; i++) {
-      auto [to_buffer, _, id] = buffers.get(
-          gpu_tmp_input.tmpBufferHandlesBase, i);
-      to_buffer->Destroy();
-      to_buffer->~Buffer();
-    }
+    wgpu::SamplerDescriptor sampler_desc;
+    sampler_desc.magFilter = wgpu::FilterMode::Linear;
+    sampler_desc.minFilter = wgpu::FilterMode::Linear;
 
-    buffers.releaseRows(
-      gpu_tmp_input.tmpBufferHandlesBase, MAX_TMP_BUFFERS_PER_QUEUE);
+    mipGenerator.sampler = dev.CreateSampler(&sampler_desc);
 
-    TmpParamBlockState &tmp_param_block_state = queue_data.tmpParamBlockState;
-    assert(tmp_param_block_state.numLive == 0);
-    paramBlocks.releaseRows(tmp_param_block_state.baseHandleOffset,
-                            MAX_TMP_PARAM_BLOCKS_PER_QUEUE);
-  }
+    wgpu::ShaderModuleWGSLDescriptor wgsl_desc {{
+      .nextInChain = nullptr,
+      .code = MIP_GEN_SHADER_SRC,
+    }};
+    wgpu::ShaderModuleDescriptor shader_mod_desc {
+      .nextInChain = &wgsl_desc,
+    };
 
-  assert(stagingBelt.numFree == stagingBelt.numAllocated);
-  for (i32 i = 0; i < stagingBelt.numAllocated; i++) {
-    stagingBelt.buffers[i].Unmap();
-    stagingBelt.buffers[i].Destroy();
+    wgpu::ShaderModule shader_mod = dev.CreateShaderModule(&shader_mod_desc);
 
-    auto [to_buffer, _, id] = buffers.get(
-        stagingBelt.stagingBufferHandlesBase, i);
+    wgpu::PipelineLayoutDescriptor pipeline_layout_desc {
+      .bindGroupLayoutCount = 1,
+      .bindGroupLayouts = &mipGenerator.layout,
+    };
 
-    to_buffer->~Buffer();
-  }
+    wgpu::PipelineLayout pipeline_layout =
+      dev.CreatePipelineLayout(&pipeline_layout_desc);
 
-  buffers.releaseRows(stagingBelt.stagingBufferHandlesBase,
-      MAX_TMP_STAGING_BUFFERS);
-}
+    for (i32 i = 0; i < NUM_MIP_GEN_FORMATS; i++) {
+      if (!supportsMipGeneration((TextureFormat)i)) {
+        continue;
+      }
 
-void Backend::createGPUResources(i32 num_buffers,
-                                 const BufferInit *buffer_inits,
-                                 Buffer *buffer_handles_out,
-                                 i32 num_textures,
-                                 const TextureInit *texture_inits,
-                                 Texture *texture_handles_out,
-                                 GPUQueue tx_queue)
-{
-  u32 buffer_tbl_offset;
-  if (num_buffers > 0) {
-    buffer_tbl_offset = buffers.reserveRows(num_buffers);
-    if (buffer_tbl_offset == AllocOOM) [[unlikely]] {
-      reportError(ErrorStatus::TableFull);
-      return;
-    }
-  }
+      wgpu::ColorTargetState color_tgt_state {
+        .format = convertTextureFormat((TextureFormat)i),
+      };
 
-  u32 texture_tbl_offset;
-  if (num_textures > 0) {
-    texture_tbl_offset = textures.reserveRows(num_textures);
-    if (texture_tbl_offset == AllocOOM) [[unlikely]] {
-      if (num_buffers > 0) {
-        buffers.releaseRows(buffer_tbl_offset, num_buffers);
-      }
-      reportError(ErrorStatus::TableFull);
-      return;
-    }
-  }
+      wgpu::FragmentState frag_state {
+        .module = shader_mod,
+        .entryPoint = "fragMain",
+        .targetCount = 1,
+        .targets = &color_tgt_state,
+      };
 
-  wgpu::CommandEncoder upload_enc;
-  GPUTmpMemBlock staging_block {};
-  if (tx_queue.id != -1) {
-    upload_enc = dev.CreateCommandEncoder();
-    waitUntilReady(tx_queue);
-  }
+      wgpu::RenderPipelineDescriptor pipeline_desc {
+        .layout = pipeline_layout,
+        .vertex = {
+          .module = shader_mod,
+          .entryPoint = "vertMain",
+        },
+        .fragment = &frag_state,
+      };
 
-  auto stagingAlloc = [this, tx_queue, &staging_block]
-    (u32 num_bytes) -> StagingHandle 
-  {
-    if (num_bytes > GPUTmpMemBlock::BLOCK_SIZE) {
-      return {
-        .buffer = {},
-        .offset = 0,
-        .ptr = nullptr,
-      }; 
+      mipGenerator.pipelines[i] = dev.CreateRenderPipeline(&pipeline_desc);
     }
-    
-    // FIXME move to validation
-    assert(tx_queue.id != -1);
+  }
 
-    u32 offset = staging_block.alloc(num_bytes, 4);
+  {
+    wgpu::BindGroupLayoutEntry layout_entries[] {
+      {
+        .binding = 0,
+        .visibility = wgpu::ShaderStage::Compute,
+        .buffer = wgpu::BufferBindingLayout {
+          .type = wgpu::BufferBindingType::ReadOnlyStorage,
+        },
+      },
+      {
+        .binding = 1,
+        .visibility = wgpu::ShaderStage::Compute,
+        .buffer = wgpu::BufferBindingLayout {
+          .type = wgpu::BufferBindingType::Storage,
+        },
+      },
+    };
+
+    wgpu::BindGroupLayoutDescriptor layout_desc {
+      .entryCount = 2,
+      .entries = layout_entries,
+    };
+
+    scatterUpdater.layout = dev.CreateBindGroupLayout(&layout_desc);
+
+    wgpu::ShaderModuleWGSLDescriptor wgsl_desc {{
+      .nextInChain = nullptr,
+      .code = SCATTER_UPDATE_SHADER_SRC,
+    }};
+    wgpu::ShaderModuleDescriptor shader_mod_desc {
+      .nextInChain = &wgsl_desc,
+    };
+
+    wgpu::ShaderModule shader_mod = dev.CreateShaderModule(&shader_mod_desc);
+
+    wgpu::PipelineLayoutDescriptor pipeline_layout_desc {
+      .bindGroupLayoutCount = 1,
+      .bindGroupLayouts = &scatterUpdater.layout,
+    };
+
+    wgpu::ComputePipelineDescriptor pipeline_desc {
+      .layout = dev.CreatePipelineLayout(&pipeline_layout_desc),
+      .compute = {
+        .module = shader_mod,
+        .entryPoint = "scatterUpdate",
+        .constantCount = 0,
+        .constants = nullptr,
+      },
+    };
+
+    scatterUpdater.pipeline = dev.CreateComputePipeline(&pipeline_desc);
+
+    wgpu::BufferDescriptor scratch_desc {
+      .usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst,
+      .size = GPUTmpMemBlock::BLOCK_SIZE,
+    };
+
+    scatterUpdater.scratch = dev.CreateBuffer(&scratch_desc);
+  }
+
+  {
+    wgpu::BindGroupLayoutEntry out_entry {
+      .binding = 1,
+      .visibility = wgpu::ShaderStage::Compute,
+      .buffer = wgpu::BufferBindingLayout {
+        .type = wgpu::BufferBindingType::Storage,
+      },
+    };
+
+    wgpu::BindGroupLayoutEntry color_layout_entries[] {
+      {
+        .binding = 0,
+        .visibility = wgpu::ShaderStage::Compute,
+        .texture = wgpu::TextureBindingLayout {
+          .sampleType = wgpu::TextureSampleType::UnfilterableFloat,
+          .viewDimension = wgpu::TextureViewDimension::e2D,
+        },
+      },
+      out_entry,
+    };
+
+    wgpu::BindGroupLayoutEntry depth_layout_entries[] {
+      out_entry,
+      {
+        .binding = 2,
+        .visibility = wgpu::ShaderStage::Compute,
+        .texture = wgpu::TextureBindingLayout {
+          .sampleType = wgpu::TextureSampleType::Depth,
+          .viewDimension = wgpu::TextureViewDimension::e2D,
+        },
+      },
+    };
+
+    wgpu::BindGroupLayoutDescriptor color_layout_desc {
+      .entryCount = 2,
+      .entries = color_layout_entries,
+    };
+
+    wgpu::BindGroupLayoutDescriptor depth_layout_desc {
+      .entryCount = 2,
+      .entries = depth_layout_entries,
+    };
+
+    textureConverter.colorLayout =
+        dev.CreateBindGroupLayout(&color_layout_desc);
+    textureConverter.depthLayout =
+        dev.CreateBindGroupLayout(&depth_layout_desc);
+
+    wgpu::ShaderModuleWGSLDescriptor wgsl_desc {{
+      .nextInChain = nullptr,
+      .code = TEXTURE_CONVERSION_SHADER_SRC,
+    }};
+    wgpu::ShaderModuleDescriptor shader_mod_desc {
+      .nextInChain = &wgsl_desc,
+    };
+
+    wgpu::ShaderModule shader_mod = dev.CreateShaderModule(&shader_mod_desc);
+
+    wgpu::PipelineLayoutDescriptor color_pipeline_layout_desc {
+      .bindGroupLayoutCount = 1,
+      .bindGroupLayouts = &textureConverter.colorLayout,
+    };
+
+    wgpu::PipelineLayoutDescriptor depth_pipeline_layout_desc {
+      .bindGroupLayoutCount = 1,
+      .bindGroupLayouts = &textureConverter.depthLayout,
+    };
+
+    wgpu::PipelineLayout color_pipeline_layout =
+        dev.CreatePipelineLayout(&color_pipeline_layout_desc);
+    wgpu::PipelineLayout depth_pipeline_layout =
+        dev.CreatePipelineLayout(&depth_pipeline_layout_desc);
+
+    for (i32 i = 0; i < NUM_TEXTURE_CONVERSIONS; i++) {
+      bool is_depth = (TextureConversion)i == TextureConversion::Depth_UNorm16;
+
+      wgpu::ComputePipelineDescriptor pipeline_desc {
+        .layout = is_depth ? depth_pipeline_layout : color_pipeline_layout,
+        .compute = {
+          .module = shader_mod,
+          .entryPoint = TEXTURE_CONVERSION_ENTRIES[i],
+          .constantCount = 0,
+          .constants = nullptr,
+        },
+      };
+
+      textureConverter.pipelines[i] =
+          dev.CreateComputePipeline(&pipeline_desc);
+    }
+
+    textureConverter.scratchNumBytes = 0;
+  }
+
+  if (!limits.supportsMultiDrawIndirect) {
+    wgpu::BindGroupLayoutEntry layout_entries[3] {
+      {
+        .binding = 0,
+        .visibility = wgpu::ShaderStage::Compute,
+        .buffer = wgpu::BufferBindingLayout {
+          .type = wgpu::BufferBindingType::ReadOnlyStorage,
+        },
+      },
+      {
+        .binding = 1,
+        .visibility = wgpu::ShaderStage::Compute,
+        .buffer = wgpu::BufferBindingLayout {
+          .type = wgpu::BufferBindingType::ReadOnlyStorage,
+        },
+      },
+      {
+        .binding = 2,
+        .visibility = wgpu::ShaderStage::Compute,
+        .buffer = wgpu::BufferBindingLayout {
+          .type = wgpu::BufferBindingType::Storage,
+        },
+      },
+    };
+
+    wgpu::BindGroupLayoutDescriptor layout_desc {
+      .entryCount = 3,
+      .entries = layout_entries,
+    };
+
+    multiDrawEmulator.layout = dev.CreateBindGroupLayout(&layout_desc);
+
+    wgpu::ShaderModuleWGSLDescriptor wgsl_desc {{
+      .nextInChain = nullptr,
+      .code = MULTI_DRAW_EMULATION_SHADER_SRC,
+    }};
+    wgpu::ShaderModuleDescriptor shader_mod_desc {
+      .nextInChain = &wgsl_desc,
+    };
+
+    wgpu::ShaderModule shader_mod = dev.CreateShaderModule(&shader_mod_desc);
+
+    wgpu::BindGroupLayout bind_group_layouts[2] {
+      tmpDynamicUniformLayout,
+      multiDrawEmulator.layout,
+    };
+
+    wgpu::PipelineLayoutDescriptor pipeline_layout_desc {
+      .bindGroupLayoutCount = 2,
+      .bindGroupLayouts = bind_group_layouts,
+    };
+
+    wgpu::ComputePipelineDescriptor pipeline_desc {
+      .layout = dev.CreatePipelineLayout(&pipeline_layout_desc),
+      .compute = {
+        .module = shader_mod,
+        .entryPoint = "clampDrawArgs",
+        .constantCount = 0,
+        .constants = nullptr,
+      },
+    };
+
+    multiDrawEmulator.pipeline = dev.CreateComputePipeline(&pipeline_desc);
+    multiDrawEmulator.scratchNumBytes = 0;
+  }
+
+  for (BackendQueueData &queue_data : queueDatas) {
+    queue_data.numSubmits = 0;
+    queue_data.numFlushedSubmits = 0;
+    queue_data.numFinishedSubmits = 0;
+    for (PendingSubmit &pending : queue_data.pendingSubmits) {
+      pending.numStagingBuffers = 0;
+    }
+
+    GPUTmpInputState &gpu_tmp_input = queue_data.gpuTmpInput;
+    gpu_tmp_input.curTmpStagingRange = 0;
+    gpu_tmp_input.curTmpInputRange = 0;
+    gpu_tmp_input.maxNumUsedTmpGPUBuffers = 0;
+
+    gpu_tmp_input.tmpBufferHandlesBase =
+        buffers.reserveRows(MAX_TMP_BUFFERS_PER_QUEUE);
+
+    TmpParamBlockState &tmp_param_block_state = queue_data.tmpParamBlockState;
+    tmp_param_block_state.numLive = 0;
+    tmp_param_block_state.baseHandleOffset =
+        paramBlocks.reserveRows(MAX_TMP_PARAM_BLOCKS_PER_QUEUE);
+  }
+
+  // Pre allocate a tmp data block for the main queue
+  {
+    GPUTmpInputState &gpu_tmp_input = queueDatas[0].gpuTmpInput;
+    allocGPUTmpBuffer(gpu_tmp_input, 0);
+  }
+
+}
+
+void Backend::destroy()
+{
+  // Drains pending submissions and their work done callbacks, which
+  // reference queueDatas
+  waitUntilIdle();
+
+  for (BackendQueueData &queue_data : queueDatas) {
+    GPUTmpInputState &gpu_tmp_input = queue_data.gpuTmpInput;
+
+    for (i32 i = 0; i < (i32)gpu_tmp_input.maxNumUsedTmpGPUBuffers; i++) {
+      auto [to_buffer, _, id] = buffers.get(
+          gpu_tmp_input.tmpBufferHandlesBase, i);
+      to_buffer->Destroy();
+      to_buffer->~Buffer();
+    }
+
+    buffers.releaseRows(
+      gpu_tmp_input.tmpBufferHandlesBase, MAX_TMP_BUFFERS_PER_QUEUE);
+
+    TmpParamBlockState &tmp_param_block_state = queue_data.tmpParamBlockState;
+    assert(tmp_param_block_state.numLive == 0);
+    paramBlocks.releaseRows(tmp_param_block_state.baseHandleOffset,
+                            MAX_TMP_PARAM_BLOCKS_PER_QUEUE);
+  }
+
+  assert(stagingBelt.numFree == stagingBelt.numAllocated);
+  for (i32 i = 0; i < stagingBelt.numAllocated; i++) {
+    stagingBelt.buffers[i].Unmap();
+    stagingBelt.buffers[i].Destroy();
+
+    auto [to_buffer, _, id] = buffers.get(
+        stagingBelt.stagingBufferHandlesBase, i);
+
+    to_buffer->~Buffer();
+  }
+
+  buffers.releaseRows(stagingBelt.stagingBufferHandlesBase,
+      MAX_TMP_STAGING_BUFFERS);
+}
+
+void Backend::createGPUResources(i32 num_buffers,
+                                 const BufferInit *buffer_inits,
+                                 Buffer *buffer_handles_out,
+                                 i32 num_textures,
+                                 const TextureInit *texture_inits,
+                                 Texture *texture_handles_out,
+                                 GPUQueue tx_queue)
+{
+  u32 buffer_tbl_offset;
+  if (num_buffers > 0) {
+    buffer_tbl_offset = buffers.reserveRows(num_buffers);
+    if (buffer_tbl_offset == AllocOOM) [[unlikely]] {
+      reportError(ErrorStatus::TableFull);
+      return;
+    }
+  }
+
+  u32 texture_tbl_offset;
+  if (num_textures > 0) {
+    texture_tbl_offset = textures.reserveRows(num_textures);
+    if (texture_tbl_offset == AllocOOM) [[unlikely]] {
+      if (num_buffers > 0) {
+        buffers.releaseRows(buffer_tbl_offset, num_buffers);
+      }
+      reportError(ErrorStatus::TableFull);
+      return;
+    }
+  }
+
+  wgpu::CommandEncoder upload_enc;
+  GPUTmpMemBlock staging_block {};
+  if (tx_queue.id != -1) {
+    upload_enc = dev.CreateCommandEncoder();
+    waitUntilReady(tx_queue);
+  }
+
+  auto stagingAlloc = [this, tx_queue, &staging_block]
+    (u32 num_bytes) -> StagingHandle 
+  {
+    if (num_bytes > GPUTmpMemBlock::BLOCK_SIZE) {
+      return {
+        .buffer = {},
+        .offset = 0,
+        .ptr = nullptr,
+      }; 
+    }
+    
+    // FIXME move to validation
+    assert(tx_queue.id != -1);
+
+    u32 offset = staging_block.alloc(num_bytes, 4);
     if (staging_block.blockFull()) {
       staging_block = allocGPUTmpStagingBlock(tx_queue);
       staging_block.offset += num_bytes;
@@ -804,6 +1516,18 @@ void Backend::createGPUResources(i32 num_buffers,
       wgpu_usage |= wgpu::TextureUsage::CopyDst;
     }
 
+    assert(tex_init.numSamples == 1 ||
+           (dim == wgpu::TextureDimension::e2D &&
+            tex_init.numMipLevels == 1 && !staging.ptr));
+
+    bool generate_mips = tex_init.numMipLevels > 1 &&
+        supportsMipGeneration(tex_init.format);
+
+    if (generate_mips) {
+      wgpu_usage |= wgpu::TextureUsage::TextureBinding;
+      wgpu_usage |= wgpu::TextureUsage::RenderAttachment;
+    }
+
     wgpu::TextureDescriptor tex_desc {
       .usage = wgpu_usage,
       .dimension = dim,
@@ -814,7 +1538,7 @@ void Backend::createGPUResources(i32 num_buffers,
       },
       .format = convertTextureFormat(tex_init.format),
       .mipLevelCount = (u32)tex_init.numMipLevels,
-      .sampleCount = 1,
+      .sampleCount = (u32)tex_init.numSamples,
       .viewFormatCount = 0,
       .viewFormats = nullptr,
     };
@@ -832,6 +1556,7 @@ void Backend::createGPUResources(i32 num_buffers,
     u32 bytes_per_texel = bytesPerTexelForFormat(tex_init.format);
     new (to_cold) BackendTextureCold {
       .texture = std::move(wgpu_tex),
+      .format = tex_init.format,
       .baseWidth = width,
       .baseHeight = height,
       .baseDepth = depth,
@@ -844,7 +1569,6 @@ void Backend::createGPUResources(i32 num_buffers,
 
     texture_handles_out[tex_idx] = id;
 
-    assert(tex_init.numMipLevels == 1);
     u32 num_bytes = width * height * depth * bytes_per_texel;
 
     if (staging.ptr) {
@@ -876,13 +1600,22 @@ void Backend::createGPUResources(i32 num_buffers,
       };
 
       upload_enc.CopyBufferToTexture(&src, &dst, &copy_size);
+
+      if (generate_mips) {
+        encodeGenerateMips(upload_enc, *to_cold);
+      }
     }
   }
 
   if (tx_queue.id != -1) {
-    GPUTmpInputState &gpu_tmp_input = queueDatas[tx_queue.id].gpuTmpInput;
+    BackendQueueData &queue_data = queueDatas[tx_queue.id];
+    GPUTmpInputState &gpu_tmp_input = queue_data.gpuTmpInput;
     unmapActiveStagingBuffers(gpu_tmp_input);
 
+    // The uploads must run after work already submitted to tx_queue,
+    // including submissions that are still deferred
+    flushPendingSubmits(queue_data, queue_data.numSubmits);
+
     wgpu::CommandBuffer cmd_buf = upload_enc.Finish();
     queue.Submit(1, &cmd_buf);
 
@@ -1141,6 +1874,43 @@ void Backend::destroySamplers(i32 num_samplers, Sampler *handles)
   });
 }
 
+void Backend::createQuerySets(i32 num_query_sets,
+                              const QuerySetInit *query_set_inits,
+                              QuerySet *handles_out)
+{
+  u32 tbl_offset = querySets.reserveRows(num_query_sets);
+  if (tbl_offset == AllocOOM) [[unlikely]] {
+    reportError(ErrorStatus::TableFull);
+    return;
+  }
+
+  for (i32 query_set_idx = 0; query_set_idx < num_query_sets;
+       query_set_idx++) {
+    const QuerySetInit &query_set_init = query_set_inits[query_set_idx];
+
+    auto [to_out, _, id] = querySets.get(tbl_offset, query_set_idx);
+
+    wgpu::QuerySetDescriptor query_set_descriptor {
+      .type = wgpu::QueryType::Occlusion,
+      .count = query_set_init.numQueries,
+    };
+
+    new (to_out) wgpu::QuerySet(dev.CreateQuerySet(&query_set_descriptor));
+
+    handles_out[query_set_idx] = id;
+  }
+}
+
+void Backend::destroyQuerySets(i32 num_query_sets, QuerySet *handles)
+{
+  querySets.releaseResources(num_query_sets, handles,
+    [](wgpu::QuerySet *to_query_set, auto)
+  {
+    to_query_set->Destroy();
+    to_query_set->~QuerySet();
+  });
+}
+
 void Backend::createParamBlockTypes(
     i32 num_types,
     const ParamBlockTypeInit *blk_types,
@@ -1163,7 +1933,7 @@ void Backend::createParamBlockTypes(
 
     const i32 num_buffer_bindings = (i32)type_init.buffers.size();
     const i32 num_texture_bindings = (i32)type_init.textures.size();
-    const i32 num_sampler_bindings = (i32)type_init.textures.size();
+    const i32 num_sampler_bindings = (i32)type_init.samplers.size();
 
     i32 out_binding_idx = 0;
     for (i32 buffer_binding_idx = 0;
@@ -1208,6 +1978,7 @@ void Backend::createParamBlockTypes(
 
       wgpu::TextureSampleType sample_type;
       wgpu::TextureViewDimension tex_dim;
+      bool is_storage = false;
       switch (texture_cfg.type) {
         case Texture1D: {
           sample_type = wgpu::TextureSampleType::Float;
@@ -1224,18 +1995,44 @@ void Backend::createParamBlockTypes(
         case DepthTexture2D: {
           sample_type = wgpu::TextureSampleType::Depth;
           tex_dim = wgpu::TextureViewDimension::e2D;
-        default: MADRONA_UNREACHABLE();
         } break;
+        case StorageTexture1D: {
+          tex_dim = wgpu::TextureViewDimension::e1D;
+          is_storage = true;
+        } break;
+        case StorageTexture2D: {
+          tex_dim = wgpu::TextureViewDimension::e2D;
+          is_storage = true;
+        } break;
+        case StorageTexture3D: {
+          tex_dim = wgpu::TextureViewDimension::e3D;
+          is_storage = true;
+        } break;
+        default: MADRONA_UNREACHABLE();
       }
 
-      layout_entries[out_binding_idx++] = wgpu::BindGroupLayoutEntry {
-        .binding = (u32)binding,
-        .visibility = convertShaderStage(texture_cfg.shaderUsage),
-        .texture = wgpu::TextureBindingLayout {
-          .sampleType = sample_type,
-          .viewDimension = tex_dim,
-        },
-      };
+      if (is_storage) {
+        assert(texture_cfg.storageFormat != TextureFormat::None);
+
+        layout_entries[out_binding_idx++] = wgpu::BindGroupLayoutEntry {
+          .binding = (u32)binding,
+          .visibility = convertShaderStage(texture_cfg.shaderUsage),
+          .storageTexture = wgpu::StorageTextureBindingLayout {
+            .access = convertStorageTextureAccess(texture_cfg.storageAccess),
+            .format = convertTextureFormat(texture_cfg.storageFormat),
+            .viewDimension = tex_dim,
+          },
+        };
+      } else {
+        layout_entries[out_binding_idx++] = wgpu::BindGroupLayoutEntry {
+          .binding = (u32)binding,
+          .visibility = convertShaderStage(texture_cfg.shaderUsage),
+          .texture = wgpu::TextureBindingLayout {
+            .sampleType = sample_type,
+            .viewDimension = tex_dim,
+          },
+        };
+      }
     }
 
     for (i32 sampler_binding_idx = 0;
@@ -1404,11 +2201,22 @@ void Backend::createRasterPassInterfaces(
       rasterPassInterfaces.get(tbl_offset, interface_idx);
 
     const DepthAttachmentConfig &depth_cfg = interface_init.depthAttachment;
+    wgpu::TextureFormat depth_format = convertTextureFormat(depth_cfg.format);
+
+    // WebGPU requires stencil ops to be left undefined without stencil
+    bool has_stencil = formatHasStencil(depth_format);
     to_cfg->depthAttachment = {
-      .format = convertTextureFormat(depth_cfg.format),
+      .format = depth_format,
       .loadOp = convertAttachmentLoadMode(depth_cfg.loadMode),
       .storeOp = convertAttachmentStoreMode(depth_cfg.storeMode),
       .clearValue = depth_cfg.clearValue,
+      .stencilLoadOp = has_stencil ?
+          convertAttachmentLoadMode(depth_cfg.stencilLoadMode) :
+          wgpu::LoadOp::Undefined,
+      .stencilStoreOp = has_stencil ?
+          convertAttachmentStoreMode(depth_cfg.stencilStoreMode) :
+          wgpu::StoreOp::Undefined,
+      .stencilClearValue = depth_cfg.stencilClearValue,
     };
 
     i32 num_color_attachments = (i32)interface_init.colorAttachments.size();
@@ -1424,6 +2232,7 @@ void Backend::createRasterPassInterfaces(
     }
 
     to_cfg->numColorAttachments = num_color_attachments;
+    to_cfg->sampleCount = (u32)interface_init.numSamples;
 
     *to_uuid = RasterPassInterfaceID(interface_init.uuid);
 
@@ -1455,47 +2264,81 @@ void Backend::createRasterPasses(
   }
 
   for (i32 pass_idx = 0; pass_idx < num_passes; pass_idx++) {
-    const RasterPassInit &pass_init = pass_inits[pass_idx];
-
     auto [out, _, id] = rasterPasses.get(tbl_offset, pass_idx);
 
     new (out) BackendRasterPass {};
+    initRasterPass(pass_inits[pass_idx], *out);
 
-    const BackendRasterPassConfig *cfg =
-      rasterPassInterfaces.hot(pass_init.interface);
+    handles_out[pass_idx] = id;
+  }
+}
 
-    if (!pass_init.depthAttachment.null()) {
-      out->depthAttachment = {
-        .view = textures.hot(pass_init.depthAttachment)->view,
-        .loadOp = cfg->depthAttachment.loadOp,
-        .storeOp = cfg->depthAttachment.storeOp,
-        .clearValue = cfg->depthAttachment.clearValue,
-      };
+// Resolves the attachment views of a pass, shared by RasterPass objects
+// and transient passes that are set up at submit time
+void Backend::initRasterPass(const RasterPassInit &pass_init,
+                             BackendRasterPass &out)
+{
+  const BackendRasterPassConfig *cfg =
+    rasterPassInterfaces.hot(pass_init.interface);
+
+  if (!pass_init.depthAttachment.null()) {
+    out.depthAttachment = {
+      .view = textures.hot(pass_init.depthAttachment)->view,
+      .loadOp = cfg->depthAttachment.loadOp,
+      .storeOp = cfg->depthAttachment.storeOp,
+      .clearValue = cfg->depthAttachment.clearValue,
+      .stencilLoadOp = cfg->depthAttachment.stencilLoadOp,
+      .stencilStoreOp = cfg->depthAttachment.stencilStoreOp,
+      .stencilClearValue = cfg->depthAttachment.stencilClearValue,
+    };
+  } else {
+    assert(cfg->depthAttachment.format == wgpu::TextureFormat::Undefined);
+  }
+
+  out.numColorAttachments = (i32)pass_init.colorAttachments.size();
+  out.swapchainAttachmentIndex = -1;
+  for (i32 i = 0; i < (i32)pass_init.colorAttachments.size(); i++) {
+    const BackendColorAttachmentConfig &attach_cfg =
+        cfg->colorAttachments[i];
+    BackendColorAttachment &out_attach = out.colorAttachments[i];
+
+    Texture tex_hdl = pass_init.colorAttachments[i];
+    if (tex_hdl.gen == 0) {
+      assert(out.swapchainAttachmentIndex == -1);
+      out.swapchainAttachmentIndex = i;
+      out.swapchain = { tex_hdl.id };
     } else {
-      assert(cfg->depthAttachment.format == wgpu::TextureFormat::Undefined);
+      out_attach.view = textures.hot(tex_hdl)->view;
     }
+    out_attach.loadOp = attach_cfg.loadOp;
+    out_attach.storeOp = attach_cfg.storeOp;
+    out_attach.clearValue = attach_cfg.clearValue;
+  }
 
-    out->numColorAttachments = (i32)pass_init.colorAttachments.size();
-    out->swapchainAttachmentIndex = -1;
-    for (i32 i = 0; i < (i32)pass_init.colorAttachments.size(); i++) {
-      const BackendColorAttachmentConfig &attach_cfg =
-          cfg->colorAttachments[i];
-      BackendColorAttachment &out_attach = out->colorAttachments[i];
+  out.swapchainResolveIndex = -1;
+  assert(pass_init.resolveAttachments.size() == 0 ||
+         pass_init.resolveAttachments.size() ==
+             pass_init.colorAttachments.size());
+  for (i32 i = 0; i < (i32)pass_init.resolveAttachments.size(); i++) {
+    Texture tex_hdl = pass_init.resolveAttachments[i];
+    if (tex_hdl.null()) {
+      continue;
+    }
 
-      Texture tex_hdl = pass_init.colorAttachments[i];
-      if (tex_hdl.gen == 0) {
-        assert(out->swapchainAttachmentIndex == -1);
-        out->swapchainAttachmentIndex = i;
-        out->swapchain = { tex_hdl.id };
-      } else {
-        out_attach.view = textures.hot(tex_hdl)->view;
-      }
-      out_attach.loadOp = attach_cfg.loadOp;
-      out_attach.storeOp = attach_cfg.storeOp;
-      out_attach.clearValue = attach_cfg.clearValue;
+    assert(cfg->sampleCount > 1);
+
+    if (tex_hdl.gen == 0) {
+      assert(out.swapchainAttachmentIndex == -1 &&
+             out.swapchainResolveIndex == -1);
+      out.swapchainResolveIndex = i;
+      out.swapchain = { tex_hdl.id };
+    } else {
+      out.colorAttachments[i].resolveView = textures.hot(tex_hdl)->view;
     }
+  }
 
-    handles_out[pass_idx] = id;
+  if (!pass_init.occlusionQuerySet.null()) {
+    out.occlusionQuerySet = *querySets.hot(pass_init.occlusionQuerySet);
   }
 }
 
@@ -1534,6 +2377,7 @@ void Backend::createRasterShaders(i32 num_shaders,
     wgpu::ShaderModule shader_mod = dev.CreateShaderModule(&shader_mod_desc);
 
     wgpu::PrimitiveState primitive_state {
+      .topology = convertPrimitiveTopology(shader_init.topology),
       .cullMode = convertCullMode(raster_cfg.cullMode),
     };
 
@@ -1549,21 +2393,25 @@ void Backend::createRasterShaders(i32 num_shaders,
         vertex_buffers;
 
     const i32 num_vertex_buffers = (i32)shader_init.vertexBuffers.size();
-    assert(num_vertex_buffers < MAX_VERTEX_BUFFERS_PER_SHADER);
+    assert(num_vertex_buffers <= MAX_VERTEX_BUFFERS_PER_SHADER);
+    u32 shader_location = 0;
     for (i32 vbuf_idx = 0; vbuf_idx < num_vertex_buffers; vbuf_idx++) {
       const VertexBufferConfig &vbuf_cfg = shader_init.vertexBuffers[vbuf_idx];
       wgpu::VertexBufferLayout &out_layout = vertex_buffers[vbuf_idx];
       out_layout.arrayStride = vbuf_cfg.stride;
+      out_layout.stepMode =
+          vbuf_cfg.stepMode == VertexStepMode::Instance ?
+              wgpu::VertexStepMode::Instance : wgpu::VertexStepMode::Vertex;
       
       wgpu::VertexAttribute *out_attrs = vertex_attributes[vbuf_idx].data();
       const i32 num_attrs = vbuf_cfg.attributes.size();
-      assert(num_attrs < MAX_VERTEX_ATTRIBUTES);
+      assert(num_attrs <= MAX_VERTEX_ATTRIBUTES);
       for (i32 i = 0; i < num_attrs; i++) {
         VertexAttributeConfig attr_cfg = vbuf_cfg.attributes[i];
         out_attrs[i] = {
           .format = convertVertexFormat(attr_cfg.format),
           .offset = attr_cfg.offset,
-          .shaderLocation = (u32)i,
+          .shaderLocation = shader_location++,
         };
       }
 
@@ -1584,6 +2432,10 @@ void Backend::createRasterShaders(i32 num_shaders,
       .format = pass_cfg->depthAttachment.format,
       .depthWriteEnabled = raster_cfg.writeDepth,
       .depthCompare = convertDepthCompare(raster_cfg.depthCompare),
+      .stencilFront = convertStencilFace(raster_cfg.stencilFront),
+      .stencilBack = convertStencilFace(raster_cfg.stencilBack),
+      .stencilReadMask = raster_cfg.stencilReadMask,
+      .stencilWriteMask = raster_cfg.stencilWriteMask,
       .depthBias = raster_cfg.depthBias,
       .depthBiasSlopeScale = raster_cfg.depthBiasSlope,
       .depthBiasClamp = raster_cfg.depthBiasClamp,
@@ -1640,7 +2492,9 @@ void Backend::createRasterShaders(i32 num_shaders,
     i32 per_draw_bind_group_slot = -1;
     if (shader_init.numPerDrawBytes > 0) {
       per_draw_bind_group_slot = num_bind_groups++;
-      bind_group_layouts[per_draw_bind_group_slot] = tmpDynamicUniformLayout;
+      bind_group_layouts[per_draw_bind_group_slot] =
+          shader_init.packDrawData ?
+              tmpStorageLayout : tmpDynamicUniformLayout;
     }
 
     wgpu::PipelineLayoutDescriptor layout_descriptor {
@@ -1658,6 +2512,9 @@ void Backend::createRasterShaders(i32 num_shaders,
       .depthStencil =
           pass_cfg->depthAttachment.format == wgpu::TextureFormat::Undefined ?
               nullptr : &depth_state,
+      .multisample = {
+        .count = pass_cfg->sampleCount,
+      },
       .fragment = &frag_state,
     };
 
@@ -1667,6 +2524,9 @@ void Backend::createRasterShaders(i32 num_shaders,
     new (out) BackendRasterShader {
       .pipeline = std::move(pipeline),
       .perDrawBindGroupSlot = per_draw_bind_group_slot,
+      .packedDrawData = shader_init.packDrawData,
+      .numPrimitiveVertices =
+          primitiveTopologyNumVertices(shader_init.topology),
     };
     handles_out[shader_idx] = id;
   }
@@ -1681,6 +2541,185 @@ void Backend::destroyRasterShaders(i32 num_shaders, RasterShader *handles)
   });
 }
 
+RenderBundle Backend::createRenderBundle(RenderBundleInit init,
+                                        FrontendCommands *cmds)
+{
+  u32 tbl_offset = renderBundles.reserveRows(1);
+  if (tbl_offset == AllocOOM) [[unlikely]] {
+    reportError(ErrorStatus::TableFull);
+    return {};
+  }
+
+  const BackendRasterPassConfig *pass_cfg =
+      getRasterPassConfigByID(init.rasterPass);
+
+  std::array<wgpu::TextureFormat, MAX_COLOR_ATTACHMENTS> color_formats;
+  for (i32 i = 0; i < pass_cfg->numColorAttachments; i++) {
+    color_formats[i] = pass_cfg->colorAttachments[i].format;
+  }
+
+  wgpu::RenderBundleEncoderDescriptor bundle_enc_desc {
+    .colorFormatCount = (size_t)pass_cfg->numColorAttachments,
+    .colorFormats = color_formats.data(),
+    .depthStencilFormat = pass_cfg->depthAttachment.format,
+    .sampleCount = pass_cfg->sampleCount,
+  };
+
+  wgpu::RenderBundleEncoder bundle_enc =
+      dev.CreateRenderBundleEncoder(&bundle_enc_desc);
+
+  CommandDecoder decoder(cmds);
+  DrawStateBindings draw_bindings {};
+
+  while (true) {
+    CommandCtrl ctrl = decoder.ctrl();
+
+#ifdef GAS_WGPU_DEBUG_PRINT
+    if (ctrl != CommandCtrl::None) {
+      debugPrintDrawCommandCtrl(ctrl);
+    }
+#endif
+
+    CommandCtrl ctrl_masked = ctrl &
+        (CommandCtrl::RasterDraw |
+         CommandCtrl::RasterDrawIndexed |
+         CommandCtrl::RasterDrawIndirect |
+         CommandCtrl::RasterDrawIndexedIndirect);
+
+    if (ctrl_masked == CommandCtrl::None) {
+      break;
+    }
+
+    // Bundles have no draw data to bind
+    DrawParams draw_params = encodeDrawState(
+        bundle_enc, decoder, ctrl, nullptr, draw_bindings);
+    assert(draw_bindings.dynamicBindGroupIdx == -1);
+
+    switch (ctrl_masked) {
+      case CommandCtrl::RasterDraw: {
+        bundle_enc.Draw(
+            draw_params.numTriangles * draw_bindings.numPrimitiveVertices,
+            draw_params.numInstances,
+            draw_params.vertexOffset,
+            draw_params.instanceOffset);
+      } break;
+      case CommandCtrl::RasterDrawIndexed: {
+        bundle_enc.DrawIndexed(
+            draw_params.numTriangles * draw_bindings.numPrimitiveVertices,
+            draw_params.numInstances,
+            draw_params.indexOffset,
+            draw_params.vertexOffset,
+            draw_params.instanceOffset);
+      } break;
+      case CommandCtrl::RasterDrawIndirect: {
+        DrawIndirectParams indirect = decoder.drawIndirectParams(ctrl);
+
+        bundle_enc.DrawIndirect(*buffers.hot(indirect.buffer),
+                                indirect.offset);
+      } break;
+      case CommandCtrl::RasterDrawIndexedIndirect: {
+        DrawIndirectParams indirect = decoder.drawIndirectParams(ctrl);
+
+        bundle_enc.DrawIndexedIndirect(*buffers.hot(indirect.buffer),
+                                       indirect.offset);
+      } break;
+      default: MADRONA_UNREACHABLE();
+    }
+  }
+
+  auto [out, _, id] = renderBundles.get(tbl_offset, 0);
+  new (out) wgpu::RenderBundle(bundle_enc.Finish());
+
+  return id;
+}
+
+void Backend::destroyRenderBundles(i32 num_bundles, RenderBundle *handles)
+{
+  renderBundles.releaseResources(num_bundles, handles,
+    [](wgpu::RenderBundle *to_bundle, auto)
+  {
+    to_bundle->~RenderBundle();
+  });
+}
+
+void Backend::createComputeShaders(i32 num_shaders,
+                                   const ComputeShaderInit *shader_inits,
+                                   ComputeShader *handles_out)
+{
+  u32 tbl_offset = computeShaders.reserveRows(num_shaders);
+  if (tbl_offset == AllocOOM) [[unlikely]] {
+    reportError(ErrorStatus::TableFull);
+    return;
+  }
+
+  for (i32 shader_idx = 0; shader_idx < num_shaders; shader_idx++) {
+    const ComputeShaderInit &shader_init = shader_inits[shader_idx];
+
+    wgpu::ShaderModuleWGSLDescriptor wgsl_desc {{
+      .nextInChain = nullptr,
+      .code = (const char *)shader_init.byteCode.data,
+    }};
+    wgpu::ShaderModuleDescriptor shader_mod_desc {
+      .nextInChain = &wgsl_desc,
+    };
+
+    wgpu::ShaderModule shader_mod = dev.CreateShaderModule(&shader_mod_desc);
+
+    wgpu::BindGroupLayout bind_group_layouts[MAX_BIND_GROUPS_PER_SHADER];
+
+    i32 num_bind_groups = shader_init.paramBlockTypes.size();
+    assert(num_bind_groups <= MAX_BIND_GROUPS_PER_SHADER);
+    for (i32 i = 0; i < num_bind_groups; i++) {
+      bind_group_layouts[i] =
+        getBindGroupLayoutByParamBlockTypeID(shader_init.paramBlockTypes[i]);
+    }
+
+    i32 per_dispatch_bind_group_slot = -1;
+    if (shader_init.numPerDispatchBytes > 0) {
+      assert(num_bind_groups < MAX_BIND_GROUPS_PER_SHADER);
+      per_dispatch_bind_group_slot = num_bind_groups++;
+      bind_group_layouts[per_dispatch_bind_group_slot] =
+          tmpDynamicUniformLayout;
+    }
+
+    wgpu::PipelineLayoutDescriptor layout_descriptor {
+      .bindGroupLayoutCount = (size_t)num_bind_groups,
+      .bindGroupLayouts = bind_group_layouts,
+    };
+
+    wgpu::PipelineLayout pipeline_layout =
+      dev.CreatePipelineLayout(&layout_descriptor);
+
+    wgpu::ComputePipelineDescriptor pipeline_desc {
+      .layout = std::move(pipeline_layout),
+      .compute = {
+        .module = shader_mod,
+        .entryPoint = shader_init.entry,
+        .constantCount = 0,
+        .constants = nullptr,
+      },
+    };
+
+    wgpu::ComputePipeline pipeline = dev.CreateComputePipeline(&pipeline_desc);
+
+    auto [out, _, id] = computeShaders.get(tbl_offset, shader_idx);
+    new (out) BackendComputeShader {
+      .pipeline = std::move(pipeline),
+      .perDispatchBindGroupSlot = per_dispatch_bind_group_slot,
+    };
+    handles_out[shader_idx] = id;
+  }
+}
+
+void Backend::destroyComputeShaders(i32 num_shaders, ComputeShader *handles)
+{
+  computeShaders.releaseResources(num_shaders, handles,
+    [](BackendComputeShader *to_shader, auto)
+  {
+    to_shader->~BackendComputeShader();
+  });
+}
+
 Swapchain Backend::createSwapchain(Surface surface,
                                    SwapchainProperties *properties)
 {
@@ -1814,14 +2853,18 @@ void Backend::waitUntilReady(GPUQueue)
   inst.ProcessEvents();
 }
 
-void Backend::waitUntilWorkFinished(GPUQueue)
+void Backend::waitUntilWorkFinished(GPUQueue queue_hdl)
 {
+  BackendQueueData &queue_data = queueDatas[queue_hdl.id];
+  flushPendingSubmits(queue_data, queue_data.numSubmits);
+
   inst.ProcessEvents();
   // Essentially a no-op on webgpu
 }
 
 void Backend::waitUntilIdle()
 {
+  flushAllPendingSubmits();
   inst.ProcessEvents();
 
   wgpu::QueueWorkDoneStatus queue_status;
@@ -2017,37 +3060,225 @@ void Backend::unmapActiveStagingBuffers(GPUTmpInputState &gpu_tmp_input)
   }
 }
 
-void Backend::mapActiveStagingBuffers(GPUTmpInputState &gpu_tmp_input)
+i32 Backend::getActiveStagingBuffers(GPUTmpInputState &gpu_tmp_input,
+                                     i32 *out)
 {
-  auto mapStagingBuffer =
-    [this]
-  (i32 idx)
-  {
-    stagingBelt.buffers[idx].MapAsync(wgpu::MapMode::Write, 0,
-        TMP_BUFFER_SIZE,
-        wgpu::CallbackMode::AllowSpontaneous,
-        returnBufferToStagingBeltCallback,
-        (void *)&stagingBelt.cbStates[idx]);
-  };
+  i32 num_out = 0;
 
   u32 end_staging_offset = u32(gpu_tmp_input.curTmpStagingRange >> 32);
   i32 num_active_staging_buffers =
       (i32)end_staging_offset / NUM_BLOCKS_PER_TMP_BUFFER;
 
   for (i32 i = 0; i < num_active_staging_buffers; i++) {
-    mapStagingBuffer(gpu_tmp_input.tmpStagingBuffers[i]);
+    out[num_out++] = gpu_tmp_input.tmpStagingBuffers[i];
   }
 
   u32 end_tmp_input_offset = u32(gpu_tmp_input.curTmpInputRange >> 32);
   i32 num_active_tmp_input_buffers =
       (i32)end_tmp_input_offset / NUM_BLOCKS_PER_TMP_BUFFER;
 
-  for (i32 i = 0; i < num_active_tmp_input_buffers; i++) {
-    mapStagingBuffer(gpu_tmp_input.gpuTmpInputStagingBuffers[i]);
-  }
+  for (i32 i = 0; i < num_active_tmp_input_buffers; i++) {
+    out[num_out++] = gpu_tmp_input.gpuTmpInputStagingBuffers[i];
+  }
+
+  return num_out;
+}
+
+void Backend::mapStagingBuffer(i32 staging_belt_idx)
+{
+  stagingBelt.buffers[staging_belt_idx].MapAsync(wgpu::MapMode::Write, 0,
+      TMP_BUFFER_SIZE,
+      wgpu::CallbackMode::AllowSpontaneous,
+      returnBufferToStagingBeltCallback,
+      (void *)&stagingBelt.cbStates[staging_belt_idx]);
+}
+
+void Backend::mapActiveStagingBuffers(GPUTmpInputState &gpu_tmp_input)
+{
+  std::array<i32, MAX_TMP_BUFFERS_PER_QUEUE * 2> active;
+  i32 num_active = getActiveStagingBuffers(gpu_tmp_input, active.data());
+
+  for (i32 i = 0; i < num_active; i++) {
+    mapStagingBuffer(active[i]);
+  }
+}
+
+void Backend::trackSubmitCompletion(BackendQueueData &queue_data,
+                                    u64 submit_id)
+{
+  // The work done callbacks are only invoked from inst.ProcessEvents(), on
+  // the thread that submits & waits
+  queue.OnSubmittedWorkDone(wgpu::CallbackMode::AllowProcessEvents,
+    [&queue_data, submit_id](wgpu::QueueWorkDoneStatus status)
+    {
+      if (status == wgpu::QueueWorkDoneStatus::Error) {
+        FATAL("WebGPU backend: error while waiting for submission %lu",
+              submit_id);
+      }
+
+      queue_data.numFinishedSubmits =
+          std::max(queue_data.numFinishedSubmits, submit_id);
+    });
+}
+
+void Backend::flushPendingSubmits(BackendQueueData &queue_data, u64 up_to_id)
+{
+  up_to_id = std::min(up_to_id, queue_data.numSubmits);
+
+  while (queue_data.numFlushedSubmits < up_to_id) {
+    u64 submit_id = ++queue_data.numFlushedSubmits;
+
+    PendingSubmit &pending = queue_data.pendingSubmits[
+        submit_id % MAX_PENDING_SUBMITS_PER_QUEUE];
+
+    queue.Submit(1, &pending.cmdBuf);
+    pending.cmdBuf = nullptr;
+
+    for (i32 i = 0; i < pending.numStagingBuffers; i++) {
+      mapStagingBuffer(pending.stagingBuffers[i]);
+    }
+    pending.numStagingBuffers = 0;
+
+    trackSubmitCompletion(queue_data, submit_id);
+  }
+}
+
+void Backend::flushAllPendingSubmits()
+{
+  for (BackendQueueData &queue_data : queueDatas) {
+    flushPendingSubmits(queue_data, queue_data.numSubmits);
+  }
+}
+
+bool Backend::isSubmitFinished(GPUSubmitToken token)
+{
+  if (token.null()) {
+    return true;
+  }
+
+  BackendQueueData &queue_data = queueDatas[token.queue];
+  if (queue_data.numFinishedSubmits >= token.id) {
+    return true;
+  }
+
+  // A deferred submission can't finish until it reaches the wgpu::Queue
+  flushPendingSubmits(queue_data, token.id);
+
+  inst.ProcessEvents();
+
+  return queue_data.numFinishedSubmits >= token.id;
+}
+
+void Backend::waitForSubmit(GPUSubmitToken token)
+{
+  if (token.null()) {
+    return;
+  }
+
+  BackendQueueData &queue_data = queueDatas[token.queue];
+  flushPendingSubmits(queue_data, token.id);
+
+  while (queue_data.numFinishedSubmits < token.id) {
+    inst.ProcessEvents();
+  }
+}
+
+template <typename EncoderT>
+DrawParams Backend::encodeDrawState(EncoderT &enc,
+                                    CommandDecoder &decoder,
+                                    CommandCtrl ctrl,
+                                    const GPUTmpInputState *gpu_tmp_input,
+                                    DrawStateBindings &bindings)
+{
+  // The per draw bind group slot and layout depend on the shader, so it's
+  // rebound whenever the shader, buffer or offset changes
+  bool rebind_draw_data = false;
+
+  if (RasterShader shader = decoder.drawShader(ctrl); !shader.null()) {
+    BackendRasterShader *to_raster_shader = rasterShaders.hot(shader);
+    enc.SetPipeline(to_raster_shader->pipeline);
+    bindings.dynamicBindGroupIdx = to_raster_shader->perDrawBindGroupSlot;
+    bindings.packedDrawData = to_raster_shader->packedDrawData;
+    bindings.numPrimitiveVertices = to_raster_shader->numPrimitiveVertices;
+    rebind_draw_data = true;
+  }
+
+  if (ParamBlock pb0 = decoder.drawParamBlock0(ctrl); !pb0.null()) {
+    enc.SetBindGroup(0, *paramBlocks.hot(pb0));
+  }
+
+  if (ParamBlock pb1 = decoder.drawParamBlock1(ctrl); !pb1.null()) {
+    enc.SetBindGroup(1, *paramBlocks.hot(pb1));
+  }
+
+  if (ParamBlock pb2 = decoder.drawParamBlock2(ctrl); !pb2.null()) {
+    enc.SetBindGroup(2, *paramBlocks.hot(pb2));
+  }
+
+  if (Buffer data_buf = decoder.drawDataBuffer(ctrl); !data_buf.null()) {
+    assert(gpu_tmp_input != nullptr);
+
+    i32 tmp_buf_idx =
+        (i32)data_buf.id - gpu_tmp_input->tmpBufferHandlesBase;
+
+    bindings.dynamicTmpInputBindGroup =
+        gpu_tmp_input->tmpGPUBufferBindGroups[tmp_buf_idx];
+    bindings.storageTmpInputBindGroup =
+        gpu_tmp_input->tmpGPUBufferStorageBindGroups[tmp_buf_idx];
+    rebind_draw_data = true;
+  }
+
+  if (u32 data_offset = decoder.drawDataOffset(ctrl);
+      data_offset != 0xFFFF'FFFF) {
+    bindings.dataOffset = data_offset;
+    rebind_draw_data = true;
+  }
+
+  if (rebind_draw_data && bindings.dynamicBindGroupIdx != -1) {
+    if (bindings.packedDrawData) {
+      if (bindings.storageTmpInputBindGroup != nullptr) {
+        enc.SetBindGroup(bindings.dynamicBindGroupIdx,
+                         bindings.storageTmpInputBindGroup);
+      }
+    } else if (bindings.dynamicTmpInputBindGroup != nullptr) {
+      enc.SetBindGroup(bindings.dynamicBindGroupIdx,
+                       bindings.dynamicTmpInputBindGroup,
+                       1, &bindings.dataOffset);
+    }
+  }
+
+  if (Buffer vb0 = decoder.drawVertexBuffer0(ctrl); !vb0.null()) {
+    enc.SetVertexBuffer(0, *buffers.hot(vb0));
+  }
+
+  if (Buffer vb1 = decoder.drawVertexBuffer1(ctrl); !vb1.null()) {
+    enc.SetVertexBuffer(1, *buffers.hot(vb1));
+  }
+
+  if (Buffer ib = decoder.drawIndexBuffer32(ctrl); !ib.null()) {
+    enc.SetIndexBuffer(*buffers.hot(ib), wgpu::IndexFormat::Uint32);
+  }
+  if (Buffer ib = decoder.drawIndexBuffer16(ctrl); !ib.null()) {
+    enc.SetIndexBuffer(*buffers.hot(ib), wgpu::IndexFormat::Uint16);
+  }
+
+  DrawParams draw_params = decoder.drawParams(ctrl);
+
+#ifdef GAS_WGPU_DEBUG_PRINT
+  printf(R"(DrawParams:
+  NumTriangles: %u
+  NumInstances: %u
+  VertexOffset: %u
+  InstanceOffset: %u
+)", draw_params.numTriangles, draw_params.numInstances,
+    draw_params.vertexOffset, draw_params.instanceOffset);
+#endif
+
+  return draw_params;
 }
 
-void Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds)
+GPUSubmitToken Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds,
+                              Span<const GPUSubmitToken> wait_tokens)
 {
 #ifdef GAS_WGPU_DEBUG_PRINT
   printf("WGPU: begin submit\n");
@@ -2055,6 +3286,18 @@ void Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds)
 
   BackendQueueData &queue_data = queueDatas[queue_hdl.id];
 
+  // WebGPU only exposes a single queue, so waiting on another queue's
+  // submission just requires it to reach the wgpu::Queue first. Secondary
+  // queue submissions are deferred until then, letting main queue work
+  // that doesn't depend on them go first.
+  for (GPUSubmitToken wait_token : wait_tokens) {
+    if (wait_token.null() || wait_token.queue == queue_hdl.id) {
+      continue;
+    }
+
+    flushPendingSubmits(queueDatas[wait_token.queue], wait_token.id);
+  }
+
   wgpu::CommandEncoder wgpu_enc = dev.CreateCommandEncoder();
 
   GPUTmpInputState &gpu_tmp_input = queue_data.gpuTmpInput;
@@ -2102,12 +3345,20 @@ void Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds)
 
   CommandDecoder decoder(cmds);
 
-  auto encodeRasterPass = [&]()
+  auto encodeRasterPass = [&](const BackendRasterPass &backend_pass)
   {
     decoder.resetDrawParams();
 
-    auto raster_pass = decoder.id<RasterPass>();
-    const BackendRasterPass &backend_pass = *rasterPasses.hot(raster_pass);
+    CommandCtrl pass_draw_types = decoder.ctrl();
+    bool emulate_multi_draws = !limits.supportsMultiDrawIndirect &&
+        (pass_draw_types & CommandCtrl::RasterMultiDrawIndexedIndirect) !=
+            CommandCtrl::None;
+
+    // Clamping to the GPU count has to happen outside the render pass
+    if (emulate_multi_draws) {
+      encodeMultiDrawEmulation(wgpu_enc, decoder, gpu_tmp_input);
+    }
+    u32 emulated_args_offset = 0;
 
     wgpu::RenderPassColorAttachment color_attachments[MAX_COLOR_ATTACHMENTS];
     wgpu::RenderPassDepthStencilAttachment depth_attachment;
@@ -2125,6 +3376,14 @@ void Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds)
       } else {
         out.view = in.view;
       }
+
+      if (i == backend_pass.swapchainResolveIndex) {
+        BackendSwapchain &backend_swapchain =
+          swapchains[backend_pass.swapchain.id];
+        out.resolveTarget = backend_swapchain.view;
+      } else {
+        out.resolveTarget = in.resolveView;
+      }
       out.loadOp = in.loadOp;
       out.storeOp = in.storeOp;
       out.clearValue = {
@@ -2150,82 +3409,27 @@ void Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds)
         backend_pass.depthAttachment.storeOp;
       depth_attachment.depthClearValue =
         backend_pass.depthAttachment.clearValue;
+      depth_attachment.stencilLoadOp =
+        backend_pass.depthAttachment.stencilLoadOp;
+      depth_attachment.stencilStoreOp =
+        backend_pass.depthAttachment.stencilStoreOp;
+      depth_attachment.stencilClearValue =
+        backend_pass.depthAttachment.stencilClearValue;
 
       pass_descriptor.depthStencilAttachment = &depth_attachment;
     }
 
+    pass_descriptor.occlusionQuerySet = backend_pass.occlusionQuerySet;
+
     wgpu::RenderPassEncoder pass_enc =
         wgpu_enc.BeginRenderPass(&pass_descriptor);
 
-    wgpu::BindGroup dynamic_tmp_input_bind_group;
-    i32 dynamic_bind_group_idx = -1;
+    DrawStateBindings draw_bindings {};
     while (true) {
-      auto updateDrawState =
-        [&]
-      (CommandCtrl ctrl)
+      auto updateDrawState = [&](CommandCtrl ctrl)
       {
-        if (RasterShader shader = decoder.drawShader(ctrl); !shader.null()) {
-          BackendRasterShader *to_raster_shader = rasterShaders.hot(shader);
-          pass_enc.SetPipeline(to_raster_shader->pipeline);
-          dynamic_bind_group_idx = to_raster_shader->perDrawBindGroupSlot;
-        }
-
-        if (ParamBlock pb0 = decoder.drawParamBlock0(ctrl); !pb0.null()) {
-          pass_enc.SetBindGroup(0, *paramBlocks.hot(pb0));
-        }
-
-        if (ParamBlock pb1 = decoder.drawParamBlock1(ctrl); !pb1.null()) {
-          pass_enc.SetBindGroup(1, *paramBlocks.hot(pb1));
-        }
-
-        if (ParamBlock pb2 = decoder.drawParamBlock2(ctrl); !pb2.null()) {
-          pass_enc.SetBindGroup(2, *paramBlocks.hot(pb2));
-        }
-
-        if (Buffer data_buf = decoder.drawDataBuffer(ctrl); !data_buf.null()) {
-          i32 tmp_buf_idx =
-              (i32)data_buf.id - gpu_tmp_input.tmpBufferHandlesBase;
-
-          dynamic_tmp_input_bind_group =
-              gpu_tmp_input.tmpGPUBufferBindGroups[tmp_buf_idx];
-        }
-
-        if (u32 data_offset = decoder.drawDataOffset(ctrl);
-            data_offset != 0xFFFF'FFFF) {
-          pass_enc.SetBindGroup(dynamic_bind_group_idx,
-                                dynamic_tmp_input_bind_group, 1, &data_offset);
-        }
-
-        if (Buffer vb0 = decoder.drawVertexBuffer0(ctrl); !vb0.null()) {
-          pass_enc.SetVertexBuffer(0, *buffers.hot(vb0));
-        }
-
-        if (Buffer vb1 = decoder.drawVertexBuffer1(ctrl); !vb1.null()) {
-          pass_enc.SetVertexBuffer(1, *buffers.hot(vb1));
-        }
-
-        if (Buffer ib = decoder.drawIndexBuffer32(ctrl); !ib.null()) {
-          pass_enc.SetIndexBuffer(*buffers.hot(ib),
-                                  wgpu::IndexFormat::Uint32);
-        }
-        if (Buffer ib = decoder.drawIndexBuffer16(ctrl); !ib.null()) {
-          pass_enc.SetIndexBuffer(*buffers.hot(ib),
-                                  wgpu::IndexFormat::Uint16);
-        }
-
-        DrawParams draw_params = decoder.drawParams(ctrl);
-
-#ifdef GAS_WGPU_DEBUG_PRINT
-        printf(R"(DrawParams:
-  NumTriangles: %u
-  NumInstances: %u
-  VertexOffset: %u
-  InstanceOffset: %u
-)", draw_params.numTriangles, draw_params.numInstances,
-    draw_params.vertexOffset, draw_params.instanceOffset);
-#endif
-
-        return draw_params;
+        return encodeDrawState(pass_enc, decoder, ctrl,
+                               &gpu_tmp_input, draw_bindings);
       };
 
       CommandCtrl ctrl = decoder.ctrl();
@@ -2237,7 +3441,16 @@ void Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds)
       CommandCtrl ctrl_masked = ctrl & 
           (CommandCtrl::RasterDraw |
            CommandCtrl::RasterDrawIndexed |
-           CommandCtrl::RasterScissors);
+           CommandCtrl::RasterDrawIndirect |
+           CommandCtrl::RasterDrawIndexedIndirect |
+           CommandCtrl::RasterMultiDrawIndexedIndirect |
+           CommandCtrl::RasterScissors |
+           CommandCtrl::RasterExecuteBundles |
+           CommandCtrl::RasterViewport |
+           CommandCtrl::RasterBlendConstant |
+           CommandCtrl::RasterStencilReference |
+           CommandCtrl::RasterBeginOcclusionQuery |
+           CommandCtrl::RasterEndOcclusionQuery);
 
       switch (ctrl_masked) {
         case CommandCtrl::None: {
@@ -2247,19 +3460,56 @@ void Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds)
         case CommandCtrl::RasterDraw: {
           DrawParams draw_params = updateDrawState(ctrl);
 
-          pass_enc.Draw(draw_params.numTriangles * 3,
-                        draw_params.numInstances,
-                        draw_params.vertexOffset,
-                        draw_params.instanceOffset);
+          pass_enc.Draw(
+              draw_params.numTriangles * draw_bindings.numPrimitiveVertices,
+              draw_params.numInstances,
+              draw_params.vertexOffset,
+              draw_params.instanceOffset);
         } break;
         case CommandCtrl::RasterDrawIndexed: {
           DrawParams draw_params = updateDrawState(ctrl);
 
-          pass_enc.DrawIndexed(draw_params.numTriangles * 3,
-                               draw_params.numInstances,
-                               draw_params.indexOffset,
-                               draw_params.vertexOffset,
-                               draw_params.instanceOffset);
+          pass_enc.DrawIndexed(
+              draw_params.numTriangles * draw_bindings.numPrimitiveVertices,
+              draw_params.numInstances,
+              draw_params.indexOffset,
+              draw_params.vertexOffset,
+              draw_params.instanceOffset);
+        } break;
+        case CommandCtrl::RasterDrawIndirect: {
+          updateDrawState(ctrl);
+          DrawIndirectParams indirect = decoder.drawIndirectParams(ctrl);
+
+          pass_enc.DrawIndirect(*buffers.hot(indirect.buffer),
+                                indirect.offset);
+        } break;
+        case CommandCtrl::RasterDrawIndexedIndirect: {
+          updateDrawState(ctrl);
+          DrawIndirectParams indirect = decoder.drawIndirectParams(ctrl);
+
+          pass_enc.DrawIndexedIndirect(*buffers.hot(indirect.buffer),
+                                       indirect.offset);
+        } break;
+        case CommandCtrl::RasterMultiDrawIndexedIndirect: {
+          updateDrawState(ctrl);
+          MultiDrawIndirectParams multi_draw =
+              decoder.multiDrawIndirectParams(ctrl);
+
+          if (!emulate_multi_draws) {
+            pass_enc.MultiDrawIndexedIndirect(
+                *buffers.hot(multi_draw.args.buffer), multi_draw.args.offset,
+                multi_draw.maxDraws,
+                *buffers.hot(multi_draw.countBuffer), multi_draw.countOffset);
+          } else {
+            for (u32 i = 0; i < multi_draw.maxDraws; i++) {
+              pass_enc.DrawIndexedIndirect(multiDrawEmulator.scratch,
+                  emulated_args_offset +
+                      i * DRAW_INDEXED_INDIRECT_ARGS_NUM_BYTES);
+            }
+
+            emulated_args_offset +=
+                multiDrawEmulationNumBytes(multi_draw.maxDraws);
+          }
         } break;
         case CommandCtrl::RasterScissors: {
           ScissorParams scissors = decoder.scissorParams();
@@ -2267,13 +3517,160 @@ void Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds)
           pass_enc.SetScissorRect(scissors.offsetX, scissors.offsetY,
                                   scissors.width, scissors.height);
         } break;
+        case CommandCtrl::RasterViewport: {
+          ViewportParams viewport = decoder.viewportParams();
+
+          pass_enc.SetViewport(viewport.offsetX, viewport.offsetY,
+                               viewport.width, viewport.height,
+                               viewport.minDepth, viewport.maxDepth);
+        } break;
+        case CommandCtrl::RasterBlendConstant: {
+          Vector4 color = decoder.blendConstant();
+
+          wgpu::Color wgpu_color {
+            .r = color.x,
+            .g = color.y,
+            .b = color.z,
+            .a = color.w,
+          };
+
+          pass_enc.SetBlendConstant(&wgpu_color);
+        } break;
+        case CommandCtrl::RasterStencilReference: {
+          pass_enc.SetStencilReference(decoder.stencilReference());
+        } break;
+        case CommandCtrl::RasterBeginOcclusionQuery: {
+          pass_enc.BeginOcclusionQuery(decoder.occlusionQueryIndex());
+        } break;
+        case CommandCtrl::RasterEndOcclusionQuery: {
+          pass_enc.EndOcclusionQuery();
+        } break;
+        case CommandCtrl::RasterExecuteBundles: {
+          u32 num_bundles = decoder.numBundles();
+
+          std::array<wgpu::RenderBundle, 32> to_bundles;
+          for (u32 i = 0; i < num_bundles;) {
+            u32 num_batch_bundles = 0;
+            for (; i < num_bundles &&
+                   num_batch_bundles < (u32)to_bundles.size(); i++) {
+              to_bundles[num_batch_bundles++] =
+                  *renderBundles.hot(decoder.id<RenderBundle>());
+            }
+
+            pass_enc.ExecuteBundles(num_batch_bundles, to_bundles.data());
+          }
+
+          // WebGPU clears the pass's draw state after executing bundles,
+          // which the frontend mirrors
+          decoder.resetDrawParams();
+          draw_bindings = {};
+        } break;
         default: MADRONA_UNREACHABLE();
       }
     }
 
     pass_enc.End();
   };
-   
+
+  auto encodeComputePass = [&]()
+  {
+    decoder.resetDispatchParams();
+
+    wgpu::ComputePassEncoder pass_enc = wgpu_enc.BeginComputePass();
+
+    wgpu::BindGroup dynamic_tmp_input_bind_group;
+    i32 dynamic_bind_group_idx = -1;
+    u32 dynamic_data_offset = 0;
+
+    auto updateDispatchState = [&](CommandCtrl ctrl)
+    {
+      // Like encodeDrawState, the per dispatch bind group slot depends on
+      // the shader, so it's rebound whenever the shader, buffer or offset
+      // changes
+      bool rebind_dispatch_data = false;
+
+      if (ComputeShader shader = decoder.computeShader(ctrl);
+          !shader.null()) {
+        BackendComputeShader *to_compute_shader = computeShaders.hot(shader);
+        pass_enc.SetPipeline(to_compute_shader->pipeline);
+        dynamic_bind_group_idx = to_compute_shader->perDispatchBindGroupSlot;
+        rebind_dispatch_data = true;
+      }
+
+      if (ParamBlock pb0 = decoder.computeParamBlock0(ctrl); !pb0.null()) {
+        pass_enc.SetBindGroup(0, *paramBlocks.hot(pb0));
+      }
+
+      if (ParamBlock pb1 = decoder.computeParamBlock1(ctrl); !pb1.null()) {
+        pass_enc.SetBindGroup(1, *paramBlocks.hot(pb1));
+      }
+
+      if (ParamBlock pb2 = decoder.computeParamBlock2(ctrl); !pb2.null()) {
+        pass_enc.SetBindGroup(2, *paramBlocks.hot(pb2));
+      }
+
+      if (Buffer data_buf = decoder.computeDataBuffer(ctrl);
+          !data_buf.null()) {
+        i32 tmp_buf_idx =
+            (i32)data_buf.id - gpu_tmp_input.tmpBufferHandlesBase;
+
+        dynamic_tmp_input_bind_group =
+            gpu_tmp_input.tmpGPUBufferBindGroups[tmp_buf_idx];
+        rebind_dispatch_data = true;
+      }
+
+      if (u32 data_offset = decoder.computeDataOffset(ctrl);
+          data_offset != 0xFFFF'FFFF) {
+        // dispatchData requires a shader created with numPerDispatchBytes
+        assert(dynamic_bind_group_idx >= 0);
+
+        dynamic_data_offset = data_offset;
+        rebind_dispatch_data = true;
+      }
+
+      if (rebind_dispatch_data && dynamic_bind_group_idx != -1 &&
+          dynamic_tmp_input_bind_group != nullptr) {
+        pass_enc.SetBindGroup(dynamic_bind_group_idx,
+                              dynamic_tmp_input_bind_group,
+                              1, &dynamic_data_offset);
+      }
+    };
+
+    while (true) {
+      CommandCtrl ctrl = decoder.ctrl();
+
+      CommandCtrl ctrl_masked = ctrl &
+          (CommandCtrl::Dispatch |
+           CommandCtrl::DispatchIndirect);
+
+      switch (ctrl_masked) {
+        case CommandCtrl::None: {
+          pass_enc.End();
+          return;
+        } break;
+        case CommandCtrl::Dispatch: {
+          updateDispatchState(ctrl);
+
+          DispatchParams dispatch_params = decoder.dispatchParams(ctrl);
+
+          pass_enc.DispatchWorkgroups(dispatch_params.numBlocksX,
+                                      dispatch_params.numBlocksY,
+                                      dispatch_params.numBlocksZ);
+        } break;
+        case CommandCtrl::DispatchIndirect: {
+          updateDispatchState(ctrl);
+
+          DispatchIndirectParams indirect_params =
+              decoder.dispatchIndirectParams(ctrl);
+
+          pass_enc.DispatchWorkgroupsIndirect(
+              *buffers.hot(indirect_params.buffer), indirect_params.offset);
+        } break;
+        default: MADRONA_UNREACHABLE();
+      }
+    }
+  };
+
   auto encodeCopyPass = [&]()
   {
     decoder.resetCopyCommand();
@@ -2285,7 +3682,11 @@ void Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds)
           (CommandCtrl::CopyCmdBufferToBuffer |
            CommandCtrl::CopyCmdBufferToTexture |
            CommandCtrl::CopyCmdTextureToBuffer |
-           CommandCtrl::CopyCmdBufferClear);
+           CommandCtrl::CopyCmdBufferClear |
+           CommandCtrl::CopyCmdGenerateMips |
+           CommandCtrl::CopyCmdScatterUpdate |
+           CommandCtrl::CopyCmdTextureToBufferConverted |
+           CommandCtrl::CopyCmdResolveQuerySet);
 
       switch (ctrl_masked) {
         case CommandCtrl::None: {
@@ -2320,10 +3721,14 @@ void Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds)
           u32 height = std::max(mip0_height >> b2t.dstMipLevel, 1_u32);
           u32 depth = std::max(mip0_depth >> b2t.dstMipLevel, 1_u32);
 
+          // Row pitch must be 256 byte aligned unless there is only 1 row
+          u32 bytes_per_row = height == 1 && depth == 1 ?
+              wgpu::kCopyStrideUndefined : width * bytes_per_texel;
+
           wgpu::ImageCopyBuffer src {
             .layout = {
               .offset = b2t.srcOffset,
-              .bytesPerRow = width * bytes_per_texel,
+              .bytesPerRow = bytes_per_row,
             },
             .buffer = *buffers.hot(b2t.src),
           };
@@ -2362,6 +3767,10 @@ void Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds)
           u32 height = std::max(mip0_height >> t2b.srcMipLevel, 1_u32);
           u32 depth = std::max(mip0_depth >> t2b.srcMipLevel, 1_u32);
 
+          // Row pitch must be 256 byte aligned unless there is only 1 row
+          u32 bytes_per_row = height == 1 && depth == 1 ?
+              wgpu::kCopyStrideUndefined : width * bytes_per_texel;
+
           wgpu::ImageCopyTexture src {
             .texture = to_tex_data->texture,
             .mipLevel = t2b.srcMipLevel,
@@ -2370,7 +3779,7 @@ void Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds)
           wgpu::ImageCopyBuffer dst {
             .layout = {
               .offset = t2b.dstOffset,
-              .bytesPerRow = width * bytes_per_texel,
+              .bytesPerRow = bytes_per_row,
             },
             .buffer = *buffers.hot(t2b.dst),
           };
@@ -2389,6 +3798,30 @@ void Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds)
           wgpu_enc.ClearBuffer(*buffers.hot(clear.buffer), clear.offset,
                                clear.numBytes);
         } break;
+        case CommandCtrl::CopyCmdGenerateMips: {
+          CopyGenerateMipsCmd mips = decoder.copyGenerateMips(ctrl);
+
+          encodeGenerateMips(wgpu_enc, *textures.cold(mips.texture));
+        } break;
+        case CommandCtrl::CopyCmdScatterUpdate: {
+          CopyScatterUpdateCmd scatter = decoder.copyScatterUpdate(ctrl);
+
+          encodeScatterUpdate(wgpu_enc, scatter);
+        } break;
+        case CommandCtrl::CopyCmdTextureToBufferConverted: {
+          CopyTextureToBufferConvertedCmd convert =
+              decoder.copyTextureToBufferConverted(ctrl);
+
+          encodeTextureConversion(wgpu_enc, convert);
+        } break;
+        case CommandCtrl::CopyCmdResolveQuerySet: {
+          CopyResolveQuerySetCmd resolve = decoder.copyResolveQuerySet(ctrl);
+
+          wgpu_enc.ResolveQuerySet(*querySets.hot(resolve.querySet),
+                                   resolve.firstQuery, resolve.numQueries,
+                                   *buffers.hot(resolve.dst),
+                                   resolve.dstOffset);
+        } break;
         default: MADRONA_UNREACHABLE();
       }
     }
@@ -2397,9 +3830,31 @@ void Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds)
   for (CommandCtrl ctrl; (ctrl = decoder.ctrl()) != CommandCtrl::None;) {
     switch (ctrl) {
       case CommandCtrl::RasterPass: {
-        encodeRasterPass();
+        auto raster_pass = decoder.id<RasterPass>();
+        encodeRasterPass(*rasterPasses.hot(raster_pass));
+      } break;
+      case CommandCtrl::TransientRasterPass: {
+        TransientRasterPassParams params = decoder.transientRasterPass();
+
+        BackendRasterPass transient_pass {};
+        initRasterPass({
+          .interface = params.interface,
+          .depthAttachment = params.depthAttachment,
+          .colorAttachments = {
+            params.colorAttachments.data(),
+            (i64)params.numColorAttachments,
+          },
+          .resolveAttachments = {
+            params.resolveAttachments.data(),
+            (i64)params.numResolveAttachments,
+          },
+          .occlusionQuerySet = params.occlusionQuerySet,
+        }, transient_pass);
+
+        encodeRasterPass(transient_pass);
       } break;
       case CommandCtrl::ComputePass: {
+        encodeComputePass();
       } break;
       case CommandCtrl::CopyPass: {
         encodeCopyPass();
@@ -2409,10 +3864,30 @@ void Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds)
   }
 
   wgpu::CommandBuffer cmd_buf = wgpu_enc.Finish();
-  queue.Submit(1, &cmd_buf);
 
-  mapActiveStagingBuffers(gpu_tmp_input);
+  u64 submit_id = ++queue_data.numSubmits;
+
+  if (queue_hdl.id == getMainQueue().id) {
+    queue.Submit(1, &cmd_buf);
+    mapActiveStagingBuffers(gpu_tmp_input);
+
+    queue_data.numFlushedSubmits = submit_id;
+    trackSubmitCompletion(queue_data, submit_id);
 
+    // Secondary queue work recorded before this submission runs behind it
+    flushAllPendingSubmits();
+  } else {
+    if (submit_id - queue_data.numFlushedSubmits >
+        (u64)MAX_PENDING_SUBMITS_PER_QUEUE) {
+      flushPendingSubmits(queue_data, queue_data.numFlushedSubmits + 1);
+    }
+
+    PendingSubmit &pending = queue_data.pendingSubmits[
+        submit_id % MAX_PENDING_SUBMITS_PER_QUEUE];
+    pending.cmdBuf = std::move(cmd_buf);
+    pending.numStagingBuffers = getActiveStagingBuffers(
+        gpu_tmp_input, pending.stagingBuffers.data());
+  }
 
   // Clear staging buffer tracking for next submission
   {
@@ -2434,6 +3909,11 @@ void Backend::submit(GPUQueue queue_hdl, FrontendCommands *cmds)
 
     tmp_param_block_state.numLive = 0;
   }
+
+  return GPUSubmitToken {
+    .queue = queue_hdl.id,
+    .id = submit_id,
+  };
 }
 
 BackendRasterPassConfig * Backend::getRasterPassConfigByID(
@@ -2468,6 +3948,265 @@ wgpu::BindGroupLayout Backend::getBindGroupLayoutByParamBlockTypeID(
   }
 }
 
+void Backend::encodeGenerateMips(wgpu::CommandEncoder &enc,
+                                 const BackendTextureCold &tex)
+{
+  assert(tex.baseDepth == 1);
+
+  if (!supportsMipGeneration(tex.format)) {
+    FATAL("Mip generation is unsupported for texture format %u",
+          (u32)tex.format);
+  }
+
+  wgpu::TextureFormat format = tex.texture.GetFormat();
+  u32 num_mip_levels = tex.texture.GetMipLevelCount();
+
+  const wgpu::RenderPipeline &pipeline =
+      mipGenerator.pipelines[(i32)tex.format];
+
+  wgpu::TextureViewDescriptor view_desc {
+    .format = format,
+    .dimension = wgpu::TextureViewDimension::e2D,
+    .baseMipLevel = 0,
+    .mipLevelCount = 1,
+  };
+
+  wgpu::TextureView src_view = tex.texture.CreateView(&view_desc);
+
+  for (u32 mip_idx = 1; mip_idx < num_mip_levels; mip_idx++) {
+    view_desc.baseMipLevel = mip_idx;
+    wgpu::TextureView dst_view = tex.texture.CreateView(&view_desc);
+
+    wgpu::BindGroupEntry bind_group_entries[2] {
+      {
+        .binding = 0,
+        .textureView = src_view,
+      },
+      {
+        .binding = 1,
+        .sampler = mipGenerator.sampler,
+      },
+    };
+
+    wgpu::BindGroupDescriptor bind_group_desc {
+      .layout = mipGenerator.layout,
+      .entryCount = 2,
+      .entries = bind_group_entries,
+    };
+
+    wgpu::BindGroup bind_group = dev.CreateBindGroup(&bind_group_desc);
+
+    wgpu::RenderPassColorAttachment color_attachment {
+      .view = dst_view,
+      .loadOp = wgpu::LoadOp::Clear,
+      .storeOp = wgpu::StoreOp::Store,
+      .clearValue = { 0, 0, 0, 0 },
+    };
+
+    wgpu::RenderPassDescriptor pass_desc {
+      .colorAttachmentCount = 1,
+      .colorAttachments = &color_attachment,
+    };
+
+    wgpu::RenderPassEncoder pass_enc = enc.BeginRenderPass(&pass_desc);
+    pass_enc.SetPipeline(pipeline);
+    pass_enc.SetBindGroup(0, bind_group);
+    pass_enc.Draw(3);
+    pass_enc.End();
+
+    src_view = std::move(dst_view);
+  }
+}
+
+void Backend::encodeScatterUpdate(wgpu::CommandEncoder &enc,
+                                  const CopyScatterUpdateCmd &scatter)
+{
+  enc.CopyBufferToBuffer(*buffers.hot(scatter.src), scatter.srcOffset,
+                         scatterUpdater.scratch, 0, scatter.numBytes);
+
+  wgpu::BindGroupEntry bind_group_entries[2] {
+    {
+      .binding = 0,
+      .buffer = scatterUpdater.scratch,
+      .offset = 0,
+      .size = scatter.numBytes,
+    },
+    {
+      .binding = 1,
+      .buffer = *buffers.hot(scatter.dst),
+    },
+  };
+
+  wgpu::BindGroupDescriptor bind_group_desc {
+    .layout = scatterUpdater.layout,
+    .entryCount = 2,
+    .entries = bind_group_entries,
+  };
+
+  wgpu::BindGroup bind_group = dev.CreateBindGroup(&bind_group_desc);
+
+  u32 num_blocks_x = std::min(scatter.numRegions, MAX_WORKGROUPS_PER_DIM);
+  u32 num_blocks_y = utils::divideRoundUp(scatter.numRegions, num_blocks_x);
+
+  wgpu::ComputePassEncoder pass_enc = enc.BeginComputePass();
+  pass_enc.SetPipeline(scatterUpdater.pipeline);
+  pass_enc.SetBindGroup(0, bind_group);
+  pass_enc.DispatchWorkgroups(num_blocks_x, num_blocks_y);
+  pass_enc.End();
+}
+
+void Backend::encodeTextureConversion(
+    wgpu::CommandEncoder &enc,
+    const CopyTextureToBufferConvertedCmd &cmd)
+{
+  const BackendTextureCold &tex = *textures.cold(cmd.copy.src);
+  assert(tex.baseDepth == 1);
+
+  u32 width = std::max(tex.baseWidth >> cmd.copy.srcMipLevel, 1_u32);
+  u32 height = std::max(tex.baseHeight >> cmd.copy.srcMipLevel, 1_u32);
+
+  u32 num_bytes = utils::roundUp(
+      width * height * textureConversionBytesPerTexel(cmd.conversion),
+      (u32)sizeof(u32));
+
+  if (num_bytes > textureConverter.scratchNumBytes) {
+    // Command buffers already referencing the old scratch buffer keep it
+    // alive
+    u32 new_num_bytes = std::max(num_bytes,
+                                 textureConverter.scratchNumBytes * 2);
+
+    wgpu::BufferDescriptor scratch_desc {
+      .usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopySrc,
+      .size = new_num_bytes,
+    };
+
+    textureConverter.scratch = dev.CreateBuffer(&scratch_desc);
+    textureConverter.scratchNumBytes = new_num_bytes;
+  }
+
+  bool is_depth = cmd.conversion == TextureConversion::Depth_UNorm16;
+
+  wgpu::TextureViewDescriptor view_desc {
+    .dimension = wgpu::TextureViewDimension::e2D,
+    .baseMipLevel = cmd.copy.srcMipLevel,
+    .mipLevelCount = 1,
+  };
+
+  wgpu::BindGroupEntry bind_group_entries[2] {
+    {
+      .binding = is_depth ? 2_u32 : 0_u32,
+      .textureView = tex.texture.CreateView(&view_desc),
+    },
+    {
+      .binding = 1,
+      .buffer = textureConverter.scratch,
+      .offset = 0,
+      .size = num_bytes,
+    },
+  };
+
+  wgpu::BindGroupDescriptor bind_group_desc {
+    .layout = is_depth ?
+        textureConverter.depthLayout : textureConverter.colorLayout,
+    .entryCount = 2,
+    .entries = bind_group_entries,
+  };
+
+  wgpu::BindGroup bind_group = dev.CreateBindGroup(&bind_group_desc);
+
+  u32 num_blocks = utils::divideRoundUp(num_bytes / (u32)sizeof(u32), 64_u32);
+  u32 num_blocks_x = std::min(num_blocks, MAX_WORKGROUPS_PER_DIM);
+  u32 num_blocks_y = utils::divideRoundUp(num_blocks, num_blocks_x);
+
+  wgpu::ComputePassEncoder pass_enc = enc.BeginComputePass();
+  pass_enc.SetPipeline(textureConverter.pipelines[(i32)cmd.conversion]);
+  pass_enc.SetBindGroup(0, bind_group);
+  pass_enc.DispatchWorkgroups(num_blocks_x, num_blocks_y);
+  pass_enc.End();
+
+  enc.CopyBufferToBuffer(textureConverter.scratch, 0,
+                         *buffers.hot(cmd.copy.dst), cmd.copy.dstOffset,
+                         num_bytes);
+}
+
+void Backend::encodeMultiDrawEmulation(
+    wgpu::CommandEncoder &enc,
+    const CommandDecoder &decoder,
+    const GPUTmpInputState &gpu_tmp_input)
+{
+  u32 num_bytes = 0;
+  decoder.forEachMultiDrawIndirect([&](const MultiDrawIndirectParams &params) {
+    num_bytes += multiDrawEmulationNumBytes(params.maxDraws);
+  });
+
+  if (num_bytes > multiDrawEmulator.scratchNumBytes) {
+    // Command buffers already referencing the old scratch buffer keep it
+    // alive
+    u32 new_num_bytes = std::max(num_bytes,
+                                 multiDrawEmulator.scratchNumBytes * 2);
+
+    wgpu::BufferDescriptor scratch_desc {
+      .usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::Indirect,
+      .size = new_num_bytes,
+    };
+
+    multiDrawEmulator.scratch = dev.CreateBuffer(&scratch_desc);
+    multiDrawEmulator.scratchNumBytes = new_num_bytes;
+  }
+
+  wgpu::ComputePassEncoder pass_enc = enc.BeginComputePass();
+  pass_enc.SetPipeline(multiDrawEmulator.pipeline);
+
+  u32 dst_offset = 0;
+  decoder.forEachMultiDrawIndirect([&](const MultiDrawIndirectParams &params) {
+    if (params.maxDraws == 0) {
+      return;
+    }
+
+    u32 region_num_bytes = multiDrawEmulationNumBytes(params.maxDraws);
+
+    wgpu::BindGroupEntry bind_group_entries[3] {
+      {
+        .binding = 0,
+        .buffer = *buffers.hot(params.args.buffer),
+      },
+      {
+        .binding = 1,
+        .buffer = *buffers.hot(params.countBuffer),
+      },
+      {
+        .binding = 2,
+        .buffer = multiDrawEmulator.scratch,
+        .offset = dst_offset,
+        .size = region_num_bytes,
+      },
+    };
+
+    wgpu::BindGroupDescriptor bind_group_desc {
+      .layout = multiDrawEmulator.layout,
+      .entryCount = 3,
+      .entries = bind_group_entries,
+    };
+
+    i32 tmp_buf_idx = (i32)params.emulationArgsBuffer.id -
+        (i32)gpu_tmp_input.tmpBufferHandlesBase;
+
+    u32 num_blocks = utils::divideRoundUp(params.maxDraws, 64_u32);
+    u32 num_blocks_x = std::min(num_blocks, MAX_WORKGROUPS_PER_DIM);
+    u32 num_blocks_y = utils::divideRoundUp(num_blocks, num_blocks_x);
+
+    pass_enc.SetBindGroup(0,
+        gpu_tmp_input.tmpGPUBufferBindGroups[tmp_buf_idx],
+        1, &params.emulationArgsOffset);
+    pass_enc.SetBindGroup(1, dev.CreateBindGroup(&bind_group_desc));
+    pass_enc.DispatchWorkgroups(num_blocks_x, num_blocks_y);
+
+    dst_offset += region_num_bytes;
+  });
+
+  pass_enc.End();
+}
+
 i32 Backend::allocStagingBufferFromBelt()
 {
   stagingBelt.lock.lock();
@@ -2637,6 +4376,22 @@ void Backend::allocGPUTmpBuffer(GPUTmpInputState &state, i32 buf_idx)
 
   state.tmpGPUBufferBindGroups[buf_idx] = bind_group;
 
+  wgpu::BindGroupEntry storage_bind_group_entry {
+    .binding = 0,
+    .buffer = *to_buffer,
+    .offset = 0,
+    .size = TMP_BUFFER_SIZE,
+  };
+
+  wgpu::BindGroupDescriptor storage_bind_group_desc {
+    .layout = tmpStorageLayout,
+    .entryCount = 1,
+    .entries = &storage_bind_group_entry,
+  };
+
+  state.tmpGPUBufferStorageBindGroups[buf_idx] =
+      dev.CreateBindGroup(&storage_bind_group_desc);
+
   state.maxNumUsedTmpGPUBuffers += 1;
 }
 
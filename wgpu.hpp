@@ -24,6 +24,7 @@ struct BackendTexture {
 
 struct BackendTextureCold {
   wgpu::Texture texture;
+  TextureFormat format;
   u32 baseWidth;
   u32 baseHeight;
   u32 baseDepth;
@@ -39,6 +40,9 @@ struct BackendDepthAttachmentConfig {
   wgpu::LoadOp loadOp;
   wgpu::StoreOp storeOp;
   float clearValue;
+  wgpu::LoadOp stencilLoadOp;
+  wgpu::StoreOp stencilStoreOp;
+  u32 stencilClearValue;
 };
 
 struct BackendColorAttachmentConfig {
@@ -52,6 +56,7 @@ struct BackendRasterPassConfig {
   BackendDepthAttachmentConfig depthAttachment;
   BackendColorAttachmentConfig colorAttachments[MAX_COLOR_ATTACHMENTS];
   i32 numColorAttachments;
+  u32 sampleCount;
 };
 
 struct BackendDepthAttachment {
@@ -59,10 +64,14 @@ struct BackendDepthAttachment {
   wgpu::LoadOp loadOp;
   wgpu::StoreOp storeOp;
   float clearValue;
+  wgpu::LoadOp stencilLoadOp;
+  wgpu::StoreOp stencilStoreOp;
+  u32 stencilClearValue;
 };
 
 struct BackendColorAttachment {
   wgpu::TextureView view;
+  wgpu::TextureView resolveView;
   wgpu::LoadOp loadOp;
   wgpu::StoreOp storeOp;
   math::Vector4 clearValue;
@@ -74,12 +83,62 @@ struct BackendRasterPass {
   BackendColorAttachment colorAttachments[MAX_COLOR_ATTACHMENTS];
   i32 numColorAttachments;
   i32 swapchainAttachmentIndex;
+  i32 swapchainResolveIndex;
   Swapchain swapchain;
+  wgpu::QuerySet occlusionQuerySet;
 };
 
 struct BackendRasterShader {
   wgpu::RenderPipeline pipeline;
   i32 perDrawBindGroupSlot;
+  bool packedDrawData;
+  u32 numPrimitiveVertices;
+};
+
+struct BackendComputeShader {
+  wgpu::ComputePipeline pipeline;
+  i32 perDispatchBindGroupSlot;
+};
+
+// Built-in downsample pipelines used for mip chain generation, one per
+// color format since the render target format is baked into the pipeline.
+// Indexed by TextureFormat, only filterable & renderable formats have one.
+constexpr inline i32 NUM_MIP_GEN_FORMATS = (i32)TextureFormat::RGBA16_Float + 1;
+
+struct MipGenerator {
+  wgpu::BindGroupLayout layout;
+  wgpu::Sampler sampler;
+  std::array<wgpu::RenderPipeline, NUM_MIP_GEN_FORMATS> pipelines;
+};
+
+struct ScatterUpdater {
+  wgpu::BindGroupLayout layout;
+  wgpu::ComputePipeline pipeline;
+  // Packed scatter data is copied here from the mappable staging buffers,
+  // which can't be bound to shaders
+  wgpu::Buffer scratch;
+};
+
+constexpr inline i32 NUM_TEXTURE_CONVERSIONS =
+    (i32)TextureConversion::RGBA16_Float + 1;
+
+struct TextureConverter {
+  wgpu::BindGroupLayout colorLayout;
+  wgpu::BindGroupLayout depthLayout;
+  std::array<wgpu::ComputePipeline, NUM_TEXTURE_CONVERSIONS> pipelines;
+  // Converted texels are written here and then copied to the destination,
+  // since readback buffers can't be bound to shaders. Grown on demand.
+  wgpu::Buffer scratch;
+  u32 scratchNumBytes;
+};
+
+struct MultiDrawEmulator {
+  wgpu::BindGroupLayout layout;
+  wgpu::ComputePipeline pipeline;
+  // Copies of each multi draw's args with draws past the GPU count
+  // zeroed, consumed by a DrawIndexedIndirect loop. Grown on demand.
+  wgpu::Buffer scratch;
+  u32 scratchNumBytes;
 };
 
 struct NoMetadata {};
@@ -87,6 +146,7 @@ struct NoMetadata {};
 constexpr inline u32 TMP_BUFFER_SIZE = 64 * 1024 * 1024;
 constexpr inline i32 MAX_TMP_BUFFERS_PER_QUEUE = 16;
 constexpr inline i32 MAX_TMP_STAGING_BUFFERS = 64;
+constexpr inline i32 MAX_PENDING_SUBMITS_PER_QUEUE = 8;
 constexpr inline u32 NUM_BLOCKS_PER_TMP_BUFFER =
   TMP_BUFFER_SIZE / GPUTmpMemBlock::BLOCK_SIZE;
 
@@ -113,6 +173,9 @@ struct StagingBelt {
 struct GPUTmpInputState {
   std::array<wgpu::BindGroup, MAX_TMP_BUFFERS_PER_QUEUE>
       tmpGPUBufferBindGroups;
+  // Whole buffer read only storage bindings for packed per draw data
+  std::array<wgpu::BindGroup, MAX_TMP_BUFFERS_PER_QUEUE>
+      tmpGPUBufferStorageBindGroups;
 
   std::array<i32, MAX_TMP_BUFFERS_PER_QUEUE> tmpStagingBuffers;
 
@@ -132,9 +195,23 @@ struct TmpParamBlockState {
   u32 baseHandleOffset;
 };
 
+// Submissions on secondary queues are encoded immediately but held back
+// from the wgpu::Queue until the main queue waits on them, the next main
+// queue submission, or an explicit wait.
+struct PendingSubmit {
+  wgpu::CommandBuffer cmdBuf;
+  std::array<i32, MAX_TMP_BUFFERS_PER_QUEUE * 2> stagingBuffers;
+  i32 numStagingBuffers;
+};
+
 struct BackendQueueData {
   GPUTmpInputState gpuTmpInput;
   TmpParamBlockState tmpParamBlockState;
+
+  std::array<PendingSubmit, MAX_PENDING_SUBMITS_PER_QUEUE> pendingSubmits;
+  u64 numSubmits;
+  u64 numFlushedSubmits;
+  u64 numFinishedSubmits;
 };
 
 class WebGPUAPI final : public GPUAPI {
@@ -168,6 +245,12 @@ using SamplerTable = ResourceTable<
     NoMetadata 
   >;
 
+using QuerySetTable = ResourceTable<
+    QuerySet,
+    wgpu::QuerySet,
+    NoMetadata
+  >;
+
 using BufferTable = ResourceTable<
     Buffer,
     wgpu::Buffer,
@@ -204,10 +287,33 @@ using RasterShaderTable = ResourceTable<
     NoMetadata
   >;
 
+using ComputeShaderTable = ResourceTable<
+    ComputeShader,
+    gas::webgpu::BackendComputeShader,
+    NoMetadata
+  >;
+
+using RenderBundleTable = ResourceTable<
+    RenderBundle,
+    wgpu::RenderBundle,
+    NoMetadata
+  >;
+
 using SwapchainStorage = InlineArrayFreeList<BackendSwapchain, 1>;
 
+// Draw state translation is shared between raster passes and render bundles
+struct DrawStateBindings {
+  wgpu::BindGroup dynamicTmpInputBindGroup;
+  wgpu::BindGroup storageTmpInputBindGroup;
+  u32 dataOffset = 0;
+  i32 dynamicBindGroupIdx = -1;
+  bool packedDrawData = false;
+  u32 numPrimitiveVertices = 3;
+};
+
 struct BackendLimits {
   u32 maxNumUniformBytes;
+  bool supportsMultiDrawIndirect;
 };
 
 class Backend final : public BackendCommon {
@@ -220,12 +326,18 @@ public:
 
   StagingBelt stagingBelt {};
   wgpu::BindGroupLayout tmpDynamicUniformLayout;
+  wgpu::BindGroupLayout tmpStorageLayout;
+  MipGenerator mipGenerator {};
+  ScatterUpdater scatterUpdater {};
+  TextureConverter textureConverter {};
+  MultiDrawEmulator multiDrawEmulator {};
   std::array<BackendQueueData, 2> queueDatas;
 
   BufferTable buffers {};
   TextureTable textures {};
 
   SamplerTable samplers {};
+  QuerySetTable querySets {};
 
   ParamBlockTypeTable paramBlockTypes {};
   ParamBlockTable paramBlocks {};
@@ -234,6 +346,9 @@ public:
   RasterPassTable rasterPasses {};
 
   RasterShaderTable rasterShaders {};
+  ComputeShaderTable computeShaders {};
+
+  RenderBundleTable renderBundles {};
 
   SwapchainStorage swapchains {};
 
@@ -284,6 +399,11 @@ public:
                       Sampler *handles_out) final;
   void destroySamplers(i32 num_samplers, Sampler *handles) final;
 
+  void createQuerySets(i32 num_query_sets,
+                       const QuerySetInit *query_set_inits,
+                       QuerySet *handles_out) final;
+  void destroyQuerySets(i32 num_query_sets, QuerySet *handles) final;
+
   void createParamBlockTypes(
     i32 num_types,
     const ParamBlockTypeInit *blk_types,
@@ -326,12 +446,22 @@ public:
                           RasterShader *handles_out) final;
   void destroyRasterShaders(i32 num_shaders, RasterShader *handles) final;
 
+  void createComputeShaders(i32 num_shaders,
+                            const ComputeShaderInit *shader_inits,
+                            ComputeShader *handles_out) final;
+  void destroyComputeShaders(i32 num_shaders, ComputeShader *handles) final;
+
+  void destroyRenderBundles(i32 num_bundles, RenderBundle *handles) final;
+
   Swapchain createSwapchain(Surface surface,
                             SwapchainProperties *properties) final;
   void destroySwapchain(Swapchain swapchain) final;
   AcquireSwapchainResult acquireSwapchainImage(Swapchain swapchain) final;
   void presentSwapchainImage(Swapchain swapchain) final;
 
+  bool isSubmitFinished(GPUSubmitToken token) final;
+  void waitForSubmit(GPUSubmitToken token) final;
+
   void waitUntilReady(GPUQueue queue_hdl) final;
   void waitUntilWorkFinished(GPUQueue queue_hdl) final;
 
@@ -345,9 +475,29 @@ public:
   inline BackendRasterPassConfig * getRasterPassConfigByID(
       RasterPassInterfaceID id);
 
+  void initRasterPass(const RasterPassInit &pass_init,
+                      BackendRasterPass &out);
+
   inline wgpu::BindGroupLayout getBindGroupLayoutByParamBlockTypeID(
       ParamBlockTypeID id);
 
+  void encodeGenerateMips(wgpu::CommandEncoder &enc,
+                          const BackendTextureCold &tex);
+  void encodeScatterUpdate(wgpu::CommandEncoder &enc,
+                           const CopyScatterUpdateCmd &scatter);
+  void encodeTextureConversion(wgpu::CommandEncoder &enc,
+                               const CopyTextureToBufferConvertedCmd &cmd);
+  void encodeMultiDrawEmulation(wgpu::CommandEncoder &enc,
+                                const CommandDecoder &decoder,
+                                const GPUTmpInputState &gpu_tmp_input);
+
+  template <typename EncoderT>
+  DrawParams encodeDrawState(EncoderT &enc,
+                             CommandDecoder &decoder,
+                             CommandCtrl ctrl,
+                             const GPUTmpInputState *gpu_tmp_input,
+                             DrawStateBindings &bindings);
+
   i32 allocStagingBufferFromBelt();
   static void returnBufferToStagingBeltCallback(
     wgpu::MapAsyncStatus async_status, const char *msg, void *user_data);
@@ -357,9 +507,19 @@ public:
   inline void allocGPUTmpBuffer(GPUTmpInputState &state, i32 buf_idx);
 
   void unmapActiveStagingBuffers(GPUTmpInputState &gpu_tmp_input);
+  i32 getActiveStagingBuffers(GPUTmpInputState &gpu_tmp_input, i32 *out);
+  void mapStagingBuffer(i32 staging_belt_idx);
   void mapActiveStagingBuffers(GPUTmpInputState &gpu_tmp_input);
 
-  void submit(GPUQueue queue_hdl, FrontendCommands *cmds) final;
+  void trackSubmitCompletion(BackendQueueData &queue_data, u64 submit_id);
+  void flushPendingSubmits(BackendQueueData &queue_data, u64 up_to_id);
+  void flushAllPendingSubmits();
+
+  GPUSubmitToken submit(GPUQueue queue_hdl, FrontendCommands *cmds,
+                        Span<const GPUSubmitToken> wait_tokens) final;
+
+  RenderBundle createRenderBundle(RenderBundleInit init,
+                                  FrontendCommands *cmds) final;
 };
 
 }